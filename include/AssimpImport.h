@@ -1,11 +1,23 @@
 #pragma once
+#include "KeyframeAnimation.h"
 #include "Object3D.h"
+#include "TextureStreamer.h"
 #include <assimp/scene.h>
 #include <unordered_map>
 #include <filesystem>
 #include <string>
 
-Object3D assimpLoad(const std::string& path, bool flipUVCoords);
+/**
+ * @brief Loads a model file into an Object3D hierarchy.
+ * @param withLightmapUVs whether to unwrap a second UV set for lightmap baking; only worth
+ * it for static objects.
+ * @param streamer if given, textures are streamed by mip level instead of loaded in full.
+ * @param clips if given, receives the file's keyframe animations, whose node names match the
+ * names of the returned objects.
+ */
+Object3D assimpLoad(const std::string& path, bool flipUVCoords, bool withLightmapUVs = false,
+	TextureStreamer* streamer = nullptr, std::vector<KeyframeClip>* clips = nullptr);
 Object3D processAssimpNode(aiNode* node, const aiScene* scene,
 	const std::filesystem::path& modelPath,
-	std::unordered_map<std::string, Texture>& loadedTextures);
\ No newline at end of file
+	std::unordered_map<std::string, Texture>& loadedTextures, bool withLightmapUVs, TextureStreamer* streamer);
+std::vector<KeyframeClip> importKeyframeClips(const aiScene* scene);
@@ -0,0 +1,107 @@
+#pragma once
+#include <SFML/Audio.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <vector>
+#include "ThreadPool.h"
+
+/**
+ * @brief How a sound shares the voices with the others.
+ */
+struct SoundSettings {
+	// When every voice is busy, a sound takes the voice of the oldest sound of lower priority.
+	uint8_t priority = 0;
+	// The most voices the sound plays on at once; starting it again restarts its oldest voice.
+	uint32_t maxVoices = 2;
+	// The least time between two starts, in seconds; starts sooner than that are dropped.
+	float minInterval = 0;
+	float volume = 100;
+};
+
+/**
+ * @brief Plays short sounds on a fixed pool of voices, so however many things in the scene make
+ * noise at once, only so many sounds are ever mixed.
+ *
+ * Sounds are decoded to PCM on worker threads and cached by path, so loading never stalls the
+ * main loop and each file is decoded once. A sound plays only once it's decoded; until then
+ * starting it does nothing. Long ambient tracks are streamed from disk instead.
+ */
+class AudioManager {
+private:
+	struct Sound {
+		std::filesystem::path path;
+		SoundSettings settings;
+		// Filled in by the decode job.
+		std::vector<sf::Int16> samples;
+		uint32_t channelCount;
+		uint32_t sampleRate;
+		bool failed;
+		std::future<void> decoding;
+		// Made from the samples on the main thread, once decoded.
+		sf::SoundBuffer buffer;
+		bool ready;
+		float lastStart;
+	};
+
+	struct Voice {
+		sf::Sound sound;
+		// The sound last started on the voice, or -1.
+		int32_t soundId;
+		uint8_t priority;
+		float startTime;
+	};
+
+	ThreadPool& m_pool;
+	std::vector<std::unique_ptr<Sound>> m_sounds;
+	std::vector<Voice> m_voices;
+	std::unique_ptr<sf::Music> m_stream;
+	float m_time;
+
+	void finishDecoding(Sound& sound);
+	Voice* findVoice(uint32_t soundId, const Sound& sound);
+
+public:
+	/**
+	 * @brief Sets up the given number of voices, decoding sounds on the pool's workers.
+	 */
+	explicit AudioManager(ThreadPool& pool, uint32_t voiceCount = 16);
+	~AudioManager();
+
+	AudioManager(const AudioManager&) = delete;
+	AudioManager& operator=(const AudioManager&) = delete;
+
+	/**
+	 * @brief Starts decoding a sound file in the background. Loading a file already loaded
+	 * returns the same sound, keeping its first settings.
+	 * @return the sound's index, for play().
+	 */
+	uint32_t load(const std::filesystem::path& path, const SoundSettings& settings = {});
+
+	/**
+	 * @brief Starts a sound, if it's decoded and its rate and voice limits allow.
+	 * @return whether it started.
+	 */
+	bool play(uint32_t sound);
+
+	/**
+	 * @brief Streams a long track from disk, e.g. ambient music, in place of any already
+	 * streaming.
+	 */
+	void playStream(const std::filesystem::path& path, float volume = 100, bool loop = true);
+
+	/**
+	 * @brief Advances the manager's clock, in seconds, and takes in the sounds that finished
+	 * decoding. Call once per frame.
+	 */
+	void update(float dt);
+
+	/**
+	 * @brief Whether every sound loaded so far has finished decoding, or failed to.
+	 */
+	bool loaded() const;
+
+	uint32_t activeVoices() const;
+	size_t voiceCount() const { return m_voices.size(); }
+};
@@ -0,0 +1,118 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstdint>
+#include <vector>
+#include "Object3D.h"
+#include "Timeline.h"
+
+/**
+ * @brief A unit quaternion in 48 bits: which component is largest, and the other three
+ * quantised to 15 bits each. The largest is rebuilt from the others when unpacked.
+ */
+struct PackedQuat {
+	uint16_t bits[3];
+
+	static PackedQuat pack(glm::quat q);
+	glm::quat unpack() const;
+};
+
+/**
+ * @brief How far a baked clip may stray from the animation it was baked from, for keyframe
+ * reduction to drop the keys that lie close enough to the line between their neighbours.
+ */
+struct BakeTolerances {
+	// In world units.
+	float position = 0.001f;
+	// In radians.
+	float rotation = 0.002f;
+	float scale = 0.001f;
+};
+
+/**
+ * @brief One property of one object over a baked clip: the keys left after reduction, at frame
+ * numbers, and for every frame the last key at or before it, so finding a key never searches.
+ */
+template <typename T>
+struct BakedChannel {
+	std::vector<uint16_t> frames;
+	std::vector<T> values;
+	std::vector<uint16_t> keyAt;
+};
+
+/**
+ * @brief The positions, orientations and scales of a set of objects, sampled from an animation
+ * at a fixed rate and compressed for cheap looping playback. Rotations are quantised to 48
+ * bits, and keys that linear interpolation reproduces within the tolerances are dropped.
+ */
+class BakedClip {
+private:
+	struct ObjectChannels {
+		BakedChannel<glm::vec3> position;
+		BakedChannel<PackedQuat> rotation;
+		BakedChannel<glm::vec3> scale;
+	};
+
+	float m_rate;
+	float m_duration;
+	uint32_t m_frameCount;
+	std::vector<ObjectChannels> m_objects;
+
+	friend BakedClip bakeTimeline(Timeline& timeline, const std::vector<Object3D*>& objects,
+		float rate, const BakeTolerances& tolerances);
+	friend class BakedClipPlayer;
+
+public:
+	float duration() const { return m_duration; }
+	uint32_t frameCount() const { return m_frameCount; }
+	size_t objectCount() const { return m_objects.size(); }
+
+	/**
+	 * @brief The number of keys kept across every channel.
+	 */
+	size_t keyCount() const;
+};
+
+/**
+ * @brief Bakes a started timeline's effect on some of the objects it animates, seeking it from
+ * start to end a frame at a time, at a fixed rate of frames per second, which poses the objects
+ * as playing it at that rate would. Events don't fire, and the timeline is stepped back to its
+ * start afterwards.
+ *
+ * Only the objects' own position, orientation and scale are recorded, which is what rotation,
+ * translation and path channels move.
+ */
+BakedClip bakeTimeline(Timeline& timeline, const std::vector<Object3D*>& objects,
+	float rate = 30, const BakeTolerances& tolerances = {});
+
+/**
+ * @brief Loops a baked clip on many sets of objects at once, each at its own phase offset, all
+ * sharing the one clip.
+ */
+class BakedClipPlayer {
+private:
+	const BakedClip* m_clip;
+	// The objects of each instance, in the order the clip was baked from.
+	std::vector<Object3D*> m_targets;
+	std::vector<float> m_phase;
+
+public:
+	/**
+	 * @brief Plays a clip, which must outlive the player.
+	 */
+	explicit BakedClipPlayer(const BakedClip& clip);
+
+	/**
+	 * @brief Adds a set of objects to play the clip on, as many as it was baked from, offset
+	 * by a phase in seconds. The objects must outlive the player and stay where they are.
+	 * @return the instance's index.
+	 */
+	uint32_t add(const std::vector<Object3D*>& objects, float phase = 0);
+
+	/**
+	 * @brief Poses every instance at a time, in seconds, looping the clip.
+	 */
+	void update(float time);
+
+	size_t instanceCount() const { return m_phase.size(); }
+};
@@ -0,0 +1,92 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <string>
+#include <vector>
+#include "GpuProfiler.h"
+
+/**
+ * @brief Drives a fixed, scripted run of the scene for a set number of frames and records
+ * per-frame statistics, written out as JSON when the run finishes.
+ *
+ * Fragment counts come from GL_SAMPLES_PASSED queries around the shaded pass. Queries are kept in
+ * a small ring and read back a few frames late, so collecting them never stalls the pipeline.
+ */
+class Benchmark {
+private:
+	struct FrameStats {
+		float cpuSeconds;
+		uint64_t samplesPassed;
+	};
+
+	struct GpuScopeStats {
+		std::string path;
+		double totalMilliseconds;
+		uint32_t frames;
+	};
+
+	static const uint32_t QUERY_LATENCY = 3;
+
+	uint32_t m_frameCount;
+	uint32_t m_currentFrame;
+	uint64_t m_samplesPerFrame;
+	bool m_depthPrepass;
+	uint32_t m_queries[QUERY_LATENCY];
+	std::vector<FrameStats> m_frames;
+	// Per-scope GPU totals, in the order the scopes were first seen.
+	std::vector<GpuScopeStats> m_gpuScopes;
+	int64_t m_lastGpuFrame;
+	uint32_t m_gpuDroppedFrames;
+
+	void collect(uint32_t frame);
+
+public:
+	/**
+	 * @brief Constructs a benchmark of the given length.
+	 * @param samplesPerFrame the number of framebuffer samples (pixels times MSAA samples), used
+	 * to express fragment counts as overdraw.
+	 * @param depthPrepass whether the run uses the depth pre-pass, recorded in the report.
+	 */
+	Benchmark(uint32_t frameCount, uint64_t samplesPerFrame, bool depthPrepass);
+	~Benchmark();
+
+	Benchmark(const Benchmark&) = delete;
+	Benchmark& operator=(const Benchmark&) = delete;
+
+	/**
+	 * @brief The fixed simulation step used for every frame of the run, so runs are comparable.
+	 */
+	float timeStep() const { return 1.0f / 60.0f; }
+
+	/**
+	 * @brief The scripted camera position for the current frame: a slow orbit of the room.
+	 */
+	glm::vec3 cameraPosition() const;
+
+	/**
+	 * @brief The scripted camera direction for the current frame.
+	 */
+	glm::vec3 cameraDirection() const;
+
+	/**
+	 * @brief Starts counting fragments that pass the depth test in the shaded pass.
+	 */
+	void beginShadedPass();
+	void endShadedPass();
+
+	/**
+	 * @brief Records the CPU time of the frame that was just submitted and advances to the next.
+	 */
+	void endFrame(float cpuSeconds);
+
+	/**
+	 * @brief Adds the profiler's latest frame of GPU timings to the run, if it hasn't been seen yet.
+	 */
+	void recordGpuTimings(const GpuProfiler& profiler);
+
+	bool finished() const { return m_currentFrame >= m_frameCount; }
+
+	/**
+	 * @brief Reads back any outstanding queries and writes the summary to the given path.
+	 */
+	void writeReport(const std::string& path);
+};
@@ -0,0 +1,77 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief An axis-aligned bounding box.
+ */
+struct Aabb {
+	glm::vec3 lower;
+	glm::vec3 upper;
+
+	bool overlaps(const Aabb& other) const {
+		return lower.x <= other.upper.x && upper.x >= other.lower.x && lower.y <= other.upper.y
+			&& upper.y >= other.lower.y && lower.z <= other.upper.z && upper.z >= other.lower.z;
+	}
+};
+
+/**
+ * @brief Two proxies whose boxes overlap, with first < second.
+ */
+struct BroadphasePair {
+	uint32_t first;
+	uint32_t second;
+};
+
+/**
+ * @brief Finds the overlapping pairs among many moving boxes with incremental sweep-and-prune.
+ *
+ * Proxies are kept sorted by their lower bound along one axis. Bodies move little between steps,
+ * so the order from the previous step is nearly sorted already and an insertion sort restores it
+ * in close to linear time. A sweep along the sorted order then only tests boxes whose intervals
+ * on that axis overlap. The axis is the one the boxes are most spread out along, re-chosen every
+ * time, so dice strewn across a table don't all land in one slab.
+ */
+class SweepAndPrune {
+private:
+	std::vector<Aabb> m_bounds;
+	std::vector<bool> m_active;
+	std::vector<uint32_t> m_freeProxies;
+	// Active proxies, by their lower bound along m_axis as of the last findPairs.
+	std::vector<uint32_t> m_order;
+	int m_axis;
+	// Set when proxies were added in arbitrary order, which insertion sort would be slow on.
+	bool m_needsFullSort;
+	std::vector<BroadphasePair> m_pairs;
+
+	void chooseAxis();
+
+public:
+	SweepAndPrune();
+
+	/**
+	 * @brief Starts tracking a box.
+	 * @return the proxy for updating or removing it; ids of removed proxies are reused.
+	 */
+	uint32_t add(const Aabb& bounds);
+
+	/**
+	 * @brief Moves a proxy's box. Cheap: the order is only repaired in findPairs.
+	 */
+	void update(uint32_t proxy, const Aabb& bounds) { m_bounds[proxy] = bounds; }
+
+	void remove(uint32_t proxy);
+
+	/**
+	 * @brief Re-sorts the proxies and returns every overlapping pair, for the narrowphase.
+	 */
+	const std::vector<BroadphasePair>& findPairs();
+
+	/**
+	 * @brief The pairs found by the last findPairs.
+	 */
+	const std::vector<BroadphasePair>& pairs() const { return m_pairs; }
+
+	size_t proxyCount() const { return m_order.size(); }
+};
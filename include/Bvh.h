@@ -0,0 +1,135 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief A ray with a maximum hit distance; direction need not be normalized.
+ */
+struct Ray {
+	glm::vec3 origin;
+	glm::vec3 direction;
+	float tMax;
+};
+
+/**
+ * @brief The closest intersection of a ray with a triangle.
+ */
+struct RayHit {
+	// Distance along the ray, in multiples of its direction.
+	float t;
+	// Index of the triangle, in the order given to the BVH.
+	uint32_t triangle;
+	// Barycentric weights of the triangle's second and third vertices.
+	float u;
+	float v;
+};
+
+/**
+ * @brief A bounding volume hierarchy over a triangle soup, built with the binned surface area
+ * heuristic, for ray casts against imported scene geometry on the CPU.
+ */
+class TriangleBvh {
+public:
+	struct Node {
+		glm::vec3 boundsMin;
+		// Leaves: the first triangle. Interior nodes: the left child; the right follows it.
+		uint32_t firstOrLeft;
+		glm::vec3 boundsMax;
+		// Zero for interior nodes.
+		uint32_t triangleCount;
+	};
+
+	// Stored as a vertex and two edges, the form the intersection test wants.
+	struct Triangle {
+		glm::vec3 v0;
+		glm::vec3 edge1;
+		glm::vec3 edge2;
+	};
+
+private:
+	std::vector<Node> m_nodes;
+	std::vector<Triangle> m_triangles;
+	// The original index of each (reordered) triangle.
+	std::vector<uint32_t> m_triangleIds;
+
+public:
+	TriangleBvh() = default;
+
+	/**
+	 * @brief Builds a BVH over triangles given as consecutive triples of vertices.
+	 */
+	explicit TriangleBvh(const std::vector<glm::vec3>& triangleVertices);
+
+	/**
+	 * @brief Finds the closest hit along the ray within ray.tMax.
+	 * @return true if anything was hit, in which case `hit` describes the closest hit.
+	 */
+	bool intersect(const Ray& ray, RayHit& hit) const;
+
+	/**
+	 * @brief Whether anything lies along the ray within ray.tMax; stops at the first hit found.
+	 */
+	bool occluded(const Ray& ray) const;
+
+	/**
+	 * @brief Appends the index of every triangle whose bounds overlap the box, in the BVH's own
+	 * order, i.e. for looking up in triangles().
+	 */
+	void overlapping(const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::vector<uint32_t>& result) const;
+
+	size_t triangleCount() const { return m_triangles.size(); }
+	const std::vector<Node>& nodes() const { return m_nodes; }
+	const std::vector<Triangle>& triangles() const { return m_triangles; }
+	const std::vector<uint32_t>& triangleIds() const { return m_triangleIds; }
+};
+
+/**
+ * @brief A 4-wide BVH collapsed from a TriangleBvh. Each node stores its children's bounds as
+ * structure-of-arrays lanes, so a ray is tested against all four boxes in one loop that the
+ * compiler vectorizes (SSE or NEON) without platform-specific intrinsics.
+ */
+class WideBvh {
+public:
+	static const uint32_t WIDTH = 4;
+
+	struct Node {
+		float minX[WIDTH];
+		float minY[WIDTH];
+		float minZ[WIDTH];
+		float maxX[WIDTH];
+		float maxY[WIDTH];
+		float maxZ[WIDTH];
+		// Leaf lanes: the first triangle. Interior lanes: the child node.
+		uint32_t child[WIDTH];
+		// Leaf lanes: the number of triangles. Interior and empty lanes: zero.
+		uint32_t triangleCount[WIDTH];
+	};
+
+private:
+	std::vector<Node> m_nodes;
+	std::vector<TriangleBvh::Triangle> m_triangles;
+	std::vector<uint32_t> m_triangleIds;
+
+public:
+	WideBvh() = default;
+
+	/**
+	 * @brief Collapses a binary BVH, pulling up to four descendants into each node by
+	 * repeatedly opening the largest interior child.
+	 */
+	explicit WideBvh(const TriangleBvh& binary);
+
+	/**
+	 * @brief Finds the closest hit along the ray within ray.tMax.
+	 */
+	bool intersect(const Ray& ray, RayHit& hit) const;
+
+	/**
+	 * @brief Whether anything lies along the ray within ray.tMax.
+	 */
+	bool occluded(const Ray& ray) const;
+
+	size_t triangleCount() const { return m_triangles.size(); }
+	const std::vector<uint32_t>& triangleIds() const { return m_triangleIds; }
+};
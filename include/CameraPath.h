@@ -0,0 +1,23 @@
+#pragma once
+#include <glm/ext.hpp>
+#include "SplinePath.h"
+
+/**
+ * @brief Where a scripted camera is and which way it looks.
+ */
+struct CameraPose {
+	glm::vec3 position;
+	glm::vec3 direction;
+};
+
+/**
+ * @brief A camera moving along a path at a steady speed, looking at a fixed point.
+ * @param progress how far along the path, from 0 at its start to 1 at its end.
+ */
+CameraPose cameraPoseOnPath(const SplinePath& path, const glm::vec3& target, float progress);
+
+/**
+ * @brief A slow orbit of the room, looking at its center, used for unattended runs.
+ * @param progress how far around the orbit, from 0 to 1 for one full turn.
+ */
+CameraPose orbitCameraPose(float progress);
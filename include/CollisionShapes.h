@@ -0,0 +1,104 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+/**
+ * @brief A box with its own axes.
+ */
+struct OrientedBox {
+	glm::vec3 center;
+	// Unit axes as columns.
+	glm::mat3 axes;
+	glm::vec3 halfExtents;
+};
+
+/**
+ * @brief A convex polyhedron, as its vertices and triangles wound counter-clockwise seen from
+ * outside. A flat point set gives a polygon with both windings of every triangle, and no volume.
+ */
+struct ConvexHull {
+	std::vector<glm::vec3> vertices;
+	std::vector<uint32_t> faces;
+	// The planes a decomposition cut the hull's piece out with, as outward normals and offsets.
+	// Its faces on them lie against the neighbouring hulls rather than on the model's surface.
+	std::vector<glm::vec4> cuts;
+
+	float volume() const;
+};
+
+/**
+ * @brief How finely concave geometry is broken into convex pieces.
+ */
+struct CollisionShapeSettings {
+	// The most hulls one shape is broken into.
+	uint32_t maxHulls = 32;
+	// Pieces are cut in two while their hull stands further than this off the surface it wraps, in
+	// the triangles' units: e.g. over the felt inside a table's rail.
+	float maxConcavity = 0.005f;
+	// The cutting planes tried along each axis of a piece's bounds, evenly spaced.
+	uint32_t planesPerAxis = 7;
+};
+
+/**
+ * @brief Simplified stand-ins for a model's render triangles, from the loosest to the tightest
+ * fit: an axis-aligned box, an oriented box, and a set of convex hulls that follow concave shapes
+ * like a table's top and legs.
+ */
+struct CollisionShape {
+	glm::vec3 lower;
+	glm::vec3 upper;
+	OrientedBox box;
+	std::vector<ConvexHull> hulls;
+
+	/**
+	 * @brief Appends the hulls' triangles as consecutive triples of vertices, e.g. for
+	 * PhysicsWorld::setStaticGeometry. Where a hull's face on a cut is covered by the hulls on the
+	 * other side, that part is inside the shape and left out, so it can't act as a wall.
+	 */
+	void appendTriangles(std::vector<glm::vec3>& triangles) const;
+
+	size_t triangleCount() const;
+};
+
+/**
+ * @brief Computes the convex hull of a point set with quickhull.
+ */
+ConvexHull quickhull(const std::vector<glm::vec3>& points);
+
+/**
+ * @brief Fits a box along the principal axes of the points, or along the world axes if that is
+ * tighter.
+ */
+OrientedBox fitOrientedBox(const std::vector<glm::vec3>& points);
+
+/**
+ * @brief Approximately decomposes triangles, given as consecutive triples of vertices, into
+ * convex hulls.
+ *
+ * Starting from the hull of everything, the piece whose hull stands furthest off the surface is
+ * repeatedly cut by the axis-aligned plane that leaves the least empty space in its halves' hulls,
+ * until every hull fits closely enough or there are settings.maxHulls of them.
+ */
+std::vector<ConvexHull> decomposeConvex(const std::vector<glm::vec3>& triangles,
+	const CollisionShapeSettings& settings);
+
+/**
+ * @brief Builds all of a model's collision shapes from its triangles.
+ */
+CollisionShape buildCollisionShape(const std::vector<glm::vec3>& triangles, const CollisionShapeSettings& settings);
+
+/**
+ * @brief Writes a shape to a baked file, tagged with the source triangles and settings it was
+ * built from.
+ */
+void saveCollisionShape(const std::filesystem::path& path, const CollisionShape& shape,
+	const std::vector<glm::vec3>& triangles, const CollisionShapeSettings& settings);
+
+/**
+ * @brief Reads a baked shape, if the file exists and was built from the same triangles and settings.
+ * @return whether the shape was loaded.
+ */
+bool loadCollisionShape(const std::filesystem::path& path, const std::vector<glm::vec3>& triangles,
+	const CollisionShapeSettings& settings, CollisionShape& shape);
@@ -0,0 +1,53 @@
+#pragma once
+#include <algorithm>
+
+/**
+ * @brief The contact tuning and per-contact impulse arithmetic of the sequential impulse solver.
+ *
+ * PhysicsWorld and DiceBatch both resolve contacts through these, so the dice the simulator rolls
+ * behave like the ones on the table. Everything works on scalars along one direction, which keeps
+ * it usable from DiceBatch's vectorized lanes as well as PhysicsWorld's glm vectors.
+ */
+struct ContactModel {
+	// Penetration left alone, so resting contacts don't jitter in and out of touching.
+	static constexpr float PENETRATION_SLOP = 0.001f;
+	// The fraction of the remaining penetration pushed out per step.
+	static constexpr float BAUMGARTE = 0.2f;
+	// Slower impacts don't bounce. This must be more than gravity adds over the couple of steps
+	// a body falls from just clear of a surface (0.33 m/s at 60 Hz), or resting bodies hop forever.
+	static constexpr float RESTITUTION_THRESHOLD = 0.5f;
+	// Corners are considered touching from slightly above a surface.
+	static constexpr float CONTACT_MARGIN = 0.002f;
+
+	/**
+	 * @brief The separating speed a contact asks for: a bounce off the approach speed the bodies
+	 * had before the solver ran, or a push out of penetration, whichever is more.
+	 */
+	static float velocityBias(float approach, float restitution, float penetration, float dt) {
+		float bounce = approach > RESTITUTION_THRESHOLD ? restitution * approach : 0.0f;
+		float pushOut = BAUMGARTE / dt * std::max(penetration - PENETRATION_SLOP, 0.0f);
+		return std::max(bounce, pushOut);
+	}
+
+	/**
+	 * @brief Accumulates the non-penetration impulse for the relative velocity along the normal;
+	 * the total may only ever push.
+	 * @return the impulse to apply this iteration.
+	 */
+	static float normalImpulse(float& accumulated, float velocity, float bias, float mass) {
+		float previous = accumulated;
+		accumulated = std::max(previous + (bias - velocity) * mass, 0.0f);
+		return accumulated - previous;
+	}
+
+	/**
+	 * @brief Accumulates the friction impulse for the relative velocity along a tangent, bounded
+	 * by the friction coefficient times the normal impulse.
+	 * @return the impulse to apply this iteration.
+	 */
+	static float frictionImpulse(float& accumulated, float velocity, float mass, float limit) {
+		float previous = accumulated;
+		accumulated = std::clamp(previous - velocity * mass, -limit, limit);
+		return accumulated - previous;
+	}
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief A 64-bit FNV-1a hash of whatever a cached bake was made from, so the cache can tell
+ * when its inputs have changed.
+ */
+class ContentHash {
+private:
+	uint64_t m_hash = 14695981039346656037ull;
+
+public:
+	void add(const void* data, size_t size) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++) {
+			m_hash = (m_hash ^ bytes[i]) * 1099511628211ull;
+		}
+	}
+
+	/**
+	 * @brief Adds the bytes of a plain value, such as a float, vector or matrix.
+	 */
+	template <typename T>
+	void add(const T& value) {
+		add(&value, sizeof(T));
+	}
+
+	uint64_t value() const { return m_hash; }
+};
@@ -0,0 +1,19 @@
+#pragma once
+#include <glm/glm.hpp>
+
+/**
+ * @brief How a die leaves the hand: where it starts, unrotated, and how it moves at release.
+ */
+struct DiceThrow {
+	glm::vec3 position;
+	glm::vec3 velocity;
+	// About the world axes, in radians per second.
+	glm::vec3 angularVelocity;
+};
+
+// The table game's two dice. The dice simulator throws around these, so its statistics are those
+// of the throws the game actually makes.
+inline const DiceThrow GAME_DICE_THROWS[2] = {
+	{ { 0, 2, 0 }, { -0.5f, 0.5f, 0 }, { 8, 5, 2 } },
+	{ { -0.5f, 2, 0 }, { 0.5f, 0.5f, -0.5f }, { 12, 1, 5 } },
+};
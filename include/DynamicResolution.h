@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include "ShaderProgram.h"
+
+/**
+ * @brief Renders the scene into an offscreen target at a fraction of the window's resolution,
+ * then upscales it to the window with a sharpening filter. The fraction follows the measured GPU
+ * frame time, so heavy views give up resolution instead of frames.
+ *
+ * The target is allocated at full window size and only a corner of it is rendered to, so changing
+ * the scale never reallocates anything.
+ */
+class DynamicResolution {
+private:
+	ShaderProgram m_upscaleShader;
+	uint32_t m_width;
+	uint32_t m_height;
+	uint32_t m_framebuffer;
+	uint32_t m_colorTexture;
+	uint32_t m_depthBuffer;
+	// Attribute-less draws still need a vertex array bound in a core profile.
+	uint32_t m_emptyVao;
+
+	float m_targetMilliseconds;
+	float m_scale;
+	// Consecutive measurements above or below the hysteresis band.
+	uint32_t m_framesOverBudget;
+	uint32_t m_framesUnderBudget;
+
+	void allocate();
+	void release();
+
+public:
+	static constexpr float MIN_SCALE = 0.5f;
+	static constexpr float MAX_SCALE = 1.0f;
+
+	/**
+	 * @brief Creates a target the size of the window.
+	 * @param upscaleShader the program that draws the scaled image to the window.
+	 * @param targetMilliseconds the GPU frame time to hold, e.g. 16.6 for 60 FPS.
+	 */
+	DynamicResolution(const ShaderProgram& upscaleShader, uint32_t windowWidth, uint32_t windowHeight,
+		float targetMilliseconds);
+	~DynamicResolution();
+
+	DynamicResolution(const DynamicResolution&) = delete;
+	DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+	/**
+	 * @brief Reallocates the target after the window was resized.
+	 */
+	void resize(uint32_t windowWidth, uint32_t windowHeight);
+
+	/**
+	 * @brief Feeds a measured GPU frame time to the controller. The scale drops when frames run
+	 * over the target for a few measurements in a row, and only rises again when there is clear
+	 * headroom, so it doesn't oscillate around the target.
+	 */
+	void update(double gpuMilliseconds);
+
+	/**
+	 * @brief Binds the offscreen target and sets the viewport to the scaled resolution.
+	 */
+	void beginFrame();
+
+	/**
+	 * @brief Upscales the frame into the given framebuffer (0 for the window), at window size.
+	 */
+	void endFrame(uint32_t targetFramebuffer);
+
+	float scale() const { return m_scale; }
+	uint32_t renderWidth() const;
+	uint32_t renderHeight() const;
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include <glad/glad.h>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <vector>
+#include "ThreadPool.h"
+
+/**
+ * @brief Renders frames into an offscreen framebuffer and saves every one to disk, for batch
+ * renders that nobody watches.
+ *
+ * Each frame is read back into one of a ring of pixel buffer objects, and only mapped a few frames
+ * later when its fence has signalled, so readback never stalls the pipeline. The pixels are then
+ * encoded on the thread pool, so rendering rather than compression sets the pace.
+ */
+class FrameRecorder {
+public:
+	enum class Format {
+		// One PNG per frame in the output directory.
+		Png,
+		// A single uncompressed, full-range YUV 4:2:0 stream, ready to be piped into a video encoder.
+		Y4m
+	};
+
+private:
+	struct Readback {
+		uint32_t buffer;
+		GLsync fence;
+		uint32_t frame;
+	};
+
+	struct Encode {
+		std::future<void> done;
+		// Y4M frames are encoded in parallel but must be written in order; the job leaves its
+		// frame here for the render thread to append.
+		std::shared_ptr<std::vector<uint8_t>> y4mFrame;
+	};
+
+	static const uint32_t READBACK_LATENCY = 3;
+
+	uint32_t m_width;
+	uint32_t m_height;
+	Format m_format;
+	std::filesystem::path m_output;
+	ThreadPool& m_pool;
+	uint32_t m_framebuffer;
+	uint32_t m_colorBuffer;
+	uint32_t m_depthBuffer;
+	Readback m_readbacks[READBACK_LATENCY];
+	uint32_t m_framesRendered;
+	std::deque<Encode> m_encodes;
+	std::ofstream m_y4m;
+
+	void collect(Readback& readback);
+	void retireEncodes(size_t maxPending);
+
+public:
+	/**
+	 * @brief Creates the offscreen target and readback buffers.
+	 * @param output a directory for PNG frames, or the file to write a Y4M stream to.
+	 * @param framesPerSecond the frame rate recorded in a Y4M stream's header.
+	 */
+	FrameRecorder(uint32_t width, uint32_t height, Format format, const std::filesystem::path& output,
+		uint32_t framesPerSecond, ThreadPool& pool);
+	~FrameRecorder();
+
+	FrameRecorder(const FrameRecorder&) = delete;
+	FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+	/**
+	 * @brief Binds the offscreen framebuffer, so the frame's rendering goes to the recording.
+	 */
+	void beginFrame();
+
+	/**
+	 * @brief Queues the finished frame for readback and, if `preview` is set, copies it to the
+	 * window's framebuffer.
+	 */
+	void endFrame(bool preview);
+
+	/**
+	 * @brief Reads back and encodes every frame still in flight, and waits for the encoders.
+	 */
+	void finish();
+
+	uint32_t framesRendered() const { return m_framesRendered; }
+};
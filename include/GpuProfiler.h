@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Measures how long the GPU spends on each part of a frame, using GL_TIMESTAMP queries.
+ *
+ * Scopes nest, so a frame can be broken down by render pass and, within a pass, by object.
+ * Each frame's queries come from one slot of a small ring and are read back FRAME_LATENCY - 1
+ * frames later, when they have finished, so profiling never stalls the pipeline.
+ */
+class GpuProfiler {
+public:
+	struct ScopeTiming {
+		// The scope's name prefixed by its parents', e.g. "frame/shaded/rouletteTable".
+		std::string path;
+		uint32_t depth;
+		double milliseconds;
+	};
+
+private:
+	struct Scope {
+		std::string path;
+		uint32_t depth;
+		uint32_t beginQuery;
+		uint32_t endQuery;
+	};
+
+	struct FrameQueries {
+		std::vector<Scope> scopes;
+		// Query objects owned by this slot, reused from frame to frame.
+		std::vector<uint32_t> pool;
+		uint32_t used = 0;
+		uint32_t frameNumber = 0;
+		bool pending = false;
+	};
+
+	static const uint32_t FRAME_LATENCY = 4;
+
+	FrameQueries m_frames[FRAME_LATENCY];
+	uint32_t m_currentFrame;
+	// Indices into the current frame's scopes of the ones still open.
+	std::vector<uint32_t> m_openScopes;
+	std::vector<ScopeTiming> m_latest;
+	// The number of the frame m_latest was measured in, or -1 before the first readback.
+	int64_t m_latestFrame;
+	uint32_t m_droppedFrames;
+
+	uint32_t nextQuery(FrameQueries& frame);
+	void collect(FrameQueries& frame);
+
+public:
+	GpuProfiler();
+	~GpuProfiler();
+
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	/**
+	 * @brief Starts a frame, first reading back the oldest frame in the ring.
+	 */
+	void beginFrame();
+	void endFrame();
+
+	void beginScope(const std::string& name);
+	void endScope();
+
+	/**
+	 * @brief The timings of the most recently completed frame, in the order scopes began.
+	 */
+	const std::vector<ScopeTiming>& latestTimings() const { return m_latest; }
+	int64_t latestFrame() const { return m_latestFrame; }
+
+	/**
+	 * @brief A one-line summary of the latest frame's top-level passes, for the window title.
+	 */
+	std::string summary() const;
+
+	/**
+	 * @brief Frames whose results weren't ready when their slot came around again, and were skipped.
+	 */
+	uint32_t droppedFrames() const { return m_droppedFrames; }
+};
+
+/**
+ * @brief Times the enclosing block as a scope of a profiler, if there is one.
+ */
+class GpuScope {
+private:
+	GpuProfiler* m_profiler;
+
+public:
+	GpuScope(GpuProfiler* profiler, const std::string& name) : m_profiler(profiler) {
+		if (m_profiler) {
+			m_profiler->beginScope(name);
+		}
+	}
+	~GpuScope() {
+		if (m_profiler) {
+			m_profiler->endScope();
+		}
+	}
+
+	GpuScope(const GpuScope&) = delete;
+	GpuScope& operator=(const GpuScope&) = delete;
+};
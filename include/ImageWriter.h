@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+
+/**
+ * @brief Writes tightly-packed RGBA8 pixels, top row first, to a PNG file, Paeth-filtered and
+ * compressed at zlib's fastest level.
+ */
+void writePng(const std::filesystem::path& path, const uint8_t* rgba, uint32_t width, uint32_t height);
+
+/**
+ * @brief Writes tightly-packed linear RGB floats, top row first, to an uncompressed OpenEXR file
+ * with 32-bit float channels, for output that must keep values above 1.
+ */
+void writeExr(const std::filesystem::path& path, const float* rgb, uint32_t width, uint32_t height);
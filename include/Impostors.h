@@ -0,0 +1,105 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <unordered_set>
+#include <vector>
+#include "Object3D.h"
+#include "ShaderProgram.h"
+
+/**
+ * @brief Replaces distant props with camera-facing quads textured from a pre-rendered atlas.
+ *
+ * Each prop type is rendered once at load time from a grid of view directions laid out with an
+ * octahedral mapping of the sphere, into a colour atlas and a normal + depth atlas. Every frame,
+ * instances beyond the impostor distance skip their full meshes and are drawn instead with one
+ * instanced quad draw per prop type, lit with the stored normals and depth-corrected so they still
+ * intersect the rest of the scene properly.
+ */
+class ImpostorRenderer {
+private:
+	// Per-instance attributes, matching the inputs of impostor.vert.
+	struct InstanceData {
+		glm::vec4 centerRadius;
+		glm::mat3 rotation;
+	};
+
+	struct Prop {
+		uint32_t colorTexture;
+		uint32_t normalDepthTexture;
+		// The bounding sphere in the prop's local space, i.e. before its model matrix.
+		glm::vec3 localCenter;
+		float localRadius;
+		std::vector<const Object3D*> instances;
+		std::vector<InstanceData> distant;
+		uint32_t instanceBuffer;
+		uint32_t instanceCapacity;
+		uint32_t vao;
+	};
+
+	ShaderProgram m_bakeShader;
+	ShaderProgram m_impostorShader;
+	float m_distance;
+	uint32_t m_framesPerSide;
+	uint32_t m_frameSize;
+	std::vector<Prop> m_props;
+	std::unordered_set<const Object3D*> m_replaced;
+
+	void bake(Object3D& prototype, Prop& prop);
+
+public:
+	/**
+	 * @brief Creates an empty renderer.
+	 * @param bakeShader renders a prop's albedo, local normal and depth into the atlases.
+	 * @param impostorShader draws the instanced quads.
+	 * @param distance instances whose bounding sphere center is farther than this from the camera
+	 * are drawn as impostors.
+	 * @param framesPerSide the atlas holds framesPerSide^2 views of each prop.
+	 * @param frameSize the size of one view in texels.
+	 */
+	ImpostorRenderer(const ShaderProgram& bakeShader, const ShaderProgram& impostorShader, float distance,
+		uint32_t framesPerSide = 8, uint32_t frameSize = 128);
+	~ImpostorRenderer();
+
+	ImpostorRenderer(const ImpostorRenderer&) = delete;
+	ImpostorRenderer& operator=(const ImpostorRenderer&) = delete;
+
+	/**
+	 * @brief Bakes the atlases of a new prop type from the given object, which becomes its first
+	 * instance. Restores the previous framebuffer and viewport afterwards.
+	 * @return the index of the prop type, for addInstance.
+	 */
+	uint32_t addProp(Object3D& prototype);
+
+	/**
+	 * @brief Adds another object that looks like the given prop type, e.g. a copy of its prototype.
+	 * The object must stay at the same address for as long as the renderer is used.
+	 */
+	void addInstance(uint32_t prop, const Object3D& instance);
+
+	/**
+	 * @brief Decides which instances are impostors from this camera position, and uploads their
+	 * per-instance data.
+	 */
+	void update(const glm::vec3& cameraPosition);
+
+	/**
+	 * @brief Whether the object is drawn as an impostor this frame, so its meshes should be skipped.
+	 */
+	bool isImpostor(const Object3D& object) const;
+
+	/**
+	 * @brief Draws every impostor, one instanced draw call per prop type.
+	 * @param material the ambient, diffuse, specular and shininess factors of the lighting shader.
+	 * @param lightDirection the direction light travels, matching the "directionalLight" uniform.
+	 */
+	void render(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition,
+		const glm::vec4& material, const glm::vec3& ambientColor, const glm::vec3& lightDirection,
+		const glm::vec3& lightColor);
+
+	/**
+	 * @brief The number of instances drawn as impostors this frame.
+	 */
+	size_t impostorCount() const { return m_replaced.size(); }
+
+	float distance() const { return m_distance; }
+	void setDistance(float distance) { m_distance = distance; }
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include <SFML/Window/Event.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+/**
+ * @brief Writes a session's input to a file as it's played: for every frame, the window events
+ * the frame handled, the time step it advanced the scene by, the number of physics steps that
+ * took, and a checksum of the simulation's state after them. Only the events the scene reacts to
+ * are kept: key presses, resizes and closing.
+ */
+class InputRecorder {
+private:
+	std::ofstream m_out;
+	std::vector<sf::Event> m_events;
+	uint32_t m_frames;
+
+public:
+	explicit InputRecorder(const std::filesystem::path& path);
+
+	/**
+	 * @brief Records an event handled during the current frame.
+	 */
+	void recordEvent(const sf::Event& event);
+
+	/**
+	 * @brief Finishes the current frame, writing it and its events out.
+	 */
+	void endFrame(float timeStep, uint32_t physicsSteps, uint64_t stateChecksum);
+
+	uint32_t framesRecorded() const { return m_frames; }
+};
+
+/**
+ * @brief Plays back a file written by InputRecorder, feeding the recorded events and time steps to
+ * the main loop in place of the window and the clock, so that the scene, the dice and the camera
+ * go through exactly the frames they did when it was recorded.
+ */
+class InputReplay {
+private:
+	struct Frame {
+		float timeStep;
+		uint32_t physicsSteps;
+		uint64_t stateChecksum;
+		uint32_t firstEvent;
+		uint32_t eventCount;
+	};
+
+	std::vector<Frame> m_frames;
+	std::vector<sf::Event> m_events;
+	size_t m_frame;
+	uint32_t m_nextEvent;
+	int64_t m_divergedAt;
+
+public:
+	/**
+	 * @brief Reads a recording, which must hold at least one frame.
+	 */
+	explicit InputReplay(const std::filesystem::path& path);
+
+	/**
+	 * @brief Pops the current frame's next recorded event, as sf::Window::pollEvent does.
+	 */
+	bool pollEvent(sf::Event& event);
+
+	/**
+	 * @brief The time step the current frame was recorded with.
+	 */
+	float timeStep() const { return m_frames[m_frame].timeStep; }
+
+	/**
+	 * @brief Moves on to the next frame, checking the frame just played took as many physics
+	 * steps, and left the simulation in the same state, as it did when recorded.
+	 */
+	void endFrame(uint32_t physicsSteps, uint64_t stateChecksum);
+
+	/**
+	 * @brief Whether every recorded frame has been played.
+	 */
+	bool finished() const { return m_frame >= m_frames.size(); }
+
+	/**
+	 * @brief The first frame whose physics steps or state didn't match the recording, or -1.
+	 */
+	int64_t divergedAt() const { return m_divergedAt; }
+
+	size_t frameCount() const { return m_frames.size(); }
+};
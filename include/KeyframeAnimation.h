@@ -0,0 +1,109 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Object3D.h"
+#include "Skeleton.h"
+
+enum class KeyframeInterpolation : uint8_t {
+	// Holds each key's value until the next key.
+	Step,
+	// Straight lines between keys; rotations take the shortest arc (SLERP).
+	Linear,
+	// Cubic Hermite curves through the keys, using each key's tangents.
+	CubicSpline,
+};
+
+/**
+ * @brief The keys of one property of one node, at times in seconds from the start of the clip.
+ * Cubic splines also carry each key's incoming and outgoing tangents, per second.
+ */
+template <typename T>
+struct KeyframeTrack {
+	KeyframeInterpolation interpolation = KeyframeInterpolation::Linear;
+	std::vector<float> times;
+	std::vector<T> values;
+	std::vector<T> inTangents;
+	std::vector<T> outTangents;
+};
+
+/**
+ * @brief A node's local translation, rotation and scale over a clip. Each track has at least one
+ * key; properties the clip doesn't animate hold the node's own value.
+ */
+struct NodeKeyframes {
+	std::string node;
+	KeyframeTrack<glm::vec3> translation;
+	KeyframeTrack<glm::quat> rotation;
+	KeyframeTrack<glm::vec3> scale;
+};
+
+/**
+ * @brief A named animation imported from a model file, e.g. a glTF animation.
+ */
+struct KeyframeClip {
+	std::string name;
+	float duration = 0;
+	std::vector<NodeKeyframes> nodes;
+};
+
+/**
+ * @brief Plays a keyframe clip on a model's node hierarchy, replacing each animated node's base
+ * transform with the transform sampled from its tracks, or on a Skeleton's joints.
+ *
+ * Each track keeps a cursor on the key it last sampled. Playing forward only ever moves a cursor
+ * on to the next few keys, so a tick costs O(1) per track however long the clip; seeking, or
+ * looping back to the start, finds the key by binary search instead.
+ */
+class KeyframeSampler {
+private:
+	struct Binding {
+		uint32_t node;
+		// The object posed, or null to pose an animated joint of m_skeleton.
+		Object3D* object;
+		uint32_t joint;
+		uint32_t translationKey;
+		uint32_t rotationKey;
+		uint32_t scaleKey;
+	};
+
+	KeyframeClip m_clip;
+	Skeleton* m_skeleton;
+	std::vector<Binding> m_bindings;
+	float m_time;
+	bool m_looping;
+
+	void sample(bool forward);
+
+public:
+	/**
+	 * @brief Binds the clip's nodes to the objects with the same names under root, which must
+	 * outlive the sampler and stay where it is in memory. Nodes with no such object are ignored.
+	 * Starts at the beginning of the clip.
+	 */
+	KeyframeSampler(KeyframeClip clip, Object3D& root, bool looping = false);
+
+	/**
+	 * @brief Binds the clip's nodes to the joints with the same names, making them animated. The
+	 * skeleton must outlive the sampler and stay where it is in memory. Posing a skeleton only sets
+	 * its joints; evaluating it is up to the caller.
+	 */
+	KeyframeSampler(KeyframeClip clip, Skeleton& skeleton, bool looping = false);
+
+	/**
+	 * @brief Jumps to a time in the clip, in seconds, and poses the nodes there.
+	 */
+	void seek(float time);
+
+	/**
+	 * @brief Plays the clip forward by the given interval, in seconds. Stops at the end of the
+	 * clip, or wraps around to the start if looping.
+	 */
+	void advance(float dt);
+
+	float time() const { return m_time; }
+	const KeyframeClip& clip() const { return m_clip; }
+	bool finished() const { return !m_looping && m_time >= m_clip.duration; }
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <filesystem>
+#include <vector>
+#include "Object3D.h"
+#include "ThreadPool.h"
+
+/**
+ * @brief Lighting and quality settings for a lightmap bake.
+ */
+struct LightmapBakeSettings {
+	// The scene's lighting, matching the uniforms given to lighting.frag.
+	glm::vec3 lightDirection;
+	glm::vec3 lightColor;
+	glm::vec3 ambientColor;
+	// k_a, k_d, k_s, shininess. Only ambient and bounced light are baked; direct light and its
+	// specular stay real-time, so k_s and shininess are unused.
+	glm::vec4 material;
+
+	// Surface reflectance used for indirect bounces; textures are not sampled on the CPU.
+	float albedo = 0.5f;
+	// Lightmap density in texels per world unit, clamped to [minResolution, maxResolution].
+	float texelsPerUnit = 24;
+	uint32_t minResolution = 32;
+	uint32_t maxResolution = 256;
+	// Hemisphere rays per texel, shared between ambient occlusion and indirect light.
+	uint32_t samplesPerTexel = 64;
+	// How many times indirect light bounces; 0 bakes occluded ambient light only.
+	uint32_t bounces = 1;
+	// Hits further away than this don't occlude the ambient term.
+	float occlusionDistance = 0.5f;
+};
+
+/**
+ * @brief Bakes ambient and indirect lighting for every static object's meshes that have lightmap coordinates, writes
+ * each lightmap into the given directory, and attaches them to the meshes.
+ *
+ * Rays are traced on the CPU against a BVH of all static geometry; dynamic objects neither
+ * occlude nor receive baked light.
+ */
+void bakeLightmaps(std::vector<Object3D>& objects, const LightmapBakeSettings& settings, ThreadPool& pool,
+	const std::filesystem::path& directory);
+
+/**
+ * @brief Attaches previously baked lightmaps from the given directory to the static objects'
+ * meshes. Lightmaps that are missing, don't match their mesh, or were baked with the mesh
+ * elsewhere or under different settings are skipped.
+ * @return the number of lightmaps loaded.
+ */
+uint32_t loadLightmaps(std::vector<Object3D>& objects, const LightmapBakeSettings& settings,
+	const std::filesystem::path& directory);
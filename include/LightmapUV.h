@@ -0,0 +1,13 @@
+#pragma once
+#include <vector>
+#include "Mesh3D.h"
+
+/**
+ * @brief Generates non-overlapping lightmap coordinates (u2, v2) in [0, 1] for a mesh.
+ *
+ * Triangles are grouped into charts of connected faces that share a dominant axis, each chart is
+ * projected onto that axis's plane, and the charts are shelf-packed with padding into one square.
+ * Vertices shared by different charts are duplicated, so both arrays may be rewritten.
+ * @return the index each rewritten vertex had before, for carrying other per-vertex data along.
+ */
+std::vector<uint32_t> generateLightmapUVs(std::vector<Vertex3D>& vertices, std::vector<uint32_t>& faces);
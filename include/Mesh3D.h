@@ -1,6 +1,8 @@
 #pragma once
 #include <glm/ext.hpp>
 #include <glad/glad.h>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "Texture.h"
@@ -17,17 +19,70 @@ struct Vertex3D {
 	float u;
 	float v;
 
+	// Lightmap coordinates: a second, non-overlapping UV set. Zero unless generated.
+	float u2;
+	float v2;
+
 	Vertex3D(float px, float py, float pz, float normX, float normY, float normZ,
-		float texU, float texV) :
-		x(px), y(py), z(pz), nx(normX), ny(normY), nz(normZ), u(texU), v(texV) {}
+		float texU, float texV, float lightU = 0, float lightV = 0) :
+		x(px), y(py), z(pz), nx(normX), ny(normY), nz(normZ), u(texU), v(texV), u2(lightU), v2(lightV) {}
+};
+
+/**
+ * @brief The non-position attributes of a Vertex3D. Meshes split their vertices into a
+ * position-only stream and a stream of these, so depth-only passes fetch nothing but positions.
+ */
+struct VertexAttributes3D {
+	float nx;
+	float ny;
+	float nz;
+
+	float u;
+	float v;
+
+	float u2;
+	float v2;
+};
+
+/**
+ * @brief The joints that move a skinned vertex: up to four, indexing the mesh's joint list, with
+ * weights quantised to bytes that add up to 255.
+ */
+struct VertexSkin {
+	uint8_t joints[4];
+	uint8_t weights[4];
+};
+
+/**
+ * @brief A CPU-side copy of a mesh's vertices and triangle indices, kept after upload for work
+ * like lightmap baking that needs the geometry. Shared between copies of a mesh.
+ */
+struct MeshGeometry {
+	std::vector<Vertex3D> vertices;
+	std::vector<uint32_t> faces;
+
+	// Skinned meshes only: each vertex's joints, and the joints themselves, by node name, with
+	// the matrices that take the mesh's bind pose into each joint's space.
+	std::vector<VertexSkin> skin;
+	std::vector<std::string> jointNames;
+	std::vector<glm::mat4> inverseBindMatrices;
 };
 
 class Mesh3D {
 private:
 	uint32_t m_vao;
+	// A second vertex array that only reads the position stream, for depth-only passes.
+	uint32_t m_depthVao;
 	std::vector<Texture> m_textures;
 	uint32_t m_vertexCount;
 	uint32_t m_faceCount;
+	std::shared_ptr<const MeshGeometry> m_geometry;
+	// The vertices as last skinned on the CPU, if ever.
+	std::shared_ptr<const MeshGeometry> m_posedGeometry;
+	bool m_hasLightMap;
+	bool m_hasVertexOcclusion;
+	// The per-vertex occlusion buffer, once attached; owned by this mesh.
+	uint32_t m_occlusionVbo;
 
 public:
 	Mesh3D() = delete;
@@ -44,8 +99,52 @@ public:
 	Mesh3D(std::vector<Vertex3D>&& vertices, std::vector<uint32_t>&& faces,
 		std::vector<Texture>&& textures);
 
+	~Mesh3D();
+	Mesh3D(const Mesh3D&) = delete;
+	Mesh3D& operator=(const Mesh3D&) = delete;
+	Mesh3D(Mesh3D&& other) noexcept;
+	Mesh3D& operator=(Mesh3D&& other) noexcept;
+
 	void addTexture(Texture texture);
 
+	/**
+	 * @brief Attaches a baked lightmap, which replaces real-time lighting for this mesh.
+	 */
+	void setLightMap(Texture lightMap);
+
+	/**
+	 * @brief Attaches per-vertex ambient occlusion, one byte per vertex (255 = unoccluded).
+	 */
+	void setVertexOcclusion(const std::vector<uint8_t>& occlusion);
+
+	/**
+	 * @brief Makes the mesh skinned: each vertex follows up to four of the given joints. Skinned
+	 * meshes are drawn by a SkinnedModel, in a skinning shader, rather than by their objects.
+	 */
+	void setSkin(std::vector<VertexSkin>&& skin, std::vector<std::string>&& jointNames,
+		std::vector<glm::mat4>&& inverseBindMatrices);
+
+	bool isSkinned() const { return !m_geometry->skin.empty(); }
+
+	/**
+	 * @brief Replaces the posed vertices that posedGeometry() returns, e.g. after skinning them on
+	 * the CPU.
+	 */
+	void setPosedVertices(std::vector<Vertex3D>&& vertices);
+
+	/**
+	 * @brief The mesh's vertices and faces, as they were uploaded.
+	 */
+	const MeshGeometry& geometry() const { return *m_geometry; }
+
+	/**
+	 * @brief The mesh as it's currently posed, for CPU renderers: the last vertices given to
+	 * setPosedVertices(), or the uploaded ones if none were.
+	 */
+	const MeshGeometry& posedGeometry() const { return m_posedGeometry ? *m_posedGeometry : *m_geometry; }
+
+	const std::vector<Texture>& textures() const { return m_textures; }
+
 	/**
 	 * @brief Constructs a 1x1 square centered at the origin in world space.
 	*/
@@ -58,5 +157,11 @@ public:
 	 * @param proj the view->clip projection matrix.
 	*/
 	void render(ShaderProgram& program) const;
+
+	/**
+	 * @brief Renders only the positions of the mesh, with no textures bound. Used to lay down
+	 * depth before the shaded pass.
+	*/
+	void renderDepth() const;
 	
 };
@@ -1,5 +1,7 @@
 #pragma once
+#include <functional>
 #include <memory>
+#include <glm/gtc/quaternion.hpp>
 #include "ShaderProgram.h"
 #include "Mesh3D.h"
 class Object3D {
@@ -10,7 +12,7 @@ private:
 
 	// The object's position, orientation, and scale in world space.
 	glm::vec3 m_position;
-	glm::vec3 m_orientation;
+	glm::quat m_orientation;
 	glm::vec3 m_scale;
 	glm::vec3 m_center;
 
@@ -29,21 +31,26 @@ private:
 	// Some objects from Assimp imports have a "name" field, useful for debugging.
 	std::string m_name;
 
+	// Static objects never move, so their shadows can be cached.
+	bool m_isStatic = false;
+
 	// Recomputes the local->world transformation matrix.
 	glm::mat4 buildModelMatrix() const;
 
 
 public:
-	bool isMoving;
+	// Whether a simulation is moving the object; false once its rigid body falls asleep.
+	bool isMoving = false;
 	// No default constructor; you must have a mesh to initialize an object.
 	Object3D() = delete;
 
+	Object3D(Mesh3D&& mesh);
 	Object3D(std::vector<Mesh3D>&& meshes);
 	Object3D(std::vector<Mesh3D>&& meshes, const glm::mat4& baseTransform);
 
 	// Simple accessors.
 	const glm::vec3& getPosition() const;
-	const glm::vec3& getOrientation() const;
+	const glm::quat& getOrientation() const;
 	const glm::vec3& getScale() const;
 	const glm::vec3& getCenter() const;
 	const std::string& getName() const;
@@ -51,6 +58,9 @@ public:
 	const glm::vec3& getVelocity() const;
 	const glm::vec3& getAngularVelocity() const;
 	const float getBounceCoeff() const;
+	bool isStatic() const;
+	// The local->world transformation of this object, excluding any parent.
+	glm::mat4 getModelMatrix() const;
 
 
 	// Child management.
@@ -58,10 +68,18 @@ public:
 	const Object3D& getChild(size_t index) const;
 	Object3D& getChild(size_t index);
 
+	// Mesh access.
+	size_t numberOfMeshes() const;
+	Mesh3D& getMesh(size_t index);
+	void visitMeshes(const std::function<void(Mesh3D& mesh, const glm::mat4& model)>& visitor,
+		const glm::mat4& parentMatrix = glm::mat4(1));
+
 
 	// Simple mutators.
 	void setPosition(const glm::vec3& position);
-	void setOrientation(const glm::vec3& orientation);
+	void setOrientation(const glm::quat& orientation);
+	// Sets the orientation from Euler angles, applied as Rz * Rx * Ry.
+	void setOrientation(const glm::vec3& eulerAngles);
 	void setScale(const glm::vec3& scale);
 	void setCenter(const glm::vec3& center);
 	void setName(const std::string& name);
@@ -70,16 +88,23 @@ public:
 	void setVelocity(const glm::vec3& velocity);
 	void setAngularVelocity(const glm::vec3& angularVelocity);
 	void setBounceCoeff(const float bounceCoeff);
+	void setStatic(bool isStatic);
+	// Replaces the transform imported with the object, e.g. to pose it from a keyframe clip.
+	void setBaseTransform(const glm::mat4& baseTransform);
 
 	// Transformations.
 	void move(const glm::vec3& offset);
-	void rotate(const glm::vec3& rotation);
+	// Turns the object about its own axes.
+	void rotate(const glm::quat& rotation);
+	void rotate(const glm::vec3& eulerAngles);
 	void grow(const glm::vec3& growth);
 	void addChild(Object3D&& child);
 
 	// Rendering.
 	void render(ShaderProgram& shaderProgram) const;
 	void renderRecursive(ShaderProgram& shaderProgram, const glm::mat4& parentMatrix) const;
+	void renderDepth(ShaderProgram& shaderProgram) const;
+	void renderDepthRecursive(ShaderProgram& shaderProgram, const glm::mat4& parentMatrix) const;
 
 	// physics
 	void tick(float dt);
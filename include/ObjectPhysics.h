@@ -0,0 +1,44 @@
+#pragma once
+#include <filesystem>
+#include <vector>
+#include "CollisionShapes.h"
+#include "Object3D.h"
+#include "PhysicsWorld.h"
+#include "ThreadPool.h"
+
+/**
+ * @brief Ties a scene object to the rigid body that moves it.
+ */
+struct PhysicsBinding {
+	Object3D* object;
+	uint32_t body;
+	// From the object's rotation center to the body's center of mass, in the body's frame.
+	glm::vec3 pivotOffset;
+};
+
+/**
+ * @brief Appends the world-space triangles of an object hierarchy, as consecutive triples of
+ * vertices, for PhysicsWorld::setStaticGeometry.
+ */
+void appendCollisionTriangles(Object3D& object, std::vector<glm::vec3>& triangles);
+
+/**
+ * @brief Gives every static object a collision shape built from its world-space triangles, so
+ * the physics collides with a few convex hulls instead of the full render meshes. Shapes are baked
+ * per object into the given directory and reused as long as the object's triangles are unchanged.
+ * @return one shape per object, empty for objects that aren't static.
+ */
+std::vector<CollisionShape> cookCollisionShapes(std::vector<Object3D>& objects, const CollisionShapeSettings& settings,
+	ThreadPool& pool, const std::filesystem::path& cacheDirectory);
+
+/**
+ * @brief Adds a box body fitted to the object's world-space bounds, starting with the object's
+ * velocity, angular velocity and bounce coefficient. The object should be unrotated when it's
+ * bound, or the box will be loose.
+ */
+PhysicsBinding addBoxBody(PhysicsWorld& world, Object3D& object, float mass, float friction);
+
+/**
+ * @brief Moves and rotates the object to where its body is.
+ */
+void syncObject(const PhysicsWorld& world, const PhysicsBinding& binding);
@@ -0,0 +1,117 @@
+#pragma once
+#include <filesystem>
+#include <functional>
+#include <vector>
+#include "Bvh.h"
+#include "Object3D.h"
+#include "Sampling.h"
+#include "ThreadPool.h"
+
+/**
+ * @brief Lighting and quality settings for a path-traced render. The lights mirror the uniforms
+ * given to lighting.frag, so a render is a ground truth for the real-time image.
+ */
+struct PathTraceSettings {
+	glm::vec3 lightDirection;
+	glm::vec3 lightColor;
+	glm::vec3 ambientColor;
+	// k_a and k_d scale the ambient and directional terms, as in lighting.frag.
+	glm::vec4 material;
+
+	uint32_t width = 1200;
+	uint32_t height = 800;
+	float verticalFov = glm::radians(45.0f);
+	uint32_t samplesPerPixel = 256;
+	// Path length after the camera ray; later bounces are cut off by Russian roulette.
+	uint32_t maxBounces = 5;
+	uint32_t tileSize = 16;
+	// Ambient light reaches a point along hemisphere directions that are open for at least this far.
+	float occlusionDistance = 0.5f;
+};
+
+/**
+ * @brief An offline CPU path tracer over the imported scene. Meshes are flattened into one
+ * world-space triangle list behind a 4-wide SAH BVH, and their base color, metallic-roughness and
+ * normal map textures are read back into CPU images.
+ *
+ * Surfaces use a Lambert diffuse plus GGX specular BRDF. The directional light is sampled
+ * directly with a shadow ray at every bounce.
+ */
+class PathTracer {
+public:
+	/**
+	 * @brief A CPU copy of a texture, sampled bilinearly with repeat wrapping.
+	 */
+	struct Image {
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<glm::vec4> texels;
+
+		glm::vec4 sample(glm::vec2 uv) const;
+	};
+
+	struct Material {
+		// Indices into m_images, or -1 when the mesh doesn't have that texture.
+		int32_t baseColor = -1;
+		int32_t metallicRoughness = -1;
+		int32_t normalMap = -1;
+	};
+
+	// Shading data for each triangle, by its index in the BVH input.
+	struct TriangleShading {
+		glm::vec3 normals[3];
+		glm::vec2 uvs[3];
+		// World-space directions of +u and +v across the triangle, for normal mapping.
+		glm::vec3 tangent;
+		glm::vec3 bitangent;
+		uint32_t material;
+	};
+
+private:
+	PathTraceSettings m_settings;
+	WideBvh m_bvh;
+	std::vector<glm::vec3> m_geometricNormals;
+	std::vector<TriangleShading> m_shading;
+	std::vector<Material> m_materials;
+	std::vector<Image> m_images;
+
+	// The accumulated radiance of every pixel, top row first, and the samples it holds.
+	std::vector<glm::vec3> m_accumulation;
+	uint32_t m_samples;
+
+	/**
+	 * @brief Traces one path from the camera, returning the radiance it carries back.
+	 */
+	glm::vec3 radiance(Ray ray, Rng& rng) const;
+
+public:
+	/**
+	 * @brief Flattens the scene into the tracer's own representation. Needs a current OpenGL
+	 * context to read textures back from VRAM; tracing does not.
+	 */
+	PathTracer(std::vector<Object3D>& objects, const PathTraceSettings& settings);
+
+	/**
+	 * @brief Renders the view from a camera, progressively: every pass adds samples to each pixel in
+	 * parallel tiles, then hands the running image to `onPass` so it can be saved or shown.
+	 * @param onPass called after each pass with the samples per pixel so far.
+	 */
+	void render(const glm::vec3& cameraPosition, const glm::vec3& cameraDirection, ThreadPool& pool,
+		const std::function<void(uint32_t samples)>& onPass);
+
+	/**
+	 * @brief The current image as linear RGB floats, top row first.
+	 */
+	std::vector<float> linearImage() const;
+
+	/**
+	 * @brief The current image as RGBA8, top row first, clamped like the framebuffer would.
+	 */
+	std::vector<uint8_t> displayImage() const;
+
+	/**
+	 * @brief Renders and writes `<stem>.png` after every pass and `<stem>.exr` at the end.
+	 */
+	void renderToFiles(const glm::vec3& cameraPosition, const glm::vec3& cameraDirection, ThreadPool& pool,
+		const std::filesystem::path& stem);
+};
@@ -0,0 +1,9 @@
+#pragma once
+#include <string>
+
+/**
+ * @brief Times the sweep-and-prune broadphase against testing every pair, with 100, 1000 and
+ * 10000 boxes drifting over a floor (like chips and dice spread across tables), and writes the
+ * results as JSON. Runs without a window.
+ */
+void runBroadphaseBenchmark(const std::string& reportPath);
@@ -0,0 +1,183 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "Broadphase.h"
+#include "Bvh.h"
+#include "RigidBody.h"
+#include "ThreadPool.h"
+
+/**
+ * @brief Global parameters of the rigid-body simulation.
+ */
+struct PhysicsSettings {
+	glm::vec3 gravity = glm::vec3(0, -9.8f, 0);
+	// Sequential impulse passes over the contacts per step.
+	uint32_t solverIterations = 10;
+	// Fractions of velocity lost per second, so tumbling bodies eventually come to rest.
+	float linearDamping = 0.05f;
+	float angularDamping = 0.2f;
+	// Bodies slower than this (at their corners, for spin) for timeToSleep seconds fall asleep.
+	float sleepSpeed = 0.03f;
+	float timeToSleep = 0.5f;
+};
+
+/**
+ * @brief Simulates rigid boxes against each other and against static triangle geometry.
+ *
+ * Each step finds contacts between the boxes' corners and the static triangles (through a BVH)
+ * or the other boxes (for the pairs sweep-and-prune reports as close), then resolves them with
+ * sequential impulses: non-penetration with restitution, and Coulomb friction along two tangents.
+ * Velocities are updated before positions (semi-implicit Euler), which is stable at fixed steps
+ * like 1/120 s.
+ *
+ * Bodies flagged continuous that would move further than their own size in one step are swept
+ * against the static geometry first, and stopped where they would hit it, so large steps don't
+ * let them tunnel through a table or a card.
+ *
+ * Bodies that touch form islands, which share no bodies and are solved in parallel. An island
+ * falls asleep once all of its bodies have been nearly still for a while, and costs nothing
+ * until an awake body comes near it again.
+ *
+ * Bodies without mass are static: moving bodies collide with them as with the static geometry,
+ * but they never move, wake anything or join an island.
+ *
+ * Nothing here depends on OpenGL, so the simulation can run without a window.
+ */
+class PhysicsWorld {
+public:
+	/**
+	 * @brief A point where two bodies (or a body and the static geometry) touch.
+	 */
+	struct Contact {
+		// Always a moving body.
+		uint32_t bodyA;
+		// STATIC_BODY for contacts with the static geometry or a static body.
+		uint32_t bodyB;
+		glm::vec3 point;
+		// Points from B towards A.
+		glm::vec3 normal;
+		float penetration;
+	};
+
+	static const uint32_t STATIC_BODY = UINT32_MAX;
+
+private:
+	// A contact with everything the solver precomputes for it.
+	struct SolverContact {
+		Contact contact;
+		glm::vec3 tangent1;
+		glm::vec3 tangent2;
+		float normalMass;
+		float tangentMass1;
+		float tangentMass2;
+		float velocityBias;
+		float friction;
+		float normalImpulse;
+		float tangentImpulse1;
+		float tangentImpulse2;
+	};
+
+	// Bodies that touch each other, and the contacts among them, as ranges of m_islandBodies and
+	// m_islandContacts.
+	struct Island {
+		uint32_t firstBody;
+		uint32_t bodyCount;
+		uint32_t firstContact;
+		uint32_t contactCount;
+	};
+
+	PhysicsSettings m_settings;
+	ThreadPool* m_pool;
+	std::vector<RigidBody> m_bodies;
+	TriangleBvh m_staticGeometry;
+	// One proxy per body, with the same index.
+	SweepAndPrune m_broadphase;
+	std::vector<SolverContact> m_contacts;
+	// Scratch space for BVH queries.
+	std::vector<uint32_t> m_candidates;
+	float m_maxImpactSpeed;
+	std::atomic<uint32_t> m_sweptHits;
+	// Union-find parents of the awake bodies, while islands are built.
+	std::vector<uint32_t> m_islandParent;
+	std::vector<Island> m_islands;
+	std::vector<uint32_t> m_islandBodies;
+	std::vector<uint32_t> m_islandContacts;
+
+	uint32_t findIsland(uint32_t body);
+	void buildIslands();
+	void solveIsland(const Island& island, float dt);
+	float timeOfImpact(const RigidBody& body, const glm::vec3& motion) const;
+	void collideStatic(uint32_t body, float dt);
+	void collideBodies(uint32_t a, uint32_t b, float dt);
+	void addContact(const Contact& contact, float dt);
+	void solveContact(SolverContact& solver);
+
+public:
+	/**
+	 * @param pool if given, islands are solved on its workers; otherwise on the calling thread.
+	 */
+	explicit PhysicsWorld(const PhysicsSettings& settings = PhysicsSettings{}, ThreadPool* pool = nullptr);
+
+	/**
+	 * @brief Adds a body to the simulation.
+	 * @return its index, which stays valid for the lifetime of the world.
+	 */
+	uint32_t addBody(const RigidBody& body);
+
+	/**
+	 * @brief Replaces the static collision geometry with triangles given as consecutive triples
+	 * of world-space vertices.
+	 */
+	void setStaticGeometry(const std::vector<glm::vec3>& triangleVertices);
+
+	/**
+	 * @brief Advances the simulation by one step. Use a fixed dt for repeatable results.
+	 */
+	void step(float dt);
+
+	RigidBody& body(uint32_t index) { return m_bodies[index]; }
+	const RigidBody& body(uint32_t index) const { return m_bodies[index]; }
+	size_t bodyCount() const { return m_bodies.size(); }
+
+	/**
+	 * @brief Wakes a body, e.g. after moving it or changing its velocity by hand. A static body
+	 * stays asleep, but its bounds are updated.
+	 */
+	void wake(uint32_t index);
+
+	size_t awakeBodyCount() const;
+
+	/**
+	 * @brief A hash of every body's position and orientation, for checking that two runs went
+	 * through exactly the same states.
+	 */
+	uint64_t stateChecksum() const;
+
+	/**
+	 * @brief The number of continuous bodies stopped short of a surface in the last step.
+	 */
+	uint32_t sweptHitCount() const { return m_sweptHits.load(); }
+
+	/**
+	 * @brief The islands of awake bodies solved in the last step.
+	 */
+	size_t islandCount() const { return m_islands.size(); }
+
+	/**
+	 * @brief The contacts found in the last step.
+	 */
+	size_t contactCount() const { return m_contacts.size(); }
+
+	/**
+	 * @brief The pairs of bodies whose bounds overlapped in the last step.
+	 */
+	size_t candidatePairCount() const { return m_broadphase.pairs().size(); }
+
+	/**
+	 * @brief The fastest speed at which any two things hit each other in the last step, e.g. for
+	 * choosing when to play a sound.
+	 */
+	float maxImpactSpeed() const { return m_maxImpactSpeed; }
+};
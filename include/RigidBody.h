@@ -0,0 +1,58 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+/**
+ * @brief A rigid box, integrated by a PhysicsWorld. Positions are of the center of mass, and
+ * velocities are in world space.
+ */
+struct RigidBody {
+	glm::vec3 position;
+	glm::quat orientation;
+	glm::vec3 linearVelocity;
+	glm::vec3 angularVelocity;
+
+	// The collision box, centered on the center of mass and aligned with the body's axes.
+	glm::vec3 halfExtents;
+	// Zero for static bodies, which never move and are never awake.
+	float inverseMass;
+	// The diagonal of the inverse inertia tensor along the body's axes.
+	glm::vec3 inverseInertia;
+
+	float restitution;
+	float friction;
+
+	// Fast bodies are swept along their motion each step, so they can't skip through thin surfaces.
+	bool continuous = false;
+
+	// Sleeping bodies are skipped by the simulation until something wakes them.
+	bool awake = true;
+	// How long the body has been moving slowly enough to sleep, in seconds.
+	float restingTime = 0;
+
+	/**
+	 * @brief A solid box of uniform density, at rest. A mass of zero makes it static.
+	 */
+	static RigidBody box(const glm::vec3& halfExtents, float mass, const glm::vec3& position,
+		const glm::quat& orientation = glm::quat(1, 0, 0, 0));
+
+	/**
+	 * @brief The inverse inertia tensor rotated into world space.
+	 */
+	glm::mat3 inverseInertiaWorld() const;
+
+	/**
+	 * @brief The velocity of the body at a point in world space.
+	 */
+	glm::vec3 velocityAt(const glm::vec3& point) const;
+
+	/**
+	 * @brief Applies an impulse at a point in world space, changing both velocities.
+	 */
+	void applyImpulse(const glm::vec3& impulse, const glm::vec3& point);
+
+	/**
+	 * @brief Advances the position and orientation by the current velocities.
+	 */
+	void integrate(float dt);
+};
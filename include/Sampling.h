@@ -0,0 +1,101 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cmath>
+#include <cstdint>
+
+/**
+ * @brief A small, fast random generator (xorshift32), cheap enough to give every texel, vertex
+ * or pixel its own deterministic stream.
+ */
+struct Rng {
+	uint32_t state;
+
+	explicit Rng(uint32_t seed) : state(seed * 747796405u + 2891336453u) {
+		if (state == 0) {
+			state = 1;
+		}
+	}
+
+	/**
+	 * @brief A uniform float in [0, 1).
+	 */
+	float next() {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return (state >> 8) * (1.0f / 16777216.0f);
+	}
+};
+
+/**
+ * @brief A counter-based random generator (Philox4x32-10, Salmon et al. 2011). The numbers of a
+ * stream are a pure function of its key, its index and a counter, so any stream can be regenerated
+ * on its own, on any thread, without replaying the ones before it.
+ */
+struct CounterRng {
+	uint32_t key[2];
+	uint32_t counter[4];
+	uint32_t block[4];
+	uint32_t used;
+
+	CounterRng(uint64_t key, uint64_t stream)
+		: key{ static_cast<uint32_t>(key), static_cast<uint32_t>(key >> 32) },
+		counter{ 0, 0, static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32) }, block{}, used(4) {
+	}
+
+	/**
+	 * @brief A uniform float in [0, 1).
+	 */
+	float next() {
+		if (used == 4) {
+			generate();
+			counter[0]++;
+			used = 0;
+		}
+		return (block[used++] >> 8) * (1.0f / 16777216.0f);
+	}
+
+private:
+	void generate() {
+		uint32_t x[4] = { counter[0], counter[1], counter[2], counter[3] };
+		uint32_t k[2] = { key[0], key[1] };
+		for (int round = 0; round < 10; round++) {
+			uint64_t product0 = uint64_t(0xD2511F53u) * x[0];
+			uint64_t product1 = uint64_t(0xCD9E8D57u) * x[2];
+			uint32_t y[4] = { static_cast<uint32_t>(product1 >> 32) ^ x[1] ^ k[0], static_cast<uint32_t>(product1),
+				static_cast<uint32_t>(product0 >> 32) ^ x[3] ^ k[1], static_cast<uint32_t>(product0) };
+			for (int i = 0; i < 4; i++) {
+				x[i] = y[i];
+			}
+			k[0] += 0x9E3779B9u;
+			k[1] += 0xBB67AE85u;
+		}
+		for (int i = 0; i < 4; i++) {
+			block[i] = x[i];
+		}
+	}
+};
+
+/**
+ * @brief Builds two unit vectors that, with the unit normal, form an orthonormal basis
+ * (Duff et al. 2017).
+ */
+inline void orthonormalBasis(const glm::vec3& normal, glm::vec3& tangent, glm::vec3& bitangent) {
+	float sign = std::copysign(1.0f, normal.z);
+	float a = -1.0f / (sign + normal.z);
+	float b = normal.x * normal.y * a;
+	tangent = glm::vec3(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+	bitangent = glm::vec3(b, sign + normal.y * normal.y * a, -normal.y);
+}
+
+/**
+ * @brief A cosine-weighted direction in the hemisphere around the unit normal.
+ */
+inline glm::vec3 cosineSample(const glm::vec3& normal, Rng& rng) {
+	float phi = glm::two_pi<float>() * rng.next();
+	float r2 = rng.next();
+	float r = std::sqrt(r2);
+	glm::vec3 tangent, bitangent;
+	orthonormalBasis(normal, tangent, bitangent);
+	return tangent * (r * std::cos(phi)) + bitangent * (r * std::sin(phi)) + normal * std::sqrt(1 - r2);
+}
@@ -10,6 +10,12 @@ public:
 
 	void activate();
 
+	/**
+	 * @brief Has the program read a uniform block from the buffer bound to the given binding
+	 * point. Programs without the block ignore this.
+	 */
+	void bindUniformBlock(const std::string& blockName, uint32_t binding);
+
 	void setUniform(const std::string& uniformName, bool value);
 	void setUniform(const std::string& uniformName, int32_t value);
 	void setUniform(const std::string& uniformName, float value);
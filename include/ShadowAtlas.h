@@ -0,0 +1,85 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <vector>
+#include "Object3D.h"
+#include "ShaderProgram.h"
+
+/**
+ * @brief A depth atlas of shadow maps, one square tile per shadow-casting light.
+ *
+ * Static objects are rendered into a cached copy of the atlas only when a light or the static
+ * geometry changes. Each frame the cached depth is copied into the sampled atlas and only the
+ * dynamic objects are rendered on top, so the per-frame cost tracks what moves.
+ */
+class ShadowAtlas {
+private:
+	struct Light {
+		glm::mat4 view;
+		glm::mat4 projection;
+	};
+
+	uint32_t m_size;
+	uint32_t m_tilesPerSide;
+	std::vector<Light> m_lights;
+	bool m_staticDirty;
+
+	// The cached static depth, and the atlas the lighting shader samples from.
+	uint32_t m_staticTexture;
+	uint32_t m_staticFramebuffer;
+	uint32_t m_texture;
+	uint32_t m_framebuffer;
+
+	void setLight(uint32_t index, const Light& light);
+	void setTileViewport(uint32_t index) const;
+	void renderCasters(ShaderProgram& depthShader, const std::vector<Object3D>& objects,
+		bool staticObjects) const;
+
+public:
+	/**
+	 * @brief Creates an atlas of the given size in texels, holding up to tilesPerSide^2 lights.
+	 */
+	ShadowAtlas(uint32_t size, uint32_t tilesPerSide);
+	~ShadowAtlas();
+
+	ShadowAtlas(const ShadowAtlas&) = delete;
+	ShadowAtlas& operator=(const ShadowAtlas&) = delete;
+
+	/**
+	 * @brief Sets tile `index` to an orthographic shadow of a directional light that covers a
+	 * sphere around the scene. The static cache is only invalidated if the light actually changed.
+	 * @param direction the direction light travels, matching the "directionalLight" uniform.
+	 */
+	void setDirectionalLight(uint32_t index, const glm::vec3& direction, const glm::vec3& sceneCenter,
+		float sceneRadius);
+
+	/**
+	 * @brief Sets tile `index` to a perspective shadow of a spot light.
+	 * @param outerAngle the half-angle of the spot cone, in radians.
+	 */
+	void setSpotLight(uint32_t index, const glm::vec3& position, const glm::vec3& direction,
+		float outerAngle, float range);
+
+	/**
+	 * @brief Forces the static casters to be re-rendered, e.g. after a static object is moved.
+	 */
+	void invalidateStatic();
+
+	/**
+	 * @brief Brings the atlas up to date: re-renders static casters if needed, then composites
+	 * the dynamic casters on top. Restores the previous framebuffer and viewport afterwards.
+	 */
+	void render(ShaderProgram& depthShader, const std::vector<Object3D>& objects);
+
+	/**
+	 * @brief The world->atlas transformation for a light, mapping to atlas texture coordinates
+	 * in xy and compare depth in z.
+	 */
+	glm::mat4 lightSpaceMatrix(uint32_t index) const;
+
+	/**
+	 * @brief The atlas-space bounds (min uv, max uv) of a light's tile, so PCF taps stay inside it.
+	 */
+	glm::vec4 tileBounds(uint32_t index) const;
+
+	uint32_t textureId() const { return m_texture; }
+};
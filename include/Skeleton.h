@@ -0,0 +1,73 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Object3D.h"
+
+/**
+ * @brief The joint hierarchy of a model, posed by setting animated joints' local transforms and
+ * evaluated into each joint's transform relative to the model.
+ *
+ * Every object in the model is a joint, in depth-first order so that parents come before their
+ * children. Joints nothing animates keep the transforms they were imported with. Evaluating
+ * first turns all the animated joints' translations, rotations and scales into matrices in one
+ * straight structure-of-arrays loop the compiler vectorizes, then walks the hierarchy once.
+ */
+class Skeleton {
+private:
+	std::vector<std::string> m_names;
+	// Each joint's parent, or -1 for the root.
+	std::vector<int32_t> m_parents;
+	std::vector<glm::mat4> m_local;
+	std::vector<glm::mat4> m_world;
+
+	// The animated joints and their local transforms.
+	std::vector<uint32_t> m_animatedJoints;
+	std::vector<float> m_translationX, m_translationY, m_translationZ;
+	std::vector<float> m_rotationW, m_rotationX, m_rotationY, m_rotationZ;
+	std::vector<float> m_scaleX, m_scaleY, m_scaleZ;
+	// The animated joints' local matrices, less the constant bottom row: three rows of each of
+	// the four columns.
+	std::array<std::vector<float>, 12> m_matrices;
+
+	void addJoints(const Object3D& object, int32_t parent);
+
+public:
+	/**
+	 * @brief Takes the hierarchy of a model, e.g. one from assimpLoad(). Transforms are relative to
+	 * the model's root, so the root's own transform is left to whatever draws the model.
+	 */
+	explicit Skeleton(const Object3D& root);
+
+	/**
+	 * @brief The joint with the given name, or -1 if there is none.
+	 */
+	int32_t find(const std::string& name) const;
+
+	size_t jointCount() const { return m_names.size(); }
+
+	/**
+	 * @brief Makes a joint animated, starting from no translation, rotation or scaling.
+	 * @return its index among the animated joints, for setPose().
+	 */
+	uint32_t animate(uint32_t joint);
+
+	/**
+	 * @brief Sets an animated joint's local transform, which takes effect at the next evaluate().
+	 */
+	void setPose(uint32_t animatedJoint, const glm::vec3& translation, const glm::quat& rotation,
+		const glm::vec3& scale);
+
+	/**
+	 * @brief Recomputes every joint's transform relative to the model from the current pose.
+	 */
+	void evaluate();
+
+	/**
+	 * @brief Each joint's transform relative to the model, as of the last evaluate().
+	 */
+	const std::vector<glm::mat4>& world() const { return m_world; }
+};
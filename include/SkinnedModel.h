@@ -0,0 +1,140 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "KeyframeAnimation.h"
+#include "Object3D.h"
+#include "ShaderProgram.h"
+#include "Skeleton.h"
+
+// The most joints one skinned mesh may use; the skinning shaders' palette holds this many.
+const uint32_t MAX_SKIN_JOINTS = 128;
+
+/**
+ * @brief A uniform buffer holding one skinned mesh's joint matrices at a time, bound to a fixed
+ * binding point that skinning shaders read their "Skin" block from.
+ */
+class SkinPaletteBuffer {
+private:
+	uint32_t m_buffer;
+	uint32_t m_binding;
+
+public:
+	explicit SkinPaletteBuffer(uint32_t binding = 0);
+	~SkinPaletteBuffer();
+
+	SkinPaletteBuffer(const SkinPaletteBuffer&) = delete;
+	SkinPaletteBuffer& operator=(const SkinPaletteBuffer&) = delete;
+
+	/**
+	 * @brief Replaces the palette, for the draws that follow.
+	 */
+	void upload(const std::vector<glm::mat4>& palette);
+
+	uint32_t binding() const { return m_binding; }
+};
+
+/**
+ * @brief Skins a mesh's vertices on the CPU, as the skinning shader does on the GPU.
+ */
+std::vector<Vertex3D> skinVertices(const MeshGeometry& geometry, const std::vector<glm::mat4>& palette);
+
+/**
+ * @brief Poses of one skeleton under clips, shared between the characters that play the same
+ * clip at the same moment so that a crowd in step costs one evaluation.
+ *
+ * Times are rounded to a resolution, and a pose stays cached until a frame goes by without any
+ * character asking for it. A pose nobody asked for this frame is moved on to the next time asked
+ * for, so a character playing forward keeps its keyframe cursors warm.
+ */
+class SkeletonPoseCache {
+private:
+	struct Entry {
+		const KeyframeClip* clip;
+		int64_t tick;
+		uint64_t frame;
+		Skeleton skeleton;
+		std::unique_ptr<KeyframeSampler> sampler;
+	};
+
+	Skeleton m_rest;
+	float m_resolution;
+	uint64_t m_frame;
+	std::vector<std::unique_ptr<Entry>> m_entries;
+
+public:
+	SkeletonPoseCache(const Skeleton& rest, float resolution = 0.001f);
+
+	/**
+	 * @brief Starts a new frame, dropping the poses no one asked for during the last one.
+	 */
+	void beginFrame();
+
+	/**
+	 * @brief The skeleton's joint transforms at a time in a clip, which must outlive the cache.
+	 */
+	const std::vector<glm::mat4>& pose(const KeyframeClip& clip, float time);
+
+	size_t poseCount() const { return m_entries.size(); }
+};
+
+/**
+ * @brief Draws the skinned meshes of a model, e.g. one from assimpLoad(), deformed by a pose of
+ * its skeleton. The model's other meshes draw with it as usual, while its skinned meshes are
+ * left to this.
+ *
+ * Each skinned mesh gets a palette of matrices, one per joint it uses, that take its bind pose to
+ * the posed joints and back into the mesh's own space. The GPU path uploads a mesh's palette
+ * before drawing it with the skinning shaders; the CPU path deforms copies of the vertices for
+ * renderers that read geometry, like the path tracer.
+ */
+class SkinnedModel {
+private:
+	struct SkinnedMesh {
+		Mesh3D* mesh;
+		// The joint the mesh hangs from, and the joints its vertices follow.
+		int32_t node;
+		std::vector<int32_t> joints;
+		std::vector<glm::mat4> palette;
+	};
+
+	Object3D* m_model;
+	Skeleton m_skeleton;
+	std::vector<SkinnedMesh> m_meshes;
+
+	void findMeshes(Object3D& object, int32_t& joint);
+	void renderMeshes(ShaderProgram& program, SkinPaletteBuffer& palettes, bool depthOnly) const;
+
+public:
+	/**
+	 * @brief Takes a model, which must outlive this and stay where it is in memory.
+	 */
+	explicit SkinnedModel(Object3D& model);
+
+	/**
+	 * @brief The model's skeleton in its rest pose, for building a SkeletonPoseCache or posing
+	 * with a KeyframeSampler.
+	 */
+	const Skeleton& skeleton() const { return m_skeleton; }
+
+	/**
+	 * @brief Poses the skinned meshes from joint transforms of this model's skeleton.
+	 */
+	void pose(const std::vector<glm::mat4>& jointTransforms);
+
+	/**
+	 * @brief Skins each mesh on the CPU in the current pose, into its posed geometry.
+	 */
+	void skinOnCpu();
+
+	/**
+	 * @brief Renders the skinned meshes with a skinning shader, e.g. skinned_perspective.vert.
+	 */
+	void render(ShaderProgram& program, SkinPaletteBuffer& palettes) const;
+
+	/**
+	 * @brief Renders only the depth of the skinned meshes, with skinned_depth_only.vert.
+	 */
+	void renderDepth(ShaderProgram& program, SkinPaletteBuffer& palettes) const;
+};
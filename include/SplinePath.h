@@ -0,0 +1,139 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief How a follower's speed changes over its run. Each is a cubic in the fraction of the run
+ * done, so followers with different easings still evaluate in one loop.
+ */
+enum class Easing : uint8_t {
+	Linear,
+	// Starts from rest and speeds up.
+	EaseIn,
+	// Slows to rest at the end.
+	EaseOut,
+	// Starts and ends at rest.
+	EaseInOut,
+};
+
+/**
+ * @brief A curve through space made of cubic Bezier segments end to end, measured by distance
+ * along it rather than by the segments' own parameters, so that moving along it at a steady
+ * rate of distance moves at a steady speed.
+ *
+ * A table of the distance along the curve at evenly spaced parameters is built once; finding the
+ * parameter at a distance is then a binary search and a linear blend.
+ */
+class SplinePath {
+private:
+	// Each segment's four control points, the last of one segment being the first of the next.
+	std::vector<glm::vec3> m_points;
+	// The distance along the path at every sample, SAMPLES_PER_SEGMENT samples per segment.
+	std::vector<float> m_distances;
+
+public:
+	static const uint32_t SAMPLES_PER_SEGMENT = 32;
+
+	/**
+	 * @brief Takes the control points of one or more segments: a start point, then two handles
+	 * and an end point per segment.
+	 */
+	explicit SplinePath(std::vector<glm::vec3> controlPoints);
+
+	/**
+	 * @brief A closed circle in a horizontal plane, made of four segments, starting on its +z
+	 * side and heading towards +x.
+	 */
+	static SplinePath circle(const glm::vec3& center, float radius);
+
+	uint32_t segmentCount() const { return static_cast<uint32_t>((m_points.size() - 1) / 3); }
+
+	float length() const { return m_distances.back(); }
+
+	/**
+	 * @brief The first control point of a segment; the segment's others follow it.
+	 */
+	const glm::vec3* segmentPoints(uint32_t segment) const { return &m_points[segment * 3]; }
+
+	/**
+	 * @brief Finds the segment, and the parameter within it, at a distance along the path.
+	 */
+	void locate(float distance, uint32_t& segment, float& parameter) const;
+
+	/**
+	 * @brief The point at a distance along the path.
+	 */
+	glm::vec3 pointAt(float distance) const;
+
+	/**
+	 * @brief The direction of travel at a distance along the path, of unit length.
+	 */
+	glm::vec3 directionAt(float distance) const;
+};
+
+/**
+ * @brief Many objects moving along paths, each from the start to the end of its path over its
+ * own duration with its own easing, stored as structure-of-arrays.
+ *
+ * Evaluating eases every follower's progress in one loop, finds each one's segment in the
+ * distance tables, then evaluates every follower's cubic in another straight loop the compiler
+ * vectorizes.
+ */
+class PathFollowers {
+private:
+	std::vector<SplinePath> m_paths;
+
+	std::vector<uint32_t> m_path;
+	std::vector<float> m_inverseDuration;
+	// The easing's cubic coefficients of t, t^2 and t^3.
+	std::vector<float> m_ease1, m_ease2, m_ease3;
+	std::vector<float> m_time;
+	std::vector<float> m_distance;
+	// The control points and parameter of the segment each follower is on.
+	std::vector<float> m_p0X, m_p0Y, m_p0Z;
+	std::vector<float> m_p1X, m_p1Y, m_p1Z;
+	std::vector<float> m_p2X, m_p2Y, m_p2Z;
+	std::vector<float> m_p3X, m_p3Y, m_p3Z;
+	std::vector<float> m_parameter;
+	std::vector<float> m_pointX, m_pointY, m_pointZ;
+
+public:
+	/**
+	 * @brief Adds a path for followers to share.
+	 * @return its index, for add().
+	 */
+	uint32_t addPath(SplinePath path);
+
+	/**
+	 * @brief Adds a follower at the start of a path.
+	 * @return its index.
+	 */
+	uint32_t add(uint32_t path, float duration, Easing easing = Easing::Linear);
+
+	/**
+	 * @brief Sets how far into its run a follower is, in seconds.
+	 */
+	void setTime(uint32_t follower, float time) { m_time[follower] = time; }
+
+	/**
+	 * @brief Moves every follower on by the given interval, in seconds.
+	 */
+	void advance(float dt);
+
+	/**
+	 * @brief Works out every follower's position at its current time.
+	 */
+	void evaluate();
+
+	/**
+	 * @brief Works out the positions of just the given followers, for when few of them moved.
+	 */
+	void evaluate(const std::vector<uint32_t>& followers);
+
+	glm::vec3 position(uint32_t follower) const {
+		return glm::vec3(m_pointX[follower], m_pointY[follower], m_pointZ[follower]);
+	}
+
+	size_t size() const { return m_path.size(); }
+};
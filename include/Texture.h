@@ -18,15 +18,23 @@ struct Texture {
 	 * @brief Loads an SFML Image into VRAM and returns a Texture object identifying it.
 	 */
 	static Texture loadImage(const StbImage& texture, const std::string& samplerName) {
+		return loadPixels(texture.getData(), texture.getWidth(), texture.getHeight(), samplerName, GL_REPEAT);
+	}
+
+	/**
+	 * @brief Loads tightly-packed RGBA8 pixels into VRAM and returns a Texture object identifying it.
+	 */
+	static Texture loadPixels(const unsigned char* rgba, int32_t width, int32_t height,
+		const std::string& samplerName, int32_t wrapMode) {
 		uint32_t texId;
 		glGenTextures(1, &texId);
 		glBindTexture(GL_TEXTURE_2D, texId);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture.getWidth(), texture.getHeight(), 0, GL_RGBA,
-			GL_UNSIGNED_BYTE, texture.getData());
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+			GL_UNSIGNED_BYTE, rgba);
 		glGenerateMipmap(GL_TEXTURE_2D);
 		glBindTexture(GL_TEXTURE_2D, 0);
 
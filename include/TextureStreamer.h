@@ -0,0 +1,103 @@
+#pragma once
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Object3D.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+
+/**
+ * @brief Keeps each texture's mip levels resident only as far as the camera needs them.
+ *
+ * The first time an image is loaded, its full mip chain is built on the CPU and cached on disk.
+ * After that, only the small tail of the chain is uploaded at startup. Each frame, visible meshes
+ * request the finest level their on-screen size calls for, and finer levels are read from the
+ * cache on the thread pool and uploaded a few at a time. Under a VRAM budget, the finest levels of
+ * the least recently used textures are evicted first.
+ *
+ * Textures keep their OpenGL ID for life, so meshes never notice levels coming and going; the
+ * texture's base level is moved to the finest resident level.
+ */
+class TextureStreamer {
+private:
+	struct MipLevel {
+		uint32_t width;
+		uint32_t height;
+		// Byte offset of the level's RGBA8 pixels in the cache file.
+		uint64_t offset;
+	};
+
+	struct StreamedTexture {
+		uint32_t textureId;
+		std::filesystem::path cachePath;
+		std::vector<MipLevel> levels;
+		// The finest level in VRAM, and the first level of the always-resident tail.
+		uint32_t residentBase;
+		uint32_t tailBase;
+		// The finest level requested this frame; levels.size() if nothing asked for it.
+		uint32_t wantedLevel;
+		uint64_t lastUsedFrame;
+		// An in-flight read of level residentBase - 1.
+		std::future<void> pendingRead;
+		std::shared_ptr<std::vector<uint8_t>> pendingPixels;
+	};
+
+	// A mesh's bounding sphere and texture-space density, measured once per mesh.
+	struct MeshFootprint {
+		glm::vec3 center;
+		float radius;
+		// Texture coordinate units per object-space unit.
+		float uvDensity;
+	};
+
+	ThreadPool& m_pool;
+	std::filesystem::path m_cacheDirectory;
+	uint64_t m_budgetBytes;
+	// All levels in VRAM, and just the ones above the tails, which count against the budget.
+	uint64_t m_residentBytes;
+	uint64_t m_streamedBytes;
+	uint64_t m_frame;
+	std::vector<StreamedTexture> m_textures;
+	std::unordered_map<uint32_t, uint32_t> m_byTextureId;
+	std::unordered_map<const MeshGeometry*, MeshFootprint> m_footprints;
+
+	void request(uint32_t textureId, float texelsPerPixelAtLevel0);
+	void uploadLevel(StreamedTexture& texture, uint32_t level, const uint8_t* pixels);
+	void evictLevel(StreamedTexture& texture);
+	bool makeRoom(uint64_t bytes);
+	static uint64_t levelBytes(const MipLevel& level);
+
+public:
+	/**
+	 * @param budgetBytes the VRAM that streamed levels may use, beyond each texture's resident tail.
+	 */
+	TextureStreamer(ThreadPool& pool, const std::filesystem::path& cacheDirectory, uint64_t budgetBytes);
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	/**
+	 * @brief Loads an image with only its coarsest mip levels resident, building its cached mip
+	 * chain first if needed.
+	 */
+	Texture load(const std::filesystem::path& imagePath, const std::string& samplerName);
+
+	/**
+	 * @brief Estimates the finest mip level each visible mesh's textures need, from the mesh's
+	 * projected size and texture density. Call once per frame, before update().
+	 */
+	void requestVisible(std::vector<Object3D>& objects, const glm::mat4& view, const glm::mat4& projection,
+		uint32_t viewportHeight);
+
+	/**
+	 * @brief Uploads finished reads, starts reads for levels that are wanted but missing, and
+	 * evicts to stay within the budget.
+	 */
+	void update();
+
+	uint64_t residentBytes() const { return m_residentBytes; }
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A fixed set of worker threads that run queued jobs. Used for CPU-heavy work like
+ * baking, so that it scales across cores without spawning threads per task.
+ */
+class ThreadPool {
+private:
+	std::vector<std::thread> m_workers;
+	std::deque<std::function<void()>> m_jobs;
+	std::mutex m_mutex;
+	std::condition_variable m_jobAvailable;
+	bool m_stopping;
+
+	void workerLoop();
+
+public:
+	/**
+	 * @brief Starts the given number of worker threads; by default, one per hardware thread.
+	 */
+	explicit ThreadPool(uint32_t threadCount = std::thread::hardware_concurrency());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	uint32_t threadCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+	/**
+	 * @brief Queues a job, returning a future that completes when the job has run.
+	 */
+	std::future<void> submit(std::function<void()> job);
+
+	/**
+	 * @brief Calls body(begin, end) over [0, count) in chunks of grainSize, on the workers and the
+	 * calling thread, and returns once every chunk has finished. Safe to call from inside a job.
+	 */
+	void parallelFor(uint32_t count, uint32_t grainSize,
+		const std::function<void(uint32_t begin, uint32_t end)>& body);
+};
@@ -0,0 +1,259 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <functional>
+#include <variant>
+#include <vector>
+#include "KeyframeAnimation.h"
+#include "Object3D.h"
+#include "SplinePath.h"
+
+/**
+ * @brief Holds the object still.
+ */
+struct PauseChannel {
+};
+
+/**
+ * @brief Turns the object about one of its own axes by a total angle, at a constant rate. The
+ * rotation is given as a vector along the axis, as long as the angle in radians.
+ */
+struct RotationChannel {
+	glm::vec3 totalRotation;
+};
+
+/**
+ * @brief Moves the object by a total offset, at a constant rate.
+ */
+struct TranslationChannel {
+	glm::vec3 totalOffset;
+};
+
+/**
+ * @brief Moves the object along a cubic Bezier curve, at a steady speed unless eased.
+ */
+struct BezierChannel {
+	glm::vec3 p0;
+	glm::vec3 p1;
+	glm::vec3 p2;
+	glm::vec3 p3;
+	Easing easing = Easing::Linear;
+};
+
+/**
+ * @brief Moves the object along a spline path from its start to its end, at a steady speed
+ * unless eased.
+ */
+struct PathChannel {
+	SplinePath path;
+	Easing easing = Easing::Linear;
+};
+
+/**
+ * @brief Plays a keyframe clip on the object's hierarchy, from its start, at normal speed.
+ */
+struct ClipChannel {
+	KeyframeClip clip;
+};
+
+using AnimationChannel = std::variant<PauseChannel, RotationChannel, TranslationChannel, BezierChannel, PathChannel, ClipChannel>;
+
+/**
+ * @brief A timeline of animations on scene objects: parallel tracks, each starting at its own
+ * time and playing its channels one after another, and events that fire as the playhead passes
+ * them.
+ *
+ * Channels are filed into a structure-of-arrays pool per kind when they're added, so moving the
+ * playhead never dispatches per animation: one pass over the tracks works out how far each
+ * channel it crosses moves, and each pool is then evaluated in its own straight loop. The
+ * channels that moved apply their results to contiguous copies of their objects' transforms,
+ * which are written back once per object at the end, however many channels moved it. Rotations
+ * and translations move by the difference, a rotation composing its object's quaternion with the
+ * turn it made, so the playhead can go backwards as well as forwards. Turns don't commute, so
+ * they're composed in the order their channels play, or the reverse going backwards, and a seek
+ * poses the objects as playing there would. Only rotations of one object that overlap in time
+ * can differ, by as much as turning them in small steps differs from one after the other.
+ *
+ * Playing forward only visits the channels the playhead is in or reaches, so tracks waiting to
+ * start, paused or finished cost nothing. Seeking visits every track, finding its channel, and
+ * the next event, by binary search.
+ */
+class Timeline {
+private:
+	enum class Kind : uint8_t {
+		Pause,
+		Rotation,
+		Translation,
+		Path,
+		Clip,
+	};
+
+	struct Segment {
+		uint32_t track;
+		Kind kind;
+		// The channel within its kind's pool.
+		uint32_t channel;
+		// When the segment starts, relative to its track's start.
+		float start;
+		float duration;
+		// When the segment starts on the timeline, once started.
+		float time;
+	};
+
+	struct Track {
+		float start;
+		float duration;
+		// The track's segments, in order, as a range of m_segments once started.
+		uint32_t firstSegment;
+		uint32_t segmentCount;
+		// The segment the playhead was last in.
+		uint32_t current;
+	};
+
+	struct Event {
+		float time;
+		std::function<void()> callback;
+	};
+
+	// A channel that ran for part of this tick, for how long; negative going backwards.
+	struct Run {
+		uint32_t channel;
+		float elapsed;
+	};
+
+	// A segment the playhead crossed part of in a seek, from and to a time within it.
+	struct Crossing {
+		uint32_t segment;
+		float before;
+		float after;
+	};
+
+	// Rotations turn about a fixed axis at a fixed rate, for the time they ran this tick.
+	struct RotationPool {
+		std::vector<uint32_t> target;
+		std::vector<float> axisX;
+		std::vector<float> axisY;
+		std::vector<float> axisZ;
+		// In radians per second.
+		std::vector<float> rate;
+		// In the order they played.
+		std::vector<Run> runs;
+
+		uint32_t add(uint32_t target, const glm::vec3& perSecond);
+	};
+
+	// Translations add a velocity times the time they ran this tick.
+	struct TranslationPool {
+		std::vector<uint32_t> target;
+		std::vector<float> perSecondX;
+		std::vector<float> perSecondY;
+		std::vector<float> perSecondZ;
+		std::vector<Run> runs;
+
+		uint32_t add(uint32_t target, const glm::vec3& perSecond);
+	};
+
+	// Paths set the position at the distance along them reached this tick.
+	struct PathPool {
+		PathFollowers followers;
+		std::vector<uint32_t> target;
+		// The paths that moved this tick.
+		std::vector<uint32_t> moved;
+
+		uint32_t add(uint32_t target, SplinePath path, float duration, Easing easing);
+	};
+
+	// Clips move their samplers to the time reached this tick.
+	struct ClipPool {
+		std::vector<KeyframeSampler> sampler;
+		std::vector<float> time;
+		std::vector<uint32_t> moved;
+
+		uint32_t add(Object3D& root, const ClipChannel& clip);
+	};
+
+	std::vector<Track> m_tracks;
+	std::vector<Segment> m_segments;
+	// The segments that do something, by when they start, and the first of them still ahead.
+	std::vector<uint32_t> m_schedule;
+	size_t m_nextScheduled;
+	// The scheduled segments the playhead is in, by when they start.
+	std::vector<uint32_t> m_running;
+	std::vector<Crossing> m_crossed;
+	std::vector<Event> m_events;
+	std::vector<Object3D*> m_objects;
+	// The transforms of the objects moved this tick, read from each object when a channel first
+	// moves it and written back when the tick is done.
+	std::vector<glm::vec3> m_positions;
+	std::vector<glm::quat> m_orientations;
+	std::vector<uint8_t> m_loaded;
+	std::vector<uint32_t> m_moved;
+	RotationPool m_rotations;
+	TranslationPool m_translations;
+	PathPool m_paths;
+	ClipPool m_clips;
+	float m_time;
+	float m_duration;
+	// The first event still ahead of the playhead.
+	size_t m_nextEvent;
+
+	uint32_t targetOf(Object3D& object);
+	void load(uint32_t target);
+	uint32_t segmentAt(Track& track, float time);
+	void moveSegment(const Segment& segment, float before, float after);
+	void moveTrack(Track& track, float from, float to);
+	void playTo(float time);
+	void moveTo(float time);
+	void apply();
+
+public:
+	Timeline();
+
+	/**
+	 * @brief Adds an empty track that starts at the given time, in seconds.
+	 * @return its index, for add().
+	 */
+	uint32_t addTrack(float start = 0);
+
+	/**
+	 * @brief Appends a channel to the end of a track's sequence. The object must outlive the
+	 * timeline and stay where it is in memory.
+	 */
+	void add(uint32_t track, Object3D& object, float duration, const AnimationChannel& channel);
+
+	/**
+	 * @brief Adds an event that fires once each time the playhead plays past the given time.
+	 */
+	void addEvent(float time, std::function<void()> callback);
+
+	/**
+	 * @brief Puts the playhead at the start. Channels and events can't be added once started.
+	 */
+	void start();
+
+	/**
+	 * @brief Plays forward by the given interval, in seconds, updating the objects the tracks
+	 * animate and firing the events passed on the way.
+	 */
+	void tick(float dt);
+
+	/**
+	 * @brief Jumps to a time, either way, and poses the objects there. Events jumped over don't
+	 * fire, and those after the new time will fire again when played past.
+	 */
+	void seek(float time);
+
+	float time() const { return m_time; }
+
+	/**
+	 * @brief When the last track ends, or the last event fires.
+	 */
+	float duration() const { return m_duration; }
+
+	/**
+	 * @brief Whether the playhead has yet to reach the end.
+	 */
+	bool running() const { return m_time < m_duration; }
+
+	size_t trackCount() const { return m_tracks.size(); }
+};
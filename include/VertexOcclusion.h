@@ -0,0 +1,27 @@
+#pragma once
+#include <filesystem>
+#include <vector>
+#include "Object3D.h"
+#include "ThreadPool.h"
+
+/**
+ * @brief Quality settings for per-vertex ambient occlusion.
+ */
+struct VertexOcclusionSettings {
+	// Hemisphere rays cast from each vertex.
+	uint32_t samplesPerVertex = 64;
+	// Hits further away than this don't occlude.
+	float occlusionDistance = 0.5f;
+};
+
+/**
+ * @brief Gives every mesh in the scene a per-vertex ambient occlusion attribute, which
+ * lighting.frag multiplies into the ambient term. A cheaper alternative to lightmaps: one byte
+ * per vertex and no extra texture fetch.
+ *
+ * Static objects are occluded by all static geometry; dynamic objects only by themselves, since
+ * their neighbours move. Results are cached per mesh in the given directory, so only the first
+ * run pays for the rays, until the mesh or one of its occluders is moved or replaced.
+ */
+void bakeVertexOcclusion(std::vector<Object3D>& objects, const VertexOcclusionSettings& settings,
+	ThreadPool& pool, const std::filesystem::path& cacheDirectory);
@@ -0,0 +1,14 @@
+#version 330
+// A vertex shader for the depth pre-pass. It reads only the position stream, and must compute
+// gl_Position exactly as light_perspective.vert does so the colour pass can test with GL_EQUAL.
+layout (location=0) in vec3 vPosition;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat4 model;
+
+invariant gl_Position;
+
+void main() {
+    gl_Position = projection * view * model * vec4(vPosition, 1.0);
+}
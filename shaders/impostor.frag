@@ -0,0 +1,59 @@
+#version 330
+// Shades a distant prop from its impostor atlases, with the same lighting as lighting.frag.
+layout (location=0) out vec4 FragColor;
+
+in vec2 Corner;
+in vec3 FragWorldPos;
+flat in vec2 FrameCell;
+flat in vec3 ViewAxis;
+flat in float Radius;
+flat in mat3 Rotation;
+
+uniform sampler2D colorAtlas;
+// Local-space normal in rgb, depth through the bounding sphere in a.
+uniform sampler2D normalDepthAtlas;
+uniform int framesPerSide;
+uniform int frameSize;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform vec3 cameraPos;
+
+uniform vec4 material;
+uniform vec3 ambientColor;
+uniform vec3 directionalLight;
+uniform vec3 directionalColor;
+
+void main() {
+    // Stay half a texel inside the frame, so filtering never reads a neighbouring view.
+    vec2 inset = vec2(0.5 / float(frameSize));
+    vec2 uv = (FrameCell + clamp(Corner, inset, 1.0 - inset)) / float(framesPerSide);
+    vec4 albedo = texture(colorAtlas, uv);
+    if (albedo.a < 0.5) {
+        discard;
+    }
+    vec4 normalDepth = texture(normalDepthAtlas, uv);
+    vec3 norm = normalize(Rotation * normalDepth.xyz);
+
+    // Move from the quad, through the sphere's center, to the surface that was baked here, so the
+    // impostor intersects the floor and its neighbours where the real mesh would.
+    vec3 surface = FragWorldPos + ViewAxis * Radius * (1.0 - 2.0 * normalDepth.w);
+    vec4 clip = projection * view * vec4(surface, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+
+    vec3 ambientIntensity = material.x * ambientColor;
+    vec3 diffuseIntensity = vec3(0);
+    vec3 specularIntensity = vec3(0);
+    vec3 lightDir = -directionalLight;
+    float lambertFactor = dot(norm, normalize(lightDir));
+    if (lambertFactor > 0) {
+        diffuseIntensity = material.y * directionalColor * lambertFactor;
+        vec3 eyeDir = normalize(cameraPos - surface);
+        vec3 reflectDir = normalize(reflect(-lightDir, norm));
+        float spec = dot(reflectDir, eyeDir);
+        if (spec > 0) {
+            specularIntensity = material.z * directionalColor * pow(spec, material.w);
+        }
+    }
+    FragColor = vec4(ambientIntensity + diffuseIntensity + specularIntensity, 1) * vec4(albedo.rgb, 1);
+}
@@ -0,0 +1,65 @@
+#version 330
+// Draws one quad per instance, with no vertex buffer for its corners. The quad is oriented like
+// the atlas frame baked closest to the direction the instance is seen from.
+layout (location=0) in vec4 vCenterRadius;
+// The instance's rotation; a mat3 attribute takes locations 1 to 3.
+layout (location=1) in mat3 vRotation;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform vec3 cameraPos;
+uniform int framesPerSide;
+
+out vec2 Corner;
+out vec3 FragWorldPos;
+flat out vec2 FrameCell;
+flat out vec3 ViewAxis;
+flat out float Radius;
+flat out mat3 Rotation;
+
+vec2 signNotZero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Unit direction -> [-1, 1] square, with the upper hemisphere in the inner diamond.
+vec2 octEncode(vec3 d) {
+    d /= abs(d.x) + abs(d.y) + abs(d.z);
+    vec2 p = d.xz;
+    if (d.y < 0.0) {
+        p = (1.0 - abs(p.yx)) * signNotZero(p);
+    }
+    return p;
+}
+
+// Must match octahedralDecode in Impostors.cpp, which placed the frames.
+vec3 octDecode(vec2 p) {
+    vec3 v = vec3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y);
+    if (v.y < 0.0) {
+        v.xz = (1.0 - abs(v.zx)) * signNotZero(v.xz);
+    }
+    return normalize(v);
+}
+
+void main() {
+    vec3 center = vCenterRadius.xyz;
+    Radius = vCenterRadius.w;
+    Rotation = vRotation;
+
+    // Pick the frame from the direction to the camera, in the prop's local space.
+    vec3 toCamera = transpose(vRotation) * normalize(cameraPos - center);
+    float frames = float(framesPerSide);
+    FrameCell = clamp(floor((octEncode(toCamera) * 0.5 + 0.5) * frames), 0.0, frames - 1.0);
+    vec3 axis = octDecode((FrameCell + 0.5) / frames * 2.0 - 1.0);
+
+    // The basis glm::lookAt built for the frame when it was baked.
+    vec3 up = abs(axis.y) > 0.99 ? vec3(0, 0, 1) : vec3(0, 1, 0);
+    vec3 right = normalize(cross(-axis, up));
+    vec3 frameUp = cross(right, -axis);
+
+    // Strip order: (0, 0), (1, 0), (0, 1), (1, 1).
+    Corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 offset = Corner * 2.0 - 1.0;
+    FragWorldPos = center + vRotation * ((right * offset.x + frameUp * offset.y) * Radius);
+    ViewAxis = vRotation * axis;
+    gl_Position = projection * view * vec4(FragWorldPos, 1.0);
+}
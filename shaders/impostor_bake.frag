@@ -0,0 +1,18 @@
+#version 330
+// Renders a prop's albedo, and its local-space normal and depth, into the impostor atlases.
+layout (location=0) out vec4 Albedo;
+layout (location=1) out vec4 NormalDepth;
+
+in vec2 TexCoord;
+in vec3 Normal;
+
+uniform sampler2D baseTexture;
+// World space normal -> the prop's local space.
+uniform mat3 normalTransform;
+
+void main() {
+    // Alpha marks coverage; the impostor discards texels no view of the prop reached.
+    Albedo = vec4(texture(baseTexture, TexCoord).rgb, 1);
+    // The orthographic depth runs linearly from the front of the bounding sphere to its back.
+    NormalDepth = vec4(normalize(normalTransform * Normal), gl_FragCoord.z);
+}
@@ -4,25 +4,38 @@
 layout (location=0) in vec3 vPosition;
 layout (location=1) in vec3 vNormal;
 layout (location=2) in vec2 vTexCoord;
+layout (location=3) in vec2 vLightMapCoord;
+layout (location=4) in float vOcclusion;
 
 uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 model;
+// World space -> shadow atlas space (xy = atlas texture coordinates, z = compare depth).
+uniform mat4 lightSpace;
 
 out vec2 TexCoord;
+out vec2 LightMapCoord;
+out float Occlusion;
 out vec3 Normal;
 out vec3 FragWorldPos;
+out vec4 FragLightPos;
+
+// Must match depth_only.vert bit-for-bit, since the colour pass may test depth with GL_EQUAL.
+invariant gl_Position;
 
 void main() {
     // Transform the vertex position from local space to clip space.
     gl_Position = projection * view * model * vec4(vPosition, 1.0);
     // Pass along the vertex texture coordinate.
     TexCoord = vTexCoord;
+    LightMapCoord = vLightMapCoord;
+    Occlusion = vOcclusion;
     // Transform the vertex normal from local space to world space, using the Normal matrix.
     mat4 normalMatrix = transpose(inverse(model));
     Normal = mat3(normalMatrix) * vNormal;
     //learn open GL
     FragWorldPos = vec3(model * vec4(vPosition, 1.0));
+    FragLightPos = lightSpace * vec4(FragWorldPos, 1.0);
     // TODO: transform the vertex position into world space, and assign it to FragWorldPos.
 
 }
\ No newline at end of file
@@ -5,8 +5,12 @@ layout (location=0) out vec4 FragColor;
 // Inputs: the texture coordinates, world-space normal, and world-space position
 // of this fragment, interpolated between its vertices.
 in vec2 TexCoord;
+in vec2 LightMapCoord;
+// Baked per-vertex ambient occlusion; 1 where nothing was baked.
+in float Occlusion;
 in vec3 Normal;
 in vec3 FragWorldPos;
+in vec4 FragLightPos;
 
 // Uniforms: MUST BE PROVIDED BY THE APPLICATION.
 
@@ -23,18 +27,54 @@ uniform vec3 ambientColor;
 uniform vec3 directionalLight; // this is the "I" vector, not the "L" vector.
 uniform vec3 directionalColor;
 
+// The shadow atlas, and the (min uv, max uv) of the directional light's tile in it.
+uniform sampler2DShadow shadowMap;
+uniform vec4 shadowTileBounds;
+uniform bool shadowsEnabled;
+
+// Baked ambient and indirect light for static meshes, stored at half intensity so it can exceed 1.
+uniform sampler2D lightMap;
+uniform bool hasLightMap;
+uniform bool lightMapsEnabled;
 
 
 // Location of the camera.
 uniform vec3 viewPos;
 
 
+// The fraction of the directional light reaching this fragment, filtered with a 3x3 PCF kernel.
+float shadowFactor() {
+    if (!shadowsEnabled) {
+        return 1.0;
+    }
+    vec3 coord = FragLightPos.xyz / FragLightPos.w;
+    // Anything outside the light's tile or beyond its far plane is unshadowed.
+    if (coord.z > 1.0 || any(lessThan(coord.xy, shadowTileBounds.xy))
+        || any(greaterThan(coord.xy, shadowTileBounds.zw))) {
+        return 1.0;
+    }
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0));
+    float lit = 0.0;
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            vec2 uv = clamp(coord.xy + vec2(x, y) * texel, shadowTileBounds.xy + texel, shadowTileBounds.zw - texel);
+            lit += texture(shadowMap, vec3(uv, coord.z));
+        }
+    }
+    return lit / 9.0;
+}
+
 void main() {
     // TODO: using the lecture notes, compute ambientIntensity, diffuseIntensity, 
     // and specularIntensity.
 
     // simulate like light boucning around the scene (lecture)
-    vec3 ambientIntensity = material.x * ambientColor;
+    vec3 ambientIntensity = material.x * ambientColor * Occlusion;
+    // Static geometry with a baked lightmap takes its ambient and bounced light from it instead;
+    // the direct light below is still shadowed and shaded in real time.
+    if (hasLightMap && lightMapsEnabled) {
+        ambientIntensity = 2.0 * texture(lightMap, LightMapCoord).rgb;
+    }
 
     // simulate light scattering (lecture)
     vec3 diffuseIntensity = vec3(0);
@@ -56,6 +96,7 @@ void main() {
         }
     }
 
-    vec3 lightIntensity = ambientIntensity + diffuseIntensity + specularIntensity;
+    float shadow = shadowFactor();
+    vec3 lightIntensity = ambientIntensity + shadow * (diffuseIntensity + specularIntensity);
     FragColor = vec4(lightIntensity, 1) * texture(baseTexture, TexCoord);
 }
\ No newline at end of file
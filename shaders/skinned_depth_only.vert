@@ -0,0 +1,23 @@
+#version 330
+// depth_only.vert for skinned meshes. It must compute gl_Position exactly as
+// skinned_perspective.vert does so the colour pass can test with GL_EQUAL.
+layout (location=0) in vec3 vPosition;
+layout (location=5) in uvec4 vJoints;
+layout (location=6) in vec4 vWeights;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat4 model;
+
+layout (std140) uniform Skin {
+    mat4 joints[128];
+};
+
+invariant gl_Position;
+
+void main() {
+    mat4 skin = vWeights.x * joints[vJoints.x] + vWeights.y * joints[vJoints.y]
+        + vWeights.z * joints[vJoints.z] + vWeights.w * joints[vJoints.w];
+    vec4 skinnedPosition = skin * vec4(vPosition, 1.0);
+    gl_Position = projection * view * model * skinnedPosition;
+}
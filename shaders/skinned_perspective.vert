@@ -0,0 +1,46 @@
+#version 330
+// light_perspective.vert for skinned meshes: each vertex is first moved by a blend of up to four
+// joint matrices from the mesh's palette, then shaded as usual.
+layout (location=0) in vec3 vPosition;
+layout (location=1) in vec3 vNormal;
+layout (location=2) in vec2 vTexCoord;
+layout (location=3) in vec2 vLightMapCoord;
+layout (location=4) in float vOcclusion;
+layout (location=5) in uvec4 vJoints;
+layout (location=6) in vec4 vWeights;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat4 model;
+// World space -> shadow atlas space (xy = atlas texture coordinates, z = compare depth).
+uniform mat4 lightSpace;
+
+// Must hold MAX_SKIN_JOINTS matrices, as SkinPaletteBuffer uploads them.
+layout (std140) uniform Skin {
+    mat4 joints[128];
+};
+
+out vec2 TexCoord;
+out vec2 LightMapCoord;
+out float Occlusion;
+out vec3 Normal;
+out vec3 FragWorldPos;
+out vec4 FragLightPos;
+
+// Must match skinned_depth_only.vert bit-for-bit, since the colour pass may test depth with GL_EQUAL.
+invariant gl_Position;
+
+void main() {
+    mat4 skin = vWeights.x * joints[vJoints.x] + vWeights.y * joints[vJoints.y]
+        + vWeights.z * joints[vJoints.z] + vWeights.w * joints[vJoints.w];
+    vec4 skinnedPosition = skin * vec4(vPosition, 1.0);
+    gl_Position = projection * view * model * skinnedPosition;
+    TexCoord = vTexCoord;
+    LightMapCoord = vLightMapCoord;
+    Occlusion = vOcclusion;
+    // Joints are rigid, so the skin matrix can move normals as it is.
+    mat4 normalMatrix = transpose(inverse(model));
+    Normal = mat3(normalMatrix) * (mat3(skin) * vNormal);
+    FragWorldPos = vec3(model * skinnedPosition);
+    FragLightPos = lightSpace * vec4(FragWorldPos, 1.0);
+}
@@ -0,0 +1,33 @@
+#version 330
+// Upscales the part of the scene texture that was rendered to the whole window, then sharpens
+// it to win back some of the detail lost to the lower resolution.
+layout (location=0) out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D sceneColor;
+// The rendered corner of the texture, in texture coordinates.
+uniform vec2 uvScale;
+uniform vec2 texelSize;
+// 0 disables sharpening.
+uniform float sharpness;
+
+vec3 tap(vec2 uv) {
+    // Stay inside the rendered region, away from stale texels past its edge.
+    return texture(sceneColor, clamp(uv, 0.5 * texelSize, uvScale - 0.5 * texelSize)).rgb;
+}
+
+void main() {
+    vec2 uv = TexCoord * uvScale;
+    vec3 center = tap(uv);
+    vec3 north = tap(uv + vec2(0, texelSize.y));
+    vec3 south = tap(uv - vec2(0, texelSize.y));
+    vec3 east = tap(uv + vec2(texelSize.x, 0));
+    vec3 west = tap(uv - vec2(texelSize.x, 0));
+
+    // Unsharp mask, clamped to the neighbourhood so edges don't ring.
+    vec3 sharpened = center + sharpness * (4.0 * center - north - south - east - west);
+    vec3 lowest = min(center, min(min(north, south), min(east, west)));
+    vec3 highest = max(center, max(max(north, south), max(east, west)));
+    FragColor = vec4(clamp(sharpened, lowest, highest), 1);
+}
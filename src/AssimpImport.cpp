@@ -1,4 +1,8 @@
 #include "AssimpImport.h"
+#include "LightmapUV.h"
+#include "SkinnedModel.h"
+#include <array>
+#include <cmath>
 #include <iostream>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -8,8 +12,10 @@
 
 const size_t FLOATS_PER_VERTEX = 3;
 const size_t VERTICES_PER_FACE = 3;
+// Assimp's stand-in when a file doesn't say how long a tick is.
+const double DEFAULT_TICKS_PER_SECOND = 25;
 
-std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName, const std::filesystem::path& modelPath, std::unordered_map<std::string, Texture>& loadedTextures) {
+std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName, const std::filesystem::path& modelPath, std::unordered_map<std::string, Texture>& loadedTextures, TextureStreamer* streamer) {
 	std::vector<Texture> textures;
 
 	for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
@@ -23,6 +29,11 @@ std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, c
 		if (existing != loadedTextures.end()) {
 			textures.push_back(existing->second);
 		}
+		else if (streamer) {
+			Texture tex = streamer->load(texPath, typeName);
+			textures.push_back(tex);
+			loadedTextures.insert(std::make_pair(texPath.string(), tex));
+		}
 		else {
 			StbImage image;
 			image.loadFromFile(texPath.string());
@@ -34,7 +45,77 @@ std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, c
 	return textures;
 }
 
-Mesh3D fromAssimpMesh(const aiMesh* mesh, const aiScene* scene, const std::filesystem::path& modelPath, std::unordered_map<std::string, Texture>& loadedTextures) {
+glm::vec3 fromAssimp(const aiVector3D& value) {
+	return glm::vec3(value.x, value.y, value.z);
+}
+
+glm::quat fromAssimp(const aiQuaternion& value) {
+	return glm::quat(value.w, value.x, value.y, value.z);
+}
+
+glm::mat4 fromAssimp(const aiMatrix4x4& matrix) {
+	glm::mat4 result;
+	for (auto i = 0; i < 4; i++) {
+		for (auto j = 0; j < 4; j++) {
+			result[i][j] = matrix[j][i];
+		}
+	}
+	return result;
+}
+
+// The skin is read in assimp's vertex order; sources, if given, picks out the imported vertices'.
+void importSkin(const aiMesh* mesh, const std::vector<uint32_t>& sources, Mesh3D& target) {
+	if (mesh->mNumBones > MAX_SKIN_JOINTS) {
+		throw std::runtime_error("Mesh \"" + std::string(mesh->mName.C_Str()) + "\" has " + std::to_string(mesh->mNumBones)
+			+ " joints; skinned meshes may have at most " + std::to_string(MAX_SKIN_JOINTS));
+	}
+	std::vector<VertexSkin> skin(mesh->mNumVertices, VertexSkin{ { 0, 0, 0, 0 }, { 0, 0, 0, 0 } });
+	std::vector<std::array<float, 4>> weights(mesh->mNumVertices, std::array<float, 4>{ 0, 0, 0, 0 });
+	std::vector<std::string> jointNames;
+	std::vector<glm::mat4> inverseBindMatrices;
+	for (unsigned int b = 0; b < mesh->mNumBones; b++) {
+		const aiBone* bone = mesh->mBones[b];
+		jointNames.push_back(bone->mName.C_Str());
+		inverseBindMatrices.push_back(fromAssimp(bone->mOffsetMatrix));
+		// Each vertex keeps its four strongest influences.
+		for (unsigned int w = 0; w < bone->mNumWeights; w++) {
+			const aiVertexWeight& influence = bone->mWeights[w];
+			auto& slots = weights[influence.mVertexId];
+			size_t weakest = std::min_element(slots.begin(), slots.end()) - slots.begin();
+			if (influence.mWeight > slots[weakest]) {
+				slots[weakest] = influence.mWeight;
+				skin[influence.mVertexId].joints[weakest] = static_cast<uint8_t>(b);
+			}
+		}
+	}
+
+	// Quantise the kept weights to bytes, putting any rounding error on the strongest.
+	for (size_t i = 0; i < skin.size(); i++) {
+		auto& slots = weights[i];
+		float total = slots[0] + slots[1] + slots[2] + slots[3];
+		if (total <= 0) {
+			slots[0] = total = 1;
+		}
+		int sum = 0;
+		for (int k = 0; k < 4; k++) {
+			skin[i].weights[k] = static_cast<uint8_t>(std::lround(slots[k] / total * 255));
+			sum += skin[i].weights[k];
+		}
+		size_t strongest = std::max_element(slots.begin(), slots.end()) - slots.begin();
+		skin[i].weights[strongest] = static_cast<uint8_t>(skin[i].weights[strongest] + 255 - sum);
+	}
+	if (!sources.empty()) {
+		std::vector<VertexSkin> remapped;
+		remapped.reserve(sources.size());
+		for (uint32_t source : sources) {
+			remapped.push_back(skin[source]);
+		}
+		skin = std::move(remapped);
+	}
+	target.setSkin(std::move(skin), std::move(jointNames), std::move(inverseBindMatrices));
+}
+
+Mesh3D fromAssimpMesh(const aiMesh* mesh, const aiScene* scene, const std::filesystem::path& modelPath, std::unordered_map<std::string, Texture>& loadedTextures, bool withLightmapUVs, TextureStreamer* streamer) {
 	std::vector<Vertex3D> vertices;
 
 	for (size_t i = 0; i < mesh->mNumVertices; i++) {
@@ -53,27 +134,121 @@ Mesh3D fromAssimpMesh(const aiMesh* mesh, const aiScene* scene, const std::files
 		faces.push_back(meshFace.mIndices[2]);
 	}
 
+	// Lightmap charts split and reorder the vertices; where each came from is kept for the skin.
+	std::vector<uint32_t> sources;
+	if (withLightmapUVs) {
+		sources = generateLightmapUVs(vertices, faces);
+	}
+
 	std::vector<Texture> textures = {};
 	if (mesh->mMaterialIndex >= 0){
 		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
 		std::vector<Texture> diffuseMaps = loadMaterialTextures(material,
-			aiTextureType_DIFFUSE, "baseTexture", modelPath, loadedTextures);
+			aiTextureType_DIFFUSE, "baseTexture", modelPath, loadedTextures, streamer);
 		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
 		std::vector<Texture> specularMaps = loadMaterialTextures(material,
-			aiTextureType_SPECULAR, "specMap", modelPath, loadedTextures);
+			aiTextureType_SPECULAR, "specMap", modelPath, loadedTextures, streamer);
 		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+		// glTF's packed metallic-roughness texture; real-time shading ignores it, the path tracer uses it.
+		std::vector<Texture> metallicRoughnessMaps = loadMaterialTextures(material,
+			aiTextureType_METALNESS, "metallicRoughness", modelPath, loadedTextures, streamer);
+		textures.insert(textures.end(), metallicRoughnessMaps.begin(), metallicRoughnessMaps.end());
 		std::vector<Texture> normalMaps = loadMaterialTextures(material,
-			aiTextureType_HEIGHT, "normalMap", modelPath, loadedTextures);
+			aiTextureType_HEIGHT, "normalMap", modelPath, loadedTextures, streamer);
 		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
 		normalMaps = loadMaterialTextures(material,
-			aiTextureType_NORMALS, "normalMap", modelPath, loadedTextures);
+			aiTextureType_NORMALS, "normalMap", modelPath, loadedTextures, streamer);
 		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
 	}
 
-	return Mesh3D(std::move(vertices), std::move(faces), std::move(textures));
+	Mesh3D result(std::move(vertices), std::move(faces), std::move(textures));
+	if (mesh->HasBones()) {
+		importSkin(mesh, sources, result);
+	}
+	return result;
+}
+
+template <typename T>
+void estimateTangents(KeyframeTrack<T>& track) {
+	// Catmull-Rom: each key's tangent runs from the key before it to the key after it.
+	size_t count = track.values.size();
+	track.inTangents.resize(count);
+	track.outTangents.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		size_t previous = i > 0 ? i - 1 : i;
+		size_t next = i + 1 < count ? i + 1 : i;
+		float span = track.times[next] - track.times[previous];
+		T tangent = span > 0 ? (track.values[next] - track.values[previous]) * (1 / span) : track.values[i] * 0.0f;
+		track.inTangents[i] = tangent;
+		track.outTangents[i] = tangent;
+	}
+}
+
+template <typename T, typename Key>
+KeyframeTrack<T> importKeyframeTrack(const Key* keys, unsigned int count, double ticksPerSecond, const T& restValue) {
+	KeyframeTrack<T> track;
+	if (count == 0) {
+		track.interpolation = KeyframeInterpolation::Step;
+		track.times.push_back(0);
+		track.values.push_back(restValue);
+		return track;
+	}
+	for (unsigned int i = 0; i < count; i++) {
+		track.times.push_back(static_cast<float>(keys[i].mTime / ticksPerSecond));
+		track.values.push_back(fromAssimp(keys[i].mValue));
+	}
+	switch (keys[0].mInterpolation) {
+	case aiAnimInterpolation_Step:
+		track.interpolation = KeyframeInterpolation::Step;
+		break;
+	case aiAnimInterpolation_Cubic_Spline:
+		// Assimp keeps a cubic spline's values but not its tangents, so they're estimated.
+		track.interpolation = KeyframeInterpolation::CubicSpline;
+		estimateTangents(track);
+		break;
+	default:
+		track.interpolation = KeyframeInterpolation::Linear;
+		break;
+	}
+	return track;
+}
+
+std::vector<KeyframeClip> importKeyframeClips(const aiScene* scene) {
+	std::vector<KeyframeClip> clips;
+	for (unsigned int a = 0; a < scene->mNumAnimations; a++) {
+		const aiAnimation* animation = scene->mAnimations[a];
+		double ticksPerSecond = animation->mTicksPerSecond > 0 ? animation->mTicksPerSecond : DEFAULT_TICKS_PER_SECOND;
+		KeyframeClip clip;
+		clip.name = animation->mName.C_Str();
+		clip.duration = static_cast<float>(animation->mDuration / ticksPerSecond);
+		for (unsigned int c = 0; c < animation->mNumChannels; c++) {
+			const aiNodeAnim* channel = animation->mChannels[c];
+			const aiNode* node = scene->mRootNode->FindNode(channel->mNodeName);
+			if (node == nullptr) {
+				continue;
+			}
+			// Whatever the channel leaves out keeps the node's own value.
+			aiVector3D restScale, restPosition;
+			aiQuaternion restRotation;
+			node->mTransformation.Decompose(restScale, restRotation, restPosition);
+
+			NodeKeyframes keys;
+			keys.node = channel->mNodeName.C_Str();
+			keys.translation = importKeyframeTrack(channel->mPositionKeys, channel->mNumPositionKeys, ticksPerSecond,
+				fromAssimp(restPosition));
+			keys.rotation = importKeyframeTrack(channel->mRotationKeys, channel->mNumRotationKeys, ticksPerSecond,
+				fromAssimp(restRotation));
+			keys.scale = importKeyframeTrack(channel->mScalingKeys, channel->mNumScalingKeys, ticksPerSecond,
+				fromAssimp(restScale));
+			clip.nodes.push_back(std::move(keys));
+		}
+		clips.push_back(std::move(clip));
+	}
+	return clips;
 }
 
-Object3D assimpLoad(const std::string& path, bool flipTextureCoords) {
+Object3D assimpLoad(const std::string& path, bool flipTextureCoords, bool withLightmapUVs, TextureStreamer* streamer,
+	std::vector<KeyframeClip>* clips) {
 	Assimp::Importer importer;
 
 	auto options = aiProcessPreset_TargetRealtime_MaxQuality;
@@ -93,18 +268,22 @@ Object3D assimpLoad(const std::string& path, bool flipTextureCoords) {
 	}
 	std::vector<Mesh3D> meshes;
 	std::unordered_map<std::string, Texture> loadedTextures;
-	auto ret = processAssimpNode(scene->mRootNode, scene, std::filesystem::path(path), loadedTextures);
+	auto ret = processAssimpNode(scene->mRootNode, scene, std::filesystem::path(path), loadedTextures,
+		withLightmapUVs, streamer);
+	if (clips) {
+		*clips = importKeyframeClips(scene);
+	}
 	return ret;
 }
 
 Object3D processAssimpNode(aiNode* node, const aiScene* scene,
 	const std::filesystem::path& modelPath,
-	std::unordered_map<std::string, Texture>& loadedTextures) {
+	std::unordered_map<std::string, Texture>& loadedTextures, bool withLightmapUVs, TextureStreamer* streamer) {
 
 	std::vector<Mesh3D> meshes;
 	for (auto i = 0; i < node->mNumMeshes; i++) {
 		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		meshes.emplace_back(fromAssimpMesh(mesh, scene, modelPath, loadedTextures));
+		meshes.emplace_back(fromAssimpMesh(mesh, scene, modelPath, loadedTextures, withLightmapUVs, streamer));
 	}
 
 	std::vector<Texture> textures;
@@ -112,16 +291,13 @@ Object3D processAssimpNode(aiNode* node, const aiScene* scene,
 		textures.push_back(p.second);
 	}
 
-	glm::mat4 baseTransform;
-	for (auto i = 0; i < 4; i++) {
-		for (auto j = 0; j < 4; j++) {
-			baseTransform[i][j] = node->mTransformation[j][i];
-		}
-	}
+	glm::mat4 baseTransform = fromAssimp(node->mTransformation);
 
 	auto parent = Object3D(std::move(meshes), baseTransform);
+	parent.setName(node->mName.C_Str());
 	for (auto i = 0; i < node->mNumChildren; i++) {
-		Object3D child = processAssimpNode(node->mChildren[i], scene, modelPath, loadedTextures);
+		Object3D child = processAssimpNode(node->mChildren[i], scene, modelPath, loadedTextures,
+			withLightmapUVs, streamer);
 		parent.addChild(std::move(child));
 	}
 	return parent;
@@ -0,0 +1,164 @@
+#include "AudioManager.h"
+#include <iostream>
+
+AudioManager::AudioManager(ThreadPool& pool, uint32_t voiceCount)
+	: m_pool(pool), m_voices(voiceCount), m_time(0) {
+	for (auto& voice : m_voices) {
+		voice.soundId = -1;
+		voice.priority = 0;
+		voice.startTime = 0;
+	}
+}
+
+AudioManager::~AudioManager() {
+	// The decode jobs write into the sounds, so they have to finish first.
+	for (auto& sound : m_sounds) {
+		if (sound->decoding.valid()) {
+			sound->decoding.wait();
+		}
+	}
+	for (auto& voice : m_voices) {
+		voice.sound.stop();
+	}
+}
+
+uint32_t AudioManager::load(const std::filesystem::path& path, const SoundSettings& settings) {
+	for (size_t i = 0; i < m_sounds.size(); i++) {
+		if (m_sounds[i]->path == path) {
+			return static_cast<uint32_t>(i);
+		}
+	}
+	auto sound = std::make_unique<Sound>();
+	sound->path = path;
+	sound->settings = settings;
+	sound->channelCount = 0;
+	sound->sampleRate = 0;
+	sound->failed = false;
+	sound->ready = false;
+	// Far enough back that the first start is never rate limited.
+	sound->lastStart = -1e9f;
+	Sound* decoded = sound.get();
+	sound->decoding = m_pool.submit([decoded]() {
+		sf::InputSoundFile file;
+		if (!file.openFromFile(decoded->path.string())) {
+			decoded->failed = true;
+			return;
+		}
+		decoded->samples.resize(file.getSampleCount());
+		decoded->samples.resize(file.read(decoded->samples.data(), decoded->samples.size()));
+		decoded->channelCount = file.getChannelCount();
+		decoded->sampleRate = file.getSampleRate();
+	});
+	m_sounds.push_back(std::move(sound));
+	return static_cast<uint32_t>(m_sounds.size() - 1);
+}
+
+void AudioManager::finishDecoding(Sound& sound) {
+	sound.decoding.get();
+	if (!sound.failed) {
+		sound.failed = !sound.buffer.loadFromSamples(sound.samples.data(), sound.samples.size(),
+			sound.channelCount, sound.sampleRate);
+	}
+	if (sound.failed) {
+		std::cerr << "Failed to load audio " << sound.path << std::endl;
+	}
+	sound.ready = !sound.failed;
+	// The buffer has its own copy now.
+	sound.samples = std::vector<sf::Int16>();
+}
+
+void AudioManager::update(float dt) {
+	m_time += dt;
+	for (auto& sound : m_sounds) {
+		if (sound->decoding.valid()
+			&& sound->decoding.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			finishDecoding(*sound);
+		}
+	}
+}
+
+bool AudioManager::loaded() const {
+	for (auto& sound : m_sounds) {
+		if (sound->decoding.valid()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+AudioManager::Voice* AudioManager::findVoice(uint32_t soundId, const Sound& sound) {
+	// At its cap, the sound restarts its own oldest voice rather than taking another.
+	uint32_t playing = 0;
+	Voice* oldestOwn = nullptr;
+	for (auto& voice : m_voices) {
+		if (voice.soundId == static_cast<int32_t>(soundId) && voice.sound.getStatus() == sf::Sound::Playing) {
+			playing++;
+			if (oldestOwn == nullptr || voice.startTime < oldestOwn->startTime) {
+				oldestOwn = &voice;
+			}
+		}
+	}
+	if (playing >= sound.settings.maxVoices) {
+		return oldestOwn;
+	}
+
+	// Otherwise a free voice, or the oldest of the lowest priority below this sound's.
+	Voice* steal = nullptr;
+	for (auto& voice : m_voices) {
+		if (voice.sound.getStatus() != sf::Sound::Playing) {
+			return &voice;
+		}
+		if (voice.priority < sound.settings.priority && (steal == nullptr || voice.priority < steal->priority
+			|| (voice.priority == steal->priority && voice.startTime < steal->startTime))) {
+			steal = &voice;
+		}
+	}
+	return steal;
+}
+
+bool AudioManager::play(uint32_t soundId) {
+	Sound& sound = *m_sounds[soundId];
+	if (!sound.ready || m_time - sound.lastStart < sound.settings.minInterval) {
+		return false;
+	}
+	Voice* voice = findVoice(soundId, sound);
+	if (voice == nullptr) {
+		return false;
+	}
+	voice->sound.stop();
+	if (voice->soundId != static_cast<int32_t>(soundId)) {
+		voice->sound.setBuffer(sound.buffer);
+		voice->soundId = static_cast<int32_t>(soundId);
+	}
+	voice->sound.setVolume(sound.settings.volume);
+	voice->priority = sound.settings.priority;
+	voice->startTime = m_time;
+	voice->sound.play();
+	sound.lastStart = m_time;
+	return true;
+}
+
+void AudioManager::playStream(const std::filesystem::path& path, float volume, bool loop) {
+	if (m_stream) {
+		m_stream->stop();
+	}
+	m_stream = std::make_unique<sf::Music>();
+	if (!m_stream->openFromFile(path.string())) {
+		std::cerr << "Failed to open audio stream " << path << std::endl;
+		m_stream.reset();
+		return;
+	}
+	m_stream->setVolume(volume);
+	m_stream->setLoop(loop);
+	m_stream->play();
+}
+
+uint32_t AudioManager::activeVoices() const {
+	uint32_t active = 0;
+	for (auto& voice : m_voices) {
+		if (voice.sound.getStatus() == sf::Sound::Playing) {
+			active++;
+		}
+	}
+	return active;
+}
@@ -0,0 +1,271 @@
+#include "BakedClip.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+	// Quantisation of the three smallest components of a unit quaternion, which lie within
+	// +/- 1/sqrt(2).
+	const float QUAT_COMPONENT_RANGE = 0.70710678f;
+	const uint16_t QUAT_COMPONENT_MAX = 0x7fff;
+	const uint32_t MAX_BAKED_FRAMES = 0xffff;
+
+	float difference(const glm::vec3& a, const glm::vec3& b) {
+		return glm::length(a - b);
+	}
+
+	float difference(const glm::quat& a, const glm::quat& b) {
+		return 2 * std::acos(std::min(std::abs(glm::dot(a, b)), 1.0f));
+	}
+
+	glm::vec3 blend(const glm::vec3& a, const glm::vec3& b, float t) {
+		return glm::mix(a, b, t);
+	}
+
+	// Normalised linear blending, which playback uses as the cheap stand-in for SLERP.
+	glm::quat blend(const glm::quat& a, const glm::quat& b, float t) {
+		return glm::normalize(a * (1 - t) + b * t);
+	}
+
+	// How far each component may stray for the whole value to stay within a tolerance. A vec3
+	// off by e in each component is off by e*sqrt(3). A quaternion off by e in each is within 2e
+	// of the sample, normalising it barely moves it further, and the angle is twice that chord.
+	float componentTolerance(const glm::vec3&, float tolerance) {
+		return tolerance / std::sqrt(3.0f);
+	}
+
+	float componentTolerance(const glm::quat&, float tolerance) {
+		return tolerance / 4;
+	}
+
+	// Keeps the first and last samples and as few between as linear interpolation through the
+	// kept keys needs to stay within the tolerance of every sample, in one pass: each sample
+	// narrows the range of slopes a line from the last key may have, per component, and the
+	// first sample whose own slope falls outside it ends the line at the sample before.
+	template <typename T, typename Stored, typename Pack>
+	BakedChannel<Stored> reduce(const std::vector<T>& samples, float tolerance, Pack pack) {
+		const int components = T::length();
+		float slack = componentTolerance(samples[0], tolerance);
+		BakedChannel<Stored> channel;
+		size_t key = 0;
+		channel.frames.push_back(0);
+		channel.values.push_back(pack(samples[0]));
+
+		float lowest[4], highest[4];
+		auto restart = [&]() {
+			std::fill(lowest, lowest + components, -std::numeric_limits<float>::max());
+			std::fill(highest, highest + components, std::numeric_limits<float>::max());
+		};
+		restart();
+		for (size_t i = 1; i < samples.size();) {
+			float span = static_cast<float>(i - key);
+			bool reachable = true;
+			for (int c = 0; c < components && reachable; c++) {
+				float slope = (samples[i][c] - samples[key][c]) / span;
+				reachable = slope >= lowest[c] && slope <= highest[c];
+			}
+			if (!reachable) {
+				// The sample right after a key is always reachable, so this key is further on.
+				key = i - 1;
+				channel.frames.push_back(static_cast<uint16_t>(key));
+				channel.values.push_back(pack(samples[key]));
+				restart();
+				continue;
+			}
+			for (int c = 0; c < components; c++) {
+				lowest[c] = std::max(lowest[c], (samples[i][c] - slack - samples[key][c]) / span);
+				highest[c] = std::min(highest[c], (samples[i][c] + slack - samples[key][c]) / span);
+			}
+			i++;
+		}
+		if (key + 1 < samples.size()) {
+			key = samples.size() - 1;
+			channel.frames.push_back(static_cast<uint16_t>(key));
+			channel.values.push_back(pack(samples[key]));
+		}
+		// A property that never moves needs only its one key.
+		if (channel.frames.size() == 2 && difference(samples.front(), samples.back()) <= tolerance) {
+			bool still = std::all_of(samples.begin(), samples.end(),
+				[&](const T& sample) { return difference(sample, samples.front()) <= tolerance; });
+			if (still) {
+				channel.frames.pop_back();
+				channel.values.pop_back();
+			}
+		}
+		channel.keyAt.resize(samples.size());
+		size_t k = 0;
+		for (size_t frame = 0; frame < samples.size(); frame++) {
+			while (k + 1 < channel.frames.size() && channel.frames[k + 1] <= frame) {
+				k++;
+			}
+			channel.keyAt[frame] = static_cast<uint16_t>(k);
+		}
+		return channel;
+	}
+
+	// Finds the keys either side of a frame, and how far between them it lies.
+	template <typename T>
+	size_t locate(const BakedChannel<T>& channel, uint32_t frame, float fraction, float& t) {
+		size_t key = channel.keyAt[frame];
+		if (key + 1 >= channel.frames.size()) {
+			t = 0;
+			return key;
+		}
+		float from = channel.frames[key];
+		t = (frame + fraction - from) / (channel.frames[key + 1] - from);
+		return key;
+	}
+
+	glm::vec3 sample(const BakedChannel<glm::vec3>& channel, uint32_t frame, float fraction) {
+		float t;
+		size_t key = locate(channel, frame, fraction, t);
+		return t > 0 ? glm::mix(channel.values[key], channel.values[key + 1], t) : channel.values[key];
+	}
+
+	glm::quat sample(const BakedChannel<PackedQuat>& channel, uint32_t frame, float fraction) {
+		float t;
+		size_t key = locate(channel, frame, fraction, t);
+		glm::quat from = channel.values[key].unpack();
+		if (t <= 0) {
+			return from;
+		}
+		glm::quat to = channel.values[key + 1].unpack();
+		// Packing may have flipped either key's sign; blend along the shorter arc.
+		if (glm::dot(from, to) < 0) {
+			to = -to;
+		}
+		return blend(from, to, t);
+	}
+}
+
+PackedQuat PackedQuat::pack(glm::quat q) {
+	float components[4] = { q.x, q.y, q.z, q.w };
+	int largest = 0;
+	for (int i = 1; i < 4; i++) {
+		if (std::abs(components[i]) > std::abs(components[largest])) {
+			largest = i;
+		}
+	}
+	// q and -q are the same rotation, so make the dropped component positive.
+	float sign = components[largest] < 0 ? -1.0f : 1.0f;
+	PackedQuat packed{};
+	for (int i = 0, slot = 0; i < 4; i++) {
+		if (i == largest) {
+			continue;
+		}
+		float unit = (sign * components[i] / QUAT_COMPONENT_RANGE + 1) * 0.5f;
+		packed.bits[slot++] = static_cast<uint16_t>(std::lround(std::clamp(unit, 0.0f, 1.0f) * QUAT_COMPONENT_MAX));
+	}
+	// The largest component's index goes in the top bits of the first two words.
+	packed.bits[0] |= (largest >> 1) << 15;
+	packed.bits[1] |= (largest & 1) << 15;
+	return packed;
+}
+
+glm::quat PackedQuat::unpack() const {
+	int largest = ((bits[0] >> 15) << 1) | (bits[1] >> 15);
+	float components[4];
+	float sumOfSquares = 0;
+	for (int i = 0, slot = 0; i < 4; i++) {
+		if (i == largest) {
+			continue;
+		}
+		float unit = static_cast<float>(bits[slot++] & QUAT_COMPONENT_MAX) / QUAT_COMPONENT_MAX;
+		components[i] = (unit * 2 - 1) * QUAT_COMPONENT_RANGE;
+		sumOfSquares += components[i] * components[i];
+	}
+	components[largest] = std::sqrt(std::max(1 - sumOfSquares, 0.0f));
+	return glm::quat(components[3], components[0], components[1], components[2]);
+}
+
+size_t BakedClip::keyCount() const {
+	size_t keys = 0;
+	for (const auto& object : m_objects) {
+		keys += object.position.frames.size() + object.rotation.frames.size() + object.scale.frames.size();
+	}
+	return keys;
+}
+
+BakedClip bakeTimeline(Timeline& timeline, const std::vector<Object3D*>& objects,
+	float rate, const BakeTolerances& tolerances) {
+	BakedClip clip;
+	clip.m_duration = timeline.duration();
+	// A whole number of frames over the timeline, as near the rate asked for as that allows.
+	uint32_t intervals = std::max(1u, static_cast<uint32_t>(std::ceil(clip.m_duration * rate)));
+	if (intervals > MAX_BAKED_FRAMES - 1) {
+		throw std::runtime_error("A timeline of " + std::to_string(clip.m_duration)
+			+ " seconds is too long to bake at " + std::to_string(rate) + " frames per second");
+	}
+	clip.m_frameCount = intervals + 1;
+	clip.m_rate = clip.m_duration > 0 ? intervals / clip.m_duration : rate;
+
+	std::vector<std::vector<glm::vec3>> positions(objects.size());
+	std::vector<std::vector<glm::quat>> rotations(objects.size());
+	std::vector<std::vector<glm::vec3>> scales(objects.size());
+	for (uint32_t frame = 0; frame < clip.m_frameCount; frame++) {
+		timeline.seek(std::min(frame / clip.m_rate, clip.m_duration));
+		for (size_t i = 0; i < objects.size(); i++) {
+			glm::quat rotation = objects[i]->getOrientation();
+			// Keep successive samples in one hemisphere so they blend the short way round.
+			if (frame > 0 && glm::dot(rotation, rotations[i].back()) < 0) {
+				rotation = -rotation;
+			}
+			positions[i].push_back(objects[i]->getPosition());
+			rotations[i].push_back(rotation);
+			scales[i].push_back(objects[i]->getScale());
+		}
+	}
+	// Back the way it came, a frame at a time, so turns that overlapped on the way are undone in
+	// the same steps they were made in.
+	for (uint32_t frame = clip.m_frameCount - 1; frame-- > 0;) {
+		timeline.seek(frame / clip.m_rate);
+	}
+
+	auto same = [](const glm::vec3& value) { return value; };
+	for (size_t i = 0; i < objects.size(); i++) {
+		clip.m_objects.push_back(BakedClip::ObjectChannels{
+			reduce<glm::vec3, glm::vec3>(positions[i], tolerances.position, same),
+			reduce<glm::quat, PackedQuat>(rotations[i], tolerances.rotation, PackedQuat::pack),
+			reduce<glm::vec3, glm::vec3>(scales[i], tolerances.scale, same),
+		});
+	}
+	return clip;
+}
+
+BakedClipPlayer::BakedClipPlayer(const BakedClip& clip)
+	: m_clip(&clip) {
+}
+
+uint32_t BakedClipPlayer::add(const std::vector<Object3D*>& objects, float phase) {
+	if (objects.size() != m_clip->objectCount()) {
+		throw std::runtime_error("A baked clip of " + std::to_string(m_clip->objectCount())
+			+ " objects can't play on " + std::to_string(objects.size()) + " objects");
+	}
+	m_targets.insert(m_targets.end(), objects.begin(), objects.end());
+	m_phase.push_back(phase);
+	return static_cast<uint32_t>(m_phase.size() - 1);
+}
+
+void BakedClipPlayer::update(float time) {
+	const BakedClip& clip = *m_clip;
+	size_t objectCount = clip.m_objects.size();
+	uint32_t lastInterval = clip.m_frameCount - 2;
+	for (size_t instance = 0; instance < m_phase.size(); instance++) {
+		float local = clip.m_duration > 0 ? std::fmod(time + m_phase[instance], clip.m_duration) : 0.0f;
+		if (local < 0) {
+			local += clip.m_duration;
+		}
+		float position = local * clip.m_rate;
+		uint32_t frame = std::min(static_cast<uint32_t>(position), lastInterval);
+		float fraction = position - frame;
+
+		Object3D* const* targets = &m_targets[instance * objectCount];
+		for (size_t i = 0; i < objectCount; i++) {
+			const auto& channels = clip.m_objects[i];
+			targets[i]->setPosition(sample(channels.position, frame, fraction));
+			targets[i]->setOrientation(sample(channels.rotation, frame, fraction));
+			targets[i]->setScale(sample(channels.scale, frame, fraction));
+		}
+	}
+}
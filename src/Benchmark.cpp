@@ -0,0 +1,117 @@
+#include "Benchmark.h"
+#include "CameraPath.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+Benchmark::Benchmark(uint32_t frameCount, uint64_t samplesPerFrame, bool depthPrepass)
+	: m_frameCount(frameCount), m_currentFrame(0), m_samplesPerFrame(samplesPerFrame),
+	m_depthPrepass(depthPrepass), m_frames(frameCount, FrameStats{ 0, 0 }), m_lastGpuFrame(-1),
+	m_gpuDroppedFrames(0) {
+	glGenQueries(QUERY_LATENCY, m_queries);
+}
+
+Benchmark::~Benchmark() {
+	glDeleteQueries(QUERY_LATENCY, m_queries);
+}
+
+glm::vec3 Benchmark::cameraPosition() const {
+	// One full orbit of the room over the course of the run.
+	return orbitCameraPose(static_cast<float>(m_currentFrame) / std::max(m_frameCount, 1u)).position;
+}
+
+glm::vec3 Benchmark::cameraDirection() const {
+	return orbitCameraPose(static_cast<float>(m_currentFrame) / std::max(m_frameCount, 1u)).direction;
+}
+
+void Benchmark::beginShadedPass() {
+	glBeginQuery(GL_SAMPLES_PASSED, m_queries[m_currentFrame % QUERY_LATENCY]);
+}
+
+void Benchmark::endShadedPass() {
+	glEndQuery(GL_SAMPLES_PASSED);
+}
+
+void Benchmark::collect(uint32_t frame) {
+	GLuint64 samples = 0;
+	glGetQueryObjectui64v(m_queries[frame % QUERY_LATENCY], GL_QUERY_RESULT, &samples);
+	m_frames[frame].samplesPassed = samples;
+}
+
+void Benchmark::endFrame(float cpuSeconds) {
+	if (finished()) {
+		return;
+	}
+	m_frames[m_currentFrame].cpuSeconds = cpuSeconds;
+	// The query issued QUERY_LATENCY - 1 frames ago is almost certainly ready by now; reading it
+	// frees its slot for the next frame.
+	if (m_currentFrame + 1 >= QUERY_LATENCY) {
+		collect(m_currentFrame + 1 - QUERY_LATENCY);
+	}
+	++m_currentFrame;
+}
+
+void Benchmark::recordGpuTimings(const GpuProfiler& profiler) {
+	// Skip the first frame, like the CPU timings do.
+	if (profiler.latestFrame() <= m_lastGpuFrame || profiler.latestFrame() < 1) {
+		return;
+	}
+	m_lastGpuFrame = profiler.latestFrame();
+	m_gpuDroppedFrames = profiler.droppedFrames();
+	for (auto& timing : profiler.latestTimings()) {
+		auto existing = std::find_if(m_gpuScopes.begin(), m_gpuScopes.end(),
+			[&](const GpuScopeStats& stats) { return stats.path == timing.path; });
+		if (existing == m_gpuScopes.end()) {
+			m_gpuScopes.push_back(GpuScopeStats{ timing.path, 0, 0 });
+			existing = m_gpuScopes.end() - 1;
+		}
+		existing->totalMilliseconds += timing.milliseconds;
+		existing->frames++;
+	}
+}
+
+void Benchmark::writeReport(const std::string& path) {
+	// Drain the queries that are still in flight.
+	uint32_t firstPending = m_currentFrame + 1 >= QUERY_LATENCY ? m_currentFrame + 1 - QUERY_LATENCY : 0;
+	for (uint32_t frame = firstPending; frame < m_currentFrame; frame++) {
+		collect(frame);
+	}
+
+	// The first frame includes shader compilation and first-use uploads, so skip it.
+	uint32_t first = m_currentFrame > 1 ? 1 : 0;
+	uint32_t count = m_currentFrame - first;
+	double totalSeconds = 0;
+	double totalSamples = 0;
+	float minSeconds = count > 0 ? m_frames[first].cpuSeconds : 0;
+	float maxSeconds = 0;
+	for (uint32_t frame = first; frame < m_currentFrame; frame++) {
+		totalSeconds += m_frames[frame].cpuSeconds;
+		totalSamples += m_frames[frame].samplesPassed;
+		minSeconds = std::min(minSeconds, m_frames[frame].cpuSeconds);
+		maxSeconds = std::max(maxSeconds, m_frames[frame].cpuSeconds);
+	}
+	double averageSeconds = count > 0 ? totalSeconds / count : 0;
+	double fragmentsPerFrame = count > 0 ? totalSamples / count : 0;
+
+	std::ofstream out(path);
+	out << "{\n";
+	out << "  \"frames\": " << count << ",\n";
+	out << "  \"depthPrepass\": " << (m_depthPrepass ? "true" : "false") << ",\n";
+	out << "  \"averageFrameMs\": " << averageSeconds * 1000 << ",\n";
+	out << "  \"minFrameMs\": " << minSeconds * 1000 << ",\n";
+	out << "  \"maxFrameMs\": " << maxSeconds * 1000 << ",\n";
+	out << "  \"averageFps\": " << (averageSeconds > 0 ? 1 / averageSeconds : 0) << ",\n";
+	out << "  \"shadedFragmentsPerFrame\": " << fragmentsPerFrame << ",\n";
+	out << "  \"overdraw\": " << fragmentsPerFrame / std::max<uint64_t>(m_samplesPerFrame, 1) << ",\n";
+	out << "  \"gpuDroppedFrames\": " << m_gpuDroppedFrames << ",\n";
+	// Average GPU time of each profiler scope, over the frames it appeared in.
+	out << "  \"gpuScopesMs\": {";
+	for (size_t i = 0; i < m_gpuScopes.size(); i++) {
+		out << (i > 0 ? "," : "") << "\n    \"" << m_gpuScopes[i].path << "\": "
+			<< m_gpuScopes[i].totalMilliseconds / std::max(m_gpuScopes[i].frames, 1u);
+	}
+	out << (m_gpuScopes.empty() ? "}\n" : "\n  }\n");
+	out << "}\n";
+	std::cout << "benchmark report written to " << path << std::endl;
+}
@@ -0,0 +1,84 @@
+#include "Broadphase.h"
+#include <algorithm>
+
+SweepAndPrune::SweepAndPrune() : m_axis(0), m_needsFullSort(false) {
+}
+
+uint32_t SweepAndPrune::add(const Aabb& bounds) {
+	uint32_t proxy;
+	if (!m_freeProxies.empty()) {
+		proxy = m_freeProxies.back();
+		m_freeProxies.pop_back();
+		m_bounds[proxy] = bounds;
+		m_active[proxy] = true;
+	}
+	else {
+		proxy = static_cast<uint32_t>(m_bounds.size());
+		m_bounds.push_back(bounds);
+		m_active.push_back(true);
+	}
+	m_order.push_back(proxy);
+	m_needsFullSort = true;
+	return proxy;
+}
+
+void SweepAndPrune::remove(uint32_t proxy) {
+	m_active[proxy] = false;
+	m_freeProxies.push_back(proxy);
+	m_order.erase(std::find(m_order.begin(), m_order.end(), proxy));
+}
+
+void SweepAndPrune::chooseAxis() {
+	// The axis along which the box centers vary the most.
+	glm::vec3 sum(0);
+	glm::vec3 sumSquared(0);
+	for (uint32_t proxy : m_order) {
+		glm::vec3 center = (m_bounds[proxy].lower + m_bounds[proxy].upper) * 0.5f;
+		sum += center;
+		sumSquared += center * center;
+	}
+	float count = static_cast<float>(std::max<size_t>(m_order.size(), 1));
+	glm::vec3 variance = sumSquared / count - (sum / count) * (sum / count);
+	m_axis = variance.x >= variance.y ? (variance.x >= variance.z ? 0 : 2) : (variance.y >= variance.z ? 1 : 2);
+}
+
+const std::vector<BroadphasePair>& SweepAndPrune::findPairs() {
+	int previousAxis = m_axis;
+	chooseAxis();
+	int axis = m_axis;
+
+	// New proxies or a new axis leave no useful order to start from.
+	if (m_needsFullSort || axis != previousAxis) {
+		std::sort(m_order.begin(), m_order.end(), [&](uint32_t a, uint32_t b) {
+			return m_bounds[a].lower[axis] < m_bounds[b].lower[axis];
+		});
+		m_needsFullSort = false;
+	}
+	// Insertion sort: close to linear when last step's order is still nearly right.
+	for (size_t i = 1; i < m_order.size(); i++) {
+		uint32_t proxy = m_order[i];
+		float key = m_bounds[proxy].lower[axis];
+		size_t j = i;
+		while (j > 0 && m_bounds[m_order[j - 1]].lower[axis] > key) {
+			m_order[j] = m_order[j - 1];
+			j--;
+		}
+		m_order[j] = proxy;
+	}
+
+	m_pairs.clear();
+	for (size_t i = 0; i < m_order.size(); i++) {
+		const Aabb& bounds = m_bounds[m_order[i]];
+		// Everything that starts before this box ends along the axis; nothing later can overlap.
+		for (size_t j = i + 1; j < m_order.size(); j++) {
+			const Aabb& other = m_bounds[m_order[j]];
+			if (other.lower[axis] > bounds.upper[axis]) {
+				break;
+			}
+			if (bounds.overlaps(other)) {
+				m_pairs.push_back(BroadphasePair{ std::min(m_order[i], m_order[j]), std::max(m_order[i], m_order[j]) });
+			}
+		}
+	}
+	return m_pairs;
+}
@@ -0,0 +1,496 @@
+#include "Bvh.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+	const uint32_t SAH_BINS = 16;
+	const uint32_t MAX_LEAF_SIZE = 4;
+	// The traversal stack is sized for this depth; the build stops splitting beyond it.
+	const uint32_t MAX_DEPTH = 64;
+
+	struct Bounds {
+		glm::vec3 min{ std::numeric_limits<float>::max() };
+		glm::vec3 max{ -std::numeric_limits<float>::max() };
+
+		void grow(const glm::vec3& p) {
+			min = glm::min(min, p);
+			max = glm::max(max, p);
+		}
+		void grow(const Bounds& b) {
+			min = glm::min(min, b.min);
+			max = glm::max(max, b.max);
+		}
+		float area() const {
+			glm::vec3 e = max - min;
+			return e.x < 0 ? 0 : 2 * (e.x * e.y + e.y * e.z + e.z * e.x);
+		}
+	};
+
+	/**
+	 * @brief Slab test; returns the entry distance, or infinity on a miss.
+	 */
+	inline float intersectBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+		const glm::vec3& origin, const glm::vec3& inverseDirection, float tMax) {
+		glm::vec3 t0 = (boundsMin - origin) * inverseDirection;
+		glm::vec3 t1 = (boundsMax - origin) * inverseDirection;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+		float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+		return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+	}
+
+	/**
+	 * @brief Moller-Trumbore ray/triangle intersection.
+	 */
+	inline bool intersectTriangle(const TriangleBvh::Triangle& tri, const Ray& ray, float tMax,
+		float& t, float& u, float& v) {
+		glm::vec3 p = glm::cross(ray.direction, tri.edge2);
+		float det = glm::dot(tri.edge1, p);
+		if (std::abs(det) < 1e-12f) {
+			return false;
+		}
+		float inverseDet = 1.0f / det;
+		glm::vec3 s = ray.origin - tri.v0;
+		u = glm::dot(s, p) * inverseDet;
+		if (u < 0 || u > 1) {
+			return false;
+		}
+		glm::vec3 q = glm::cross(s, tri.edge1);
+		v = glm::dot(ray.direction, q) * inverseDet;
+		if (v < 0 || u + v > 1) {
+			return false;
+		}
+		t = glm::dot(tri.edge2, q) * inverseDet;
+		return t > 0 && t < tMax;
+	}
+
+	inline glm::vec3 safeInverse(const glm::vec3& d) {
+		const float tiny = 1e-20f;
+		return glm::vec3(
+			1.0f / (std::abs(d.x) > tiny ? d.x : std::copysign(tiny, d.x)),
+			1.0f / (std::abs(d.y) > tiny ? d.y : std::copysign(tiny, d.y)),
+			1.0f / (std::abs(d.z) > tiny ? d.z : std::copysign(tiny, d.z)));
+	}
+}
+
+TriangleBvh::TriangleBvh(const std::vector<glm::vec3>& triangleVertices) {
+	uint32_t count = static_cast<uint32_t>(triangleVertices.size() / 3);
+	if (count == 0) {
+		return;
+	}
+
+	std::vector<Bounds> triangleBounds(count);
+	std::vector<glm::vec3> centroids(count);
+	m_triangleIds.resize(count);
+	for (uint32_t i = 0; i < count; i++) {
+		for (uint32_t k = 0; k < 3; k++) {
+			triangleBounds[i].grow(triangleVertices[3 * i + k]);
+		}
+		centroids[i] = (triangleBounds[i].min + triangleBounds[i].max) * 0.5f;
+		m_triangleIds[i] = i;
+	}
+
+	struct BuildTask {
+		uint32_t node;
+		uint32_t first;
+		uint32_t count;
+		uint32_t depth;
+	};
+	m_nodes.reserve(2 * count);
+	m_nodes.push_back(Node{});
+	std::vector<BuildTask> tasks{ BuildTask{ 0, 0, count, 0 } };
+
+	while (!tasks.empty()) {
+		BuildTask task = tasks.back();
+		tasks.pop_back();
+
+		Bounds bounds, centroidBounds;
+		for (uint32_t i = task.first; i < task.first + task.count; i++) {
+			bounds.grow(triangleBounds[m_triangleIds[i]]);
+			centroidBounds.grow(centroids[m_triangleIds[i]]);
+		}
+		Node& node = m_nodes[task.node];
+		node.boundsMin = bounds.min;
+		node.boundsMax = bounds.max;
+		node.firstOrLeft = task.first;
+		node.triangleCount = task.count;
+
+		glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+		uint32_t axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+		if (task.count <= MAX_LEAF_SIZE || task.depth + 1 >= MAX_DEPTH || extent[axis] <= 0) {
+			continue;
+		}
+
+		// Bin the centroids along the widest axis, and evaluate the SAH at each bin boundary.
+		Bounds binBounds[SAH_BINS];
+		uint32_t binCounts[SAH_BINS] = {};
+		float binScale = SAH_BINS / extent[axis];
+		auto binOf = [&](uint32_t tri) {
+			return std::min(SAH_BINS - 1,
+				static_cast<uint32_t>((centroids[tri][axis] - centroidBounds.min[axis]) * binScale));
+		};
+		for (uint32_t i = task.first; i < task.first + task.count; i++) {
+			uint32_t bin = binOf(m_triangleIds[i]);
+			binCounts[bin]++;
+			binBounds[bin].grow(triangleBounds[m_triangleIds[i]]);
+		}
+
+		float rightCosts[SAH_BINS] = {};
+		Bounds sweep;
+		uint32_t sweepCount = 0;
+		for (uint32_t b = SAH_BINS - 1; b > 0; b--) {
+			sweep.grow(binBounds[b]);
+			sweepCount += binCounts[b];
+			rightCosts[b] = sweep.area() * sweepCount;
+		}
+		float bestCost = std::numeric_limits<float>::max();
+		uint32_t bestSplit = 0;
+		sweep = Bounds();
+		sweepCount = 0;
+		for (uint32_t b = 0; b + 1 < SAH_BINS; b++) {
+			sweep.grow(binBounds[b]);
+			sweepCount += binCounts[b];
+			float cost = sweep.area() * sweepCount + rightCosts[b + 1];
+			if (sweepCount > 0 && sweepCount < task.count && cost < bestCost) {
+				bestCost = cost;
+				bestSplit = b;
+			}
+		}
+		// Splitting must beat intersecting every triangle in one leaf.
+		float leafCost = bounds.area() * task.count;
+		if (bestCost >= leafCost) {
+			continue;
+		}
+
+		auto middle = std::partition(m_triangleIds.begin() + task.first,
+			m_triangleIds.begin() + task.first + task.count,
+			[&](uint32_t tri) { return binOf(tri) <= bestSplit; });
+		uint32_t leftCount = static_cast<uint32_t>(middle - (m_triangleIds.begin() + task.first));
+
+		uint32_t left = static_cast<uint32_t>(m_nodes.size());
+		m_nodes[task.node].firstOrLeft = left;
+		m_nodes[task.node].triangleCount = 0;
+		m_nodes.push_back(Node{});
+		m_nodes.push_back(Node{});
+		tasks.push_back(BuildTask{ left, task.first, leftCount, task.depth + 1 });
+		tasks.push_back(BuildTask{ left + 1, task.first + leftCount, task.count - leftCount, task.depth + 1 });
+	}
+
+	m_triangles.resize(count);
+	for (uint32_t i = 0; i < count; i++) {
+		const glm::vec3* v = &triangleVertices[3 * m_triangleIds[i]];
+		m_triangles[i] = Triangle{ v[0], v[1] - v[0], v[2] - v[0] };
+	}
+}
+
+bool TriangleBvh::intersect(const Ray& ray, RayHit& hit) const {
+	if (m_nodes.empty()) {
+		return false;
+	}
+	glm::vec3 inverseDirection = safeInverse(ray.direction);
+	float closest = ray.tMax;
+	bool found = false;
+
+	uint32_t stack[MAX_DEPTH];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const Node& node = m_nodes[stack[--stackSize]];
+		if (intersectBounds(node.boundsMin, node.boundsMax, ray.origin, inverseDirection, closest)
+			== std::numeric_limits<float>::infinity()) {
+			continue;
+		}
+		if (node.triangleCount > 0) {
+			for (uint32_t i = node.firstOrLeft; i < node.firstOrLeft + node.triangleCount; i++) {
+				float t, u, v;
+				if (intersectTriangle(m_triangles[i], ray, closest, t, u, v)) {
+					closest = t;
+					hit = RayHit{ t, m_triangleIds[i], u, v };
+					found = true;
+				}
+			}
+			continue;
+		}
+		// Visit the nearer child first, so the far one is more likely to be culled by `closest`.
+		uint32_t left = node.firstOrLeft;
+		float leftDistance = intersectBounds(m_nodes[left].boundsMin, m_nodes[left].boundsMax,
+			ray.origin, inverseDirection, closest);
+		float rightDistance = intersectBounds(m_nodes[left + 1].boundsMin, m_nodes[left + 1].boundsMax,
+			ray.origin, inverseDirection, closest);
+		if (leftDistance > rightDistance) {
+			std::swap(leftDistance, rightDistance);
+			left = left + 1;
+			if (rightDistance != std::numeric_limits<float>::infinity()) {
+				stack[stackSize++] = node.firstOrLeft;
+			}
+		}
+		else if (rightDistance != std::numeric_limits<float>::infinity()) {
+			stack[stackSize++] = left + 1;
+		}
+		if (leftDistance != std::numeric_limits<float>::infinity()) {
+			stack[stackSize++] = left;
+		}
+	}
+	return found;
+}
+
+bool TriangleBvh::occluded(const Ray& ray) const {
+	if (m_nodes.empty()) {
+		return false;
+	}
+	glm::vec3 inverseDirection = safeInverse(ray.direction);
+
+	uint32_t stack[MAX_DEPTH];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const Node& node = m_nodes[stack[--stackSize]];
+		if (intersectBounds(node.boundsMin, node.boundsMax, ray.origin, inverseDirection, ray.tMax)
+			== std::numeric_limits<float>::infinity()) {
+			continue;
+		}
+		if (node.triangleCount > 0) {
+			for (uint32_t i = node.firstOrLeft; i < node.firstOrLeft + node.triangleCount; i++) {
+				float t, u, v;
+				if (intersectTriangle(m_triangles[i], ray, ray.tMax, t, u, v)) {
+					return true;
+				}
+			}
+			continue;
+		}
+		stack[stackSize++] = node.firstOrLeft + 1;
+		stack[stackSize++] = node.firstOrLeft;
+	}
+	return false;
+}
+
+void TriangleBvh::overlapping(const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+	std::vector<uint32_t>& result) const {
+	if (m_nodes.empty()) {
+		return;
+	}
+	auto overlaps = [&](const glm::vec3& lower, const glm::vec3& upper) {
+		return lower.x <= boundsMax.x && upper.x >= boundsMin.x && lower.y <= boundsMax.y
+			&& upper.y >= boundsMin.y && lower.z <= boundsMax.z && upper.z >= boundsMin.z;
+	};
+
+	uint32_t stack[MAX_DEPTH];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const Node& node = m_nodes[stack[--stackSize]];
+		if (!overlaps(node.boundsMin, node.boundsMax)) {
+			continue;
+		}
+		if (node.triangleCount > 0) {
+			for (uint32_t i = node.firstOrLeft; i < node.firstOrLeft + node.triangleCount; i++) {
+				const Triangle& tri = m_triangles[i];
+				glm::vec3 v1 = tri.v0 + tri.edge1;
+				glm::vec3 v2 = tri.v0 + tri.edge2;
+				if (overlaps(glm::min(tri.v0, glm::min(v1, v2)), glm::max(tri.v0, glm::max(v1, v2)))) {
+					result.push_back(i);
+				}
+			}
+			continue;
+		}
+		stack[stackSize++] = node.firstOrLeft + 1;
+		stack[stackSize++] = node.firstOrLeft;
+	}
+}
+
+WideBvh::WideBvh(const TriangleBvh& binary)
+	: m_triangles(binary.triangles()), m_triangleIds(binary.triangleIds()) {
+	const auto& nodes = binary.nodes();
+	if (nodes.empty()) {
+		return;
+	}
+
+	auto surfaceArea = [](const TriangleBvh::Node& node) {
+		glm::vec3 e = node.boundsMax - node.boundsMin;
+		return e.x * e.y + e.y * e.z + e.z * e.x;
+	};
+
+	// Each task fills wide node `wide` with the binary subtree rooted at `binaryNode`.
+	struct CollapseTask {
+		uint32_t wide;
+		uint32_t binaryNode;
+	};
+	m_nodes.push_back(Node{});
+	std::vector<CollapseTask> tasks{ CollapseTask{ 0, 0 } };
+	while (!tasks.empty()) {
+		CollapseTask task = tasks.back();
+		tasks.pop_back();
+
+		// Open interior nodes, largest first, until there are four children or only leaves.
+		std::vector<uint32_t> children{ task.binaryNode };
+		if (nodes[task.binaryNode].triangleCount == 0) {
+			children = { nodes[task.binaryNode].firstOrLeft, nodes[task.binaryNode].firstOrLeft + 1 };
+		}
+		while (children.size() < WIDTH) {
+			int32_t best = -1;
+			for (size_t c = 0; c < children.size(); c++) {
+				if (nodes[children[c]].triangleCount == 0
+					&& (best < 0 || surfaceArea(nodes[children[c]]) > surfaceArea(nodes[children[best]]))) {
+					best = static_cast<int32_t>(c);
+				}
+			}
+			if (best < 0) {
+				break;
+			}
+			uint32_t opened = children[best];
+			children[best] = nodes[opened].firstOrLeft;
+			children.push_back(nodes[opened].firstOrLeft + 1);
+		}
+
+		Node node;
+		for (uint32_t lane = 0; lane < WIDTH; lane++) {
+			if (lane >= children.size()) {
+				// Empty lanes get inverted bounds, which no ray can enter.
+				node.minX[lane] = node.minY[lane] = node.minZ[lane] = std::numeric_limits<float>::max();
+				node.maxX[lane] = node.maxY[lane] = node.maxZ[lane] = -std::numeric_limits<float>::max();
+				node.child[lane] = 0;
+				node.triangleCount[lane] = 0;
+				continue;
+			}
+			const TriangleBvh::Node& child = nodes[children[lane]];
+			node.minX[lane] = child.boundsMin.x;
+			node.minY[lane] = child.boundsMin.y;
+			node.minZ[lane] = child.boundsMin.z;
+			node.maxX[lane] = child.boundsMax.x;
+			node.maxY[lane] = child.boundsMax.y;
+			node.maxZ[lane] = child.boundsMax.z;
+			node.triangleCount[lane] = child.triangleCount;
+			if (child.triangleCount > 0) {
+				node.child[lane] = child.firstOrLeft;
+			}
+			else {
+				node.child[lane] = static_cast<uint32_t>(m_nodes.size());
+				m_nodes.push_back(Node{});
+				tasks.push_back(CollapseTask{ node.child[lane], children[lane] });
+			}
+		}
+		m_nodes[task.wide] = node;
+	}
+}
+
+namespace {
+	/**
+	 * @brief Tests a ray against all four child boxes of a wide node. Written as plain loops over
+	 * the lanes so the compiler can keep everything in vector registers.
+	 * @return a bit mask of the lanes that were hit; their entry distances are in `distances`.
+	 */
+	inline uint32_t intersectLanes(const WideBvh::Node& node, const glm::vec3& origin,
+		const glm::vec3& inverseDirection, float tMax, float distances[WideBvh::WIDTH]) {
+		float enter[WideBvh::WIDTH];
+		float exit[WideBvh::WIDTH];
+		for (uint32_t lane = 0; lane < WideBvh::WIDTH; lane++) {
+			float tx0 = (node.minX[lane] - origin.x) * inverseDirection.x;
+			float tx1 = (node.maxX[lane] - origin.x) * inverseDirection.x;
+			float ty0 = (node.minY[lane] - origin.y) * inverseDirection.y;
+			float ty1 = (node.maxY[lane] - origin.y) * inverseDirection.y;
+			float tz0 = (node.minZ[lane] - origin.z) * inverseDirection.z;
+			float tz1 = (node.maxZ[lane] - origin.z) * inverseDirection.z;
+			enter[lane] = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), 0.0f));
+			exit[lane] = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::min(std::max(tz0, tz1), tMax));
+		}
+		uint32_t mask = 0;
+		for (uint32_t lane = 0; lane < WideBvh::WIDTH; lane++) {
+			distances[lane] = enter[lane];
+			mask |= (enter[lane] <= exit[lane] && node.minX[lane] <= node.maxX[lane] ? 1u : 0u) << lane;
+		}
+		return mask;
+	}
+}
+
+bool WideBvh::intersect(const Ray& ray, RayHit& hit) const {
+	if (m_nodes.empty()) {
+		return false;
+	}
+	glm::vec3 inverseDirection = safeInverse(ray.direction);
+	float closest = ray.tMax;
+	bool found = false;
+
+	// Entries are (node or leaf lane) with the distance they were entered at, so stale entries
+	// beyond a closer hit can be skipped when popped.
+	struct Entry {
+		uint32_t node;
+		uint32_t triangleCount;
+		float distance;
+	};
+	Entry stack[MAX_DEPTH * WIDTH];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = Entry{ 0, 0, 0 };
+	while (stackSize > 0) {
+		Entry entry = stack[--stackSize];
+		if (entry.distance > closest) {
+			continue;
+		}
+		if (entry.triangleCount > 0) {
+			for (uint32_t i = entry.node; i < entry.node + entry.triangleCount; i++) {
+				float t, u, v;
+				if (intersectTriangle(m_triangles[i], ray, closest, t, u, v)) {
+					closest = t;
+					hit = RayHit{ t, m_triangleIds[i], u, v };
+					found = true;
+				}
+			}
+			continue;
+		}
+
+		const Node& node = m_nodes[entry.node];
+		float distances[WIDTH];
+		uint32_t mask = intersectLanes(node, ray.origin, inverseDirection, closest, distances);
+		// Push hit children far to near, so the nearest is popped first.
+		Entry hits[WIDTH];
+		uint32_t hitCount = 0;
+		for (uint32_t lane = 0; lane < WIDTH; lane++) {
+			if (mask & (1u << lane)) {
+				Entry child{ node.child[lane], node.triangleCount[lane], distances[lane] };
+				uint32_t i = hitCount++;
+				while (i > 0 && hits[i - 1].distance < child.distance) {
+					hits[i] = hits[i - 1];
+					i--;
+				}
+				hits[i] = child;
+			}
+		}
+		for (uint32_t i = 0; i < hitCount; i++) {
+			stack[stackSize++] = hits[i];
+		}
+	}
+	return found;
+}
+
+bool WideBvh::occluded(const Ray& ray) const {
+	if (m_nodes.empty()) {
+		return false;
+	}
+	glm::vec3 inverseDirection = safeInverse(ray.direction);
+
+	uint32_t stack[MAX_DEPTH * WIDTH];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const Node& node = m_nodes[stack[--stackSize]];
+		float distances[WIDTH];
+		uint32_t mask = intersectLanes(node, ray.origin, inverseDirection, ray.tMax, distances);
+		for (uint32_t lane = 0; lane < WIDTH; lane++) {
+			if (!(mask & (1u << lane))) {
+				continue;
+			}
+			if (node.triangleCount[lane] == 0) {
+				stack[stackSize++] = node.child[lane];
+				continue;
+			}
+			for (uint32_t i = node.child[lane]; i < node.child[lane] + node.triangleCount[lane]; i++) {
+				float t, u, v;
+				if (intersectTriangle(m_triangles[i], ray, ray.tMax, t, u, v)) {
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
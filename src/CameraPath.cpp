@@ -0,0 +1,19 @@
+#include "CameraPath.h"
+#include <cmath>
+
+namespace {
+	const float ORBIT_RADIUS = 3.5f;
+	const float ORBIT_HEIGHT = 1.3f;
+	const glm::vec3 ORBIT_TARGET(0, 0.8f, 0);
+}
+
+CameraPose cameraPoseOnPath(const SplinePath& path, const glm::vec3& target, float progress) {
+	glm::vec3 position = path.pointAt(progress * path.length());
+	return CameraPose{ position, glm::normalize(target - position) };
+}
+
+CameraPose orbitCameraPose(float progress) {
+	static const SplinePath orbit = SplinePath::circle(glm::vec3(0, ORBIT_HEIGHT, 0), ORBIT_RADIUS);
+	// Runs longer than one turn keep going round.
+	return cameraPoseOnPath(orbit, ORBIT_TARGET, progress - std::floor(progress));
+}
@@ -0,0 +1,800 @@
+#include "CollisionShapes.h"
+#include "Bvh.h"
+#include "ContentHash.h"
+#include "Sampling.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <tuple>
+#include <unordered_map>
+
+namespace {
+	const uint32_t SHAPE_MAGIC = 0x32484353; // "SCH2"
+
+	struct ShapeHeader {
+		uint32_t magic;
+		// Used to reject a baked shape made from different triangles or settings. The hash catches a
+		// model that was moved, since the triangles are in world space.
+		uint32_t triangleCount;
+		uint64_t triangleHash;
+		uint32_t maxHulls;
+		float maxConcavity;
+		uint32_t planesPerAxis;
+		uint32_t hullCount;
+	};
+
+	// Quickhull snaps points to a grid this many cells across, coarse enough that its orientation
+	// tests are exact in 64-bit integers, so rounding can never turn the hull inside out.
+	const int64_t HULL_GRID = 1 << 20;
+
+	struct GridPoint {
+		int64_t x;
+		int64_t y;
+		int64_t z;
+	};
+
+	// A face of the hull under construction, wound counter-clockwise seen from outside, with the
+	// points still outside it.
+	struct HullFace {
+		uint32_t a;
+		uint32_t b;
+		uint32_t c;
+		std::vector<uint32_t> outside;
+		bool alive;
+	};
+
+	// A convex piece of the decomposition, with the triangles it was made from and the planes it was
+	// cut out with, as outward normals and offsets.
+	struct Piece {
+		std::vector<glm::vec3> triangles;
+		std::vector<glm::vec4> cuts;
+		ConvexHull hull;
+		float concavity;
+		// The diagonal of the hull's bounds.
+		float size;
+	};
+
+	uint64_t hashTriangles(const std::vector<glm::vec3>& triangles) {
+		ContentHash hash;
+		hash.add(triangles.data(), triangles.size() * sizeof(glm::vec3));
+		return hash.value();
+	}
+
+	int64_t coordinate(const GridPoint& p, int axis) {
+		return axis == 0 ? p.x : axis == 1 ? p.y : p.z;
+	}
+
+	glm::dvec3 toDouble(const GridPoint& p) {
+		return glm::dvec3(static_cast<double>(p.x), static_cast<double>(p.y), static_cast<double>(p.z));
+	}
+
+	/**
+	 * @brief Six times the signed volume of the tetrahedron abcp: positive when p is in front of
+	 * the triangle abc, wound counter-clockwise. Grid coordinates keep every product in range.
+	 */
+	int64_t orientation(const GridPoint& a, const GridPoint& b, const GridPoint& c, const GridPoint& p) {
+		int64_t abx = b.x - a.x, aby = b.y - a.y, abz = b.z - a.z;
+		int64_t acx = c.x - a.x, acy = c.y - a.y, acz = c.z - a.z;
+		int64_t nx = aby * acz - abz * acy;
+		int64_t ny = abz * acx - abx * acz;
+		int64_t nz = abx * acy - aby * acx;
+		return nx * (p.x - a.x) + ny * (p.y - a.y) + nz * (p.z - a.z);
+	}
+
+	uint64_t edgeKey(uint32_t from, uint32_t to) {
+		return static_cast<uint64_t>(from) << 32 | to;
+	}
+
+	void bounds(const std::vector<glm::vec3>& points, glm::vec3& lower, glm::vec3& upper) {
+		lower = glm::vec3(std::numeric_limits<float>::max());
+		upper = glm::vec3(-std::numeric_limits<float>::max());
+		for (auto& p : points) {
+			lower = glm::min(lower, p);
+			upper = glm::max(upper, p);
+		}
+	}
+
+	/**
+	 * @brief The hull of points that all lie in one plane: a polygon, with both windings of each
+	 * triangle so it faces both ways.
+	 */
+	ConvexHull planarHull(const std::vector<glm::vec3>& points, const glm::vec3& normal) {
+		glm::vec3 tangent, bitangent;
+		orthonormalBasis(normal, tangent, bitangent);
+		std::vector<uint32_t> order(points.size());
+		for (uint32_t i = 0; i < order.size(); i++) {
+			order[i] = i;
+		}
+		auto project = [&](uint32_t i) { return glm::vec2(glm::dot(points[i], tangent), glm::dot(points[i], bitangent)); };
+		std::sort(order.begin(), order.end(), [&](uint32_t i, uint32_t j) {
+			glm::vec2 p = project(i), q = project(j);
+			return p.x < q.x || (p.x == q.x && p.y < q.y);
+		});
+
+		// Andrew's monotone chain.
+		auto turn = [&](uint32_t o, uint32_t a, uint32_t b) {
+			glm::vec2 u = project(a) - project(o), v = project(b) - project(o);
+			return u.x * v.y - u.y * v.x;
+		};
+		std::vector<uint32_t> chain(2 * order.size());
+		size_t k = 0;
+		for (size_t i = 0; i < order.size(); i++) {
+			while (k >= 2 && turn(chain[k - 2], chain[k - 1], order[i]) <= 0) {
+				k--;
+			}
+			chain[k++] = order[i];
+		}
+		for (size_t i = order.size() - 1, lowerSize = k + 1; i > 0; i--) {
+			while (k >= lowerSize && turn(chain[k - 2], chain[k - 1], order[i - 1]) <= 0) {
+				k--;
+			}
+			chain[k++] = order[i - 1];
+		}
+		chain.resize(k > 0 ? k - 1 : 0);
+
+		ConvexHull hull;
+		if (chain.size() < 3) {
+			return hull;
+		}
+		for (uint32_t index : chain) {
+			hull.vertices.push_back(points[index]);
+		}
+		for (uint32_t i = 1; i + 1 < chain.size(); i++) {
+			hull.faces.insert(hull.faces.end(), { 0, i, i + 1, 0, i + 1, i });
+		}
+		return hull;
+	}
+
+	/**
+	 * @brief The eigenvectors of a symmetric matrix, as columns, by cyclic Jacobi rotations.
+	 */
+	glm::mat3 symmetricEigenvectors(glm::mat3 a) {
+		glm::mat3 vectors(1);
+		for (int sweep = 0; sweep < 16; sweep++) {
+			for (int p = 0; p < 2; p++) {
+				for (int q = p + 1; q < 3; q++) {
+					if (std::abs(a[q][p]) < 1e-12f) {
+						continue;
+					}
+					float theta = (a[q][q] - a[p][p]) / (2 * a[q][p]);
+					float t = std::copysign(1.0f, theta) / (std::abs(theta) + std::sqrt(theta * theta + 1));
+					float c = 1 / std::sqrt(t * t + 1);
+					float s = t * c;
+					glm::mat3 rotation(1);
+					rotation[p][p] = c;
+					rotation[q][q] = c;
+					rotation[q][p] = s;
+					rotation[p][q] = -s;
+					a = glm::transpose(rotation) * a * rotation;
+					vectors = vectors * rotation;
+				}
+			}
+		}
+		return vectors;
+	}
+
+	/**
+	 * @brief Cuts triangles by the plane where the given coordinate equals position, clipping the
+	 * ones that straddle it.
+	 */
+	void splitTriangles(const std::vector<glm::vec3>& triangles, int axis, float position,
+		std::vector<glm::vec3>& below, std::vector<glm::vec3>& above) {
+		for (size_t i = 0; i + 2 < triangles.size(); i += 3) {
+			const glm::vec3* corners = &triangles[i];
+			float side[3] = { corners[0][axis] - position, corners[1][axis] - position, corners[2][axis] - position };
+			if (side[0] <= 0 && side[1] <= 0 && side[2] <= 0) {
+				below.insert(below.end(), corners, corners + 3);
+				continue;
+			}
+			if (side[0] >= 0 && side[1] >= 0 && side[2] >= 0) {
+				above.insert(above.end(), corners, corners + 3);
+				continue;
+			}
+			// Sutherland-Hodgman against each side, then fan out the polygons.
+			glm::vec3 belowPolygon[4], abovePolygon[4];
+			int belowCount = 0, aboveCount = 0;
+			for (int j = 0; j < 3; j++) {
+				int next = (j + 1) % 3;
+				if (side[j] <= 0) {
+					belowPolygon[belowCount++] = corners[j];
+				}
+				if (side[j] >= 0) {
+					abovePolygon[aboveCount++] = corners[j];
+				}
+				if ((side[j] < 0 && side[next] > 0) || (side[j] > 0 && side[next] < 0)) {
+					glm::vec3 crossing = glm::mix(corners[j], corners[next], side[j] / (side[j] - side[next]));
+					belowPolygon[belowCount++] = crossing;
+					abovePolygon[aboveCount++] = crossing;
+				}
+			}
+			for (int j = 1; j + 1 < belowCount; j++) {
+				below.insert(below.end(), { belowPolygon[0], belowPolygon[j], belowPolygon[j + 1] });
+			}
+			for (int j = 1; j + 1 < aboveCount; j++) {
+				above.insert(above.end(), { abovePolygon[0], abovePolygon[j], abovePolygon[j + 1] });
+			}
+		}
+	}
+
+	/**
+	 * @brief Whether a face, given by its unit normal and a point on it, lies on one of the planes
+	 * its piece was cut out with.
+	 */
+	bool onCut(const glm::vec3& normal, const glm::vec3& point, const std::vector<glm::vec4>& cuts, float tolerance) {
+		for (auto& cut : cuts) {
+			if (glm::dot(normal, glm::vec3(cut)) > 0.999f && std::abs(glm::dot(point, glm::vec3(cut)) - cut.w) < tolerance) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * @brief Clips a convex polygon to the part behind a plane, where dot(normal, p) <= offset, or
+	 * with inFront, to the part in front of it.
+	 * @return the clipped polygon, or nothing if too little of it is left to have an area.
+	 */
+	std::vector<glm::vec3> clipPolygon(const std::vector<glm::vec3>& polygon, const glm::vec3& normal, float offset,
+		bool inFront) {
+		std::vector<glm::vec3> clipped;
+		for (size_t j = 0; j < polygon.size(); j++) {
+			const glm::vec3& from = polygon[j];
+			const glm::vec3& to = polygon[(j + 1) % polygon.size()];
+			float sign = inFront ? -1.0f : 1.0f;
+			float fromSide = sign * (glm::dot(normal, from) - offset);
+			float toSide = sign * (glm::dot(normal, to) - offset);
+			if (fromSide <= 0) {
+				clipped.push_back(from);
+			}
+			if ((fromSide < 0 && toSide > 0) || (fromSide > 0 && toSide < 0)) {
+				clipped.push_back(glm::mix(from, to, fromSide / (fromSide - toSide)));
+			}
+		}
+		if (clipped.size() < 3) {
+			clipped.clear();
+		}
+		return clipped;
+	}
+
+	/**
+	 * @brief Cuts away the parts of convex polygons inside a convex hull. Each of the hull's face
+	 * planes in turn peels off what lies in front of it; what is left behind them all is inside.
+	 */
+	void subtractHull(std::vector<std::vector<glm::vec3>>& polygons, const ConvexHull& hull, float tolerance) {
+		std::vector<std::vector<glm::vec3>> outside, peeled;
+		for (auto& polygon : polygons) {
+			peeled.clear();
+			std::vector<glm::vec3> remaining = polygon;
+			for (size_t i = 0; i + 2 < hull.faces.size() && !remaining.empty(); i += 3) {
+				const glm::vec3& v0 = hull.vertices[hull.faces[i]];
+				glm::vec3 normal = glm::cross(hull.vertices[hull.faces[i + 1]] - v0, hull.vertices[hull.faces[i + 2]] - v0);
+				float area = glm::length(normal);
+				if (area <= 0) {
+					continue;
+				}
+				normal /= area;
+				// Points within the tolerance count as inside, so a face on the same plane covers.
+				float offset = glm::dot(normal, v0) + tolerance;
+				std::vector<glm::vec3> front = clipPolygon(remaining, normal, offset, true);
+				if (!front.empty()) {
+					peeled.push_back(std::move(front));
+				}
+				remaining = clipPolygon(remaining, normal, offset, false);
+			}
+			// A polygon the hull doesn't reach stays whole rather than in pieces.
+			if (remaining.empty()) {
+				outside.push_back(std::move(polygon));
+			}
+			else {
+				outside.insert(outside.end(), std::make_move_iterator(peeled.begin()), std::make_move_iterator(peeled.end()));
+			}
+		}
+		polygons = std::move(outside);
+	}
+
+	/**
+	 * @brief How far a hull stands off the surface it wraps: the furthest that rays cast inwards
+	 * from points on its faces travel before they reach the surface.
+	 *
+	 * Faces on the planes the piece was cut out with are skipped, since the neighbouring piece
+	 * covers them; so are rays that hit nothing, which went through an open mesh.
+	 */
+	float concavity(const ConvexHull& hull, const std::vector<glm::vec4>& cuts, const TriangleBvh& surface) {
+		if (hull.volume() <= 0) {
+			return 0;
+		}
+		glm::vec3 lower, upper;
+		bounds(hull.vertices, lower, upper);
+		float size = glm::length(upper - lower);
+		// Rays start just outside the hull, so surfaces the hull lies on are still hit.
+		float offset = 1e-4f * size;
+		float deepest = 0;
+		for (size_t i = 0; i + 2 < hull.faces.size(); i += 3) {
+			glm::vec3 corners[3] = { hull.vertices[hull.faces[i]], hull.vertices[hull.faces[i + 1]],
+				hull.vertices[hull.faces[i + 2]] };
+			glm::vec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+			float area = glm::length(normal);
+			if (area <= 0) {
+				continue;
+			}
+			normal /= area;
+			glm::vec3 centroid = (corners[0] + corners[1] + corners[2]) / 3.0f;
+			if (onCut(normal, centroid, cuts, offset)) {
+				continue;
+			}
+			glm::vec3 samples[4] = { centroid, (centroid + corners[0]) * 0.5f, (centroid + corners[1]) * 0.5f,
+				(centroid + corners[2]) * 0.5f };
+			for (auto& sample : samples) {
+				RayHit hit;
+				if (surface.intersect(Ray{ sample + normal * offset, -normal, size }, hit)) {
+					deepest = std::max(deepest, hit.t - offset);
+				}
+			}
+		}
+		return deepest;
+	}
+
+	template <typename T>
+	void writeValue(std::ofstream& out, const T& value) {
+		out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	bool readValue(std::ifstream& in, T& value) {
+		return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+	}
+}
+
+float ConvexHull::volume() const {
+	// Signed tetrahedra from the origin to each face.
+	float volume = 0;
+	for (size_t i = 0; i + 2 < faces.size(); i += 3) {
+		volume += glm::dot(vertices[faces[i]], glm::cross(vertices[faces[i + 1]], vertices[faces[i + 2]]));
+	}
+	return std::max(volume / 6, 0.0f);
+}
+
+void CollisionShape::appendTriangles(std::vector<glm::vec3>& triangles) const {
+	float tolerance = 1e-4f * glm::length(upper - lower);
+	std::vector<std::vector<glm::vec3>> uncovered;
+	for (size_t h = 0; h < hulls.size(); h++) {
+		const ConvexHull& hull = hulls[h];
+		for (size_t i = 0; i + 2 < hull.faces.size(); i += 3) {
+			glm::vec3 corners[3] = { hull.vertices[hull.faces[i]], hull.vertices[hull.faces[i + 1]],
+				hull.vertices[hull.faces[i + 2]] };
+			glm::vec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+			float area = glm::length(normal);
+			if (area <= 0 || !onCut(normal / area, corners[0], hull.cuts, tolerance)) {
+				triangles.insert(triangles.end(), corners, corners + 3);
+				continue;
+			}
+			// Only what the hulls across the cut don't cover is on the outside. Flat hulls have no
+			// inside to cover anything with.
+			uncovered.assign(1, std::vector<glm::vec3>(corners, corners + 3));
+			for (size_t other = 0; other < hulls.size() && !uncovered.empty(); other++) {
+				if (other != h && hulls[other].volume() > 0) {
+					subtractHull(uncovered, hulls[other], tolerance);
+				}
+			}
+			for (auto& polygon : uncovered) {
+				for (size_t j = 1; j + 1 < polygon.size(); j++) {
+					triangles.insert(triangles.end(), { polygon[0], polygon[j], polygon[j + 1] });
+				}
+			}
+		}
+	}
+}
+
+size_t CollisionShape::triangleCount() const {
+	size_t count = 0;
+	for (auto& hull : hulls) {
+		count += hull.faces.size() / 3;
+	}
+	return count;
+}
+
+ConvexHull quickhull(const std::vector<glm::vec3>& points) {
+	ConvexHull hull;
+	if (points.size() < 3) {
+		return hull;
+	}
+	glm::vec3 lower, upper;
+	bounds(points, lower, upper);
+	glm::vec3 extent = upper - lower;
+	float cellSize = std::max(extent.x, std::max(extent.y, extent.z)) / HULL_GRID;
+	if (cellSize <= 0) {
+		return hull;
+	}
+
+	// Snap to the grid and drop the duplicates; each grid point remembers one original point to
+	// output.
+	std::vector<std::pair<GridPoint, uint32_t>> snapped(points.size());
+	for (uint32_t i = 0; i < points.size(); i++) {
+		glm::vec3 cell = (points[i] - lower) / cellSize;
+		snapped[i] = { GridPoint{ std::llround(cell.x), std::llround(cell.y), std::llround(cell.z) }, i };
+	}
+	auto gridLess = [](const std::pair<GridPoint, uint32_t>& p, const std::pair<GridPoint, uint32_t>& q) {
+		return std::tie(p.first.x, p.first.y, p.first.z) < std::tie(q.first.x, q.first.y, q.first.z);
+	};
+	std::sort(snapped.begin(), snapped.end(), gridLess);
+	std::vector<GridPoint> grid;
+	std::vector<uint32_t> original;
+	for (size_t i = 0; i < snapped.size(); i++) {
+		if (i == 0 || gridLess(snapped[i - 1], snapped[i])) {
+			grid.push_back(snapped[i].first);
+			original.push_back(snapped[i].second);
+		}
+	}
+	if (grid.size() < 3) {
+		return hull;
+	}
+
+	// Start from a large tetrahedron: the farthest pair of axis extremes, the point farthest from
+	// their line, then the point farthest from their plane.
+	uint32_t extremes[6] = { 0, 0, 0, 0, 0, 0 };
+	for (uint32_t i = 0; i < grid.size(); i++) {
+		for (int axis = 0; axis < 3; axis++) {
+			if (coordinate(grid[i], axis) < coordinate(grid[extremes[2 * axis]], axis)) {
+				extremes[2 * axis] = i;
+			}
+			if (coordinate(grid[i], axis) > coordinate(grid[extremes[2 * axis + 1]], axis)) {
+				extremes[2 * axis + 1] = i;
+			}
+		}
+	}
+	uint32_t i0 = 0, i1 = 0;
+	int64_t farthestPair = 0;
+	for (int a = 0; a < 6; a++) {
+		for (int b = a + 1; b < 6; b++) {
+			glm::dvec3 d = toDouble(grid[extremes[a]]) - toDouble(grid[extremes[b]]);
+			int64_t squared = static_cast<int64_t>(glm::dot(d, d));
+			if (squared > farthestPair) {
+				farthestPair = squared;
+				i0 = extremes[a];
+				i1 = extremes[b];
+			}
+		}
+	}
+	uint32_t i2 = i0;
+	double farthestFromLine = 0;
+	glm::dvec3 lineDirection = toDouble(grid[i1]) - toDouble(grid[i0]);
+	for (uint32_t i = 0; i < grid.size(); i++) {
+		double d = glm::length(glm::cross(toDouble(grid[i]) - toDouble(grid[i0]), lineDirection));
+		if (d > farthestFromLine) {
+			farthestFromLine = d;
+			i2 = i;
+		}
+	}
+	if (i2 == i0) {
+		return hull;
+	}
+	uint32_t i3 = i0;
+	int64_t farthestFromPlane = 0;
+	for (uint32_t i = 0; i < grid.size(); i++) {
+		int64_t d = orientation(grid[i0], grid[i1], grid[i2], grid[i]);
+		if (std::abs(d) > std::abs(farthestFromPlane)) {
+			farthestFromPlane = d;
+			i3 = i;
+		}
+	}
+	if (farthestFromPlane == 0) {
+		glm::vec3 normal = glm::cross(points[original[i1]] - points[original[i0]], points[original[i2]] - points[original[i0]]);
+		return planarHull(points, glm::normalize(normal));
+	}
+
+	std::vector<HullFace> faces;
+	// Each directed edge of a live face, mapped to that face, to walk between neighbours.
+	std::unordered_map<uint64_t, uint32_t> edgeFaces;
+	auto addFace = [&](uint32_t a, uint32_t b, uint32_t c) {
+		faces.push_back(HullFace{ a, b, c, {}, true });
+		uint32_t face = static_cast<uint32_t>(faces.size() - 1);
+		edgeFaces[edgeKey(a, b)] = face;
+		edgeFaces[edgeKey(b, c)] = face;
+		edgeFaces[edgeKey(c, a)] = face;
+		return face;
+	};
+	auto height = [&](const HullFace& face, uint32_t point) {
+		return orientation(grid[face.a], grid[face.b], grid[face.c], grid[point]);
+	};
+
+	// Wind the tetrahedron outwards: i3 must be behind the first face.
+	if (farthestFromPlane > 0) {
+		std::swap(i1, i2);
+	}
+	addFace(i0, i1, i2);
+	addFace(i0, i3, i1);
+	addFace(i1, i3, i2);
+	addFace(i2, i3, i0);
+	for (uint32_t i = 0; i < grid.size(); i++) {
+		for (auto& face : faces) {
+			if (height(face, i) > 0) {
+				face.outside.push_back(i);
+				break;
+			}
+		}
+	}
+
+	std::vector<uint32_t> visible, stack, orphans;
+	std::vector<std::pair<uint32_t, uint32_t>> horizon;
+	std::vector<bool> isVisible;
+	for (uint32_t current = 0; current < faces.size(); current++) {
+		if (!faces[current].alive || faces[current].outside.empty()) {
+			continue;
+		}
+		// The point farthest out from this face is certainly on the hull.
+		uint32_t eye = faces[current].outside.front();
+		for (uint32_t point : faces[current].outside) {
+			if (height(faces[current], point) > height(faces[current], eye)) {
+				eye = point;
+			}
+		}
+
+		// Flood out from this face to every face the eye sees; their boundary is the horizon.
+		visible.clear();
+		horizon.clear();
+		isVisible.assign(faces.size(), false);
+		stack.assign(1, current);
+		isVisible[current] = true;
+		while (!stack.empty()) {
+			uint32_t face = stack.back();
+			stack.pop_back();
+			visible.push_back(face);
+			uint32_t corners[3] = { faces[face].a, faces[face].b, faces[face].c };
+			for (int j = 0; j < 3; j++) {
+				uint32_t other = edgeFaces.at(edgeKey(corners[(j + 1) % 3], corners[j]));
+				if (!isVisible[other] && height(faces[other], eye) > 0) {
+					isVisible[other] = true;
+					stack.push_back(other);
+				}
+			}
+		}
+		for (uint32_t face : visible) {
+			uint32_t corners[3] = { faces[face].a, faces[face].b, faces[face].c };
+			for (int j = 0; j < 3; j++) {
+				if (!isVisible[edgeFaces.at(edgeKey(corners[(j + 1) % 3], corners[j]))]) {
+					horizon.push_back({ corners[j], corners[(j + 1) % 3] });
+				}
+			}
+		}
+
+		// Replace the visible faces with a cone from the horizon to the eye. Every point outside the
+		// new hull is outside one of the new faces.
+		orphans.clear();
+		for (uint32_t face : visible) {
+			HullFace& dead = faces[face];
+			dead.alive = false;
+			for (uint32_t point : dead.outside) {
+				if (point != eye) {
+					orphans.push_back(point);
+				}
+			}
+			dead.outside.clear();
+			dead.outside.shrink_to_fit();
+			for (auto key : { edgeKey(dead.a, dead.b), edgeKey(dead.b, dead.c), edgeKey(dead.c, dead.a) }) {
+				edgeFaces.erase(key);
+			}
+		}
+		uint32_t firstNew = static_cast<uint32_t>(faces.size());
+		for (auto& [from, to] : horizon) {
+			addFace(from, to, eye);
+		}
+		for (uint32_t point : orphans) {
+			for (uint32_t face = firstNew; face < faces.size(); face++) {
+				if (height(faces[face], point) > 0) {
+					faces[face].outside.push_back(point);
+					break;
+				}
+			}
+		}
+	}
+
+	std::unordered_map<uint32_t, uint32_t> remap;
+	for (auto& face : faces) {
+		if (!face.alive) {
+			continue;
+		}
+		for (uint32_t point : { face.a, face.b, face.c }) {
+			auto [entry, inserted] = remap.try_emplace(point, static_cast<uint32_t>(hull.vertices.size()));
+			if (inserted) {
+				hull.vertices.push_back(points[original[point]]);
+			}
+			hull.faces.push_back(entry->second);
+		}
+	}
+	return hull;
+}
+
+OrientedBox fitOrientedBox(const std::vector<glm::vec3>& points) {
+	glm::vec3 lower, upper;
+	bounds(points, lower, upper);
+	OrientedBox aligned{ (lower + upper) * 0.5f, glm::mat3(1), (upper - lower) * 0.5f };
+	if (points.size() < 4) {
+		return aligned;
+	}
+
+	glm::vec3 mean(0);
+	for (auto& p : points) {
+		mean += p;
+	}
+	mean /= static_cast<float>(points.size());
+	glm::mat3 covariance(0);
+	for (auto& p : points) {
+		glm::vec3 d = p - mean;
+		for (int column = 0; column < 3; column++) {
+			covariance[column] += d * d[column];
+		}
+	}
+	glm::mat3 axes = symmetricEigenvectors(covariance);
+	for (int axis = 0; axis < 3; axis++) {
+		axes[axis] = glm::normalize(axes[axis]);
+	}
+
+	glm::vec3 localLower(std::numeric_limits<float>::max());
+	glm::vec3 localUpper(-std::numeric_limits<float>::max());
+	for (auto& p : points) {
+		glm::vec3 local = glm::transpose(axes) * p;
+		localLower = glm::min(localLower, local);
+		localUpper = glm::max(localUpper, local);
+	}
+	glm::vec3 halfExtents = (localUpper - localLower) * 0.5f;
+	if (halfExtents.x * halfExtents.y * halfExtents.z
+		>= aligned.halfExtents.x * aligned.halfExtents.y * aligned.halfExtents.z) {
+		return aligned;
+	}
+	return OrientedBox{ axes * ((localLower + localUpper) * 0.5f), axes, halfExtents };
+}
+
+std::vector<ConvexHull> decomposeConvex(const std::vector<glm::vec3>& triangles,
+	const CollisionShapeSettings& settings) {
+	TriangleBvh surface(triangles);
+	std::vector<Piece> pieces;
+	auto addPiece = [&](std::vector<glm::vec3>&& pieceTriangles, std::vector<glm::vec4>&& cuts) {
+		if (pieceTriangles.empty()) {
+			return;
+		}
+		ConvexHull hull = quickhull(pieceTriangles);
+		float depth = concavity(hull, cuts, surface);
+		glm::vec3 lower, upper;
+		bounds(hull.vertices, lower, upper);
+		float size = hull.vertices.empty() ? 0 : glm::length(upper - lower);
+		pieces.push_back(Piece{ std::move(pieceTriangles), std::move(cuts), std::move(hull), depth, size });
+	};
+	addPiece(std::vector<glm::vec3>(triangles), {});
+
+	std::vector<glm::vec3> below, above, bestBelow, bestAbove;
+	while (pieces.size() < settings.maxHulls) {
+		// Cut wherever the hulls are furthest off the surface, over the largest area: a gap over a
+		// tabletop matters more than one in a table leg's moulding.
+		Piece* deepest = nullptr;
+		float deepestError = 0;
+		for (auto& piece : pieces) {
+			float error = piece.concavity * piece.size;
+			if (piece.concavity > settings.maxConcavity && (!deepest || error > deepestError)) {
+				deepest = &piece;
+				deepestError = error;
+			}
+		}
+		if (!deepest) {
+			break;
+		}
+
+		// The cut that leaves the least empty space in the halves' hulls.
+		glm::vec3 lower, upper;
+		bounds(deepest->hull.vertices, lower, upper);
+		float bestVolume = std::numeric_limits<float>::max();
+		glm::vec4 bestCut;
+		for (int axis = 0; axis < 3; axis++) {
+			for (uint32_t k = 1; k <= settings.planesPerAxis; k++) {
+				float position = lower[axis] + (upper[axis] - lower[axis]) * k / (settings.planesPerAxis + 1);
+				below.clear();
+				above.clear();
+				splitTriangles(deepest->triangles, axis, position, below, above);
+				if (below.empty() || above.empty()) {
+					continue;
+				}
+				float volume = quickhull(below).volume() + quickhull(above).volume();
+				if (volume < bestVolume) {
+					bestVolume = volume;
+					bestCut = glm::vec4(0);
+					bestCut[axis] = 1;
+					bestCut.w = position;
+					std::swap(below, bestBelow);
+					std::swap(above, bestAbove);
+				}
+			}
+		}
+		if (bestBelow.empty()) {
+			// Too thin to cut; leave it as it is.
+			deepest->concavity = 0;
+			continue;
+		}
+
+		std::vector<glm::vec4> belowCuts = deepest->cuts, aboveCuts = deepest->cuts;
+		belowCuts.push_back(bestCut);
+		aboveCuts.push_back(-bestCut);
+		*deepest = std::move(pieces.back());
+		pieces.pop_back();
+		addPiece(std::move(bestBelow), std::move(belowCuts));
+		addPiece(std::move(bestAbove), std::move(aboveCuts));
+		bestBelow.clear();
+		bestAbove.clear();
+	}
+
+	std::vector<ConvexHull> hulls;
+	for (auto& piece : pieces) {
+		if (!piece.hull.faces.empty()) {
+			piece.hull.cuts = std::move(piece.cuts);
+			hulls.push_back(std::move(piece.hull));
+		}
+	}
+	return hulls;
+}
+
+CollisionShape buildCollisionShape(const std::vector<glm::vec3>& triangles, const CollisionShapeSettings& settings) {
+	CollisionShape shape;
+	bounds(triangles, shape.lower, shape.upper);
+	// Only the outermost points matter for the box, and the hull has far fewer of them.
+	ConvexHull outer = quickhull(triangles);
+	shape.box = fitOrientedBox(outer.vertices.empty() ? triangles : outer.vertices);
+	shape.hulls = decomposeConvex(triangles, settings);
+	return shape;
+}
+
+void saveCollisionShape(const std::filesystem::path& path, const CollisionShape& shape,
+	const std::vector<glm::vec3>& triangles, const CollisionShapeSettings& settings) {
+	// Written as raw bytes, so zeroed first to keep any padding out of the file.
+	ShapeHeader header{};
+	header.magic = SHAPE_MAGIC;
+	header.triangleCount = static_cast<uint32_t>(triangles.size() / 3);
+	header.triangleHash = hashTriangles(triangles);
+	header.maxHulls = settings.maxHulls;
+	header.maxConcavity = settings.maxConcavity;
+	header.planesPerAxis = settings.planesPerAxis;
+	header.hullCount = static_cast<uint32_t>(shape.hulls.size());
+	std::ofstream out(path, std::ios::binary);
+	writeValue(out, header);
+	writeValue(out, shape.lower);
+	writeValue(out, shape.upper);
+	writeValue(out, shape.box);
+	for (auto& hull : shape.hulls) {
+		uint32_t counts[3] = { static_cast<uint32_t>(hull.vertices.size()), static_cast<uint32_t>(hull.faces.size()),
+			static_cast<uint32_t>(hull.cuts.size()) };
+		writeValue(out, counts);
+		out.write(reinterpret_cast<const char*>(hull.vertices.data()), hull.vertices.size() * sizeof(glm::vec3));
+		out.write(reinterpret_cast<const char*>(hull.faces.data()), hull.faces.size() * sizeof(uint32_t));
+		out.write(reinterpret_cast<const char*>(hull.cuts.data()), hull.cuts.size() * sizeof(glm::vec4));
+	}
+}
+
+bool loadCollisionShape(const std::filesystem::path& path, const std::vector<glm::vec3>& triangles,
+	const CollisionShapeSettings& settings, CollisionShape& shape) {
+	std::ifstream in(path, std::ios::binary);
+	ShapeHeader header;
+	if (!readValue(in, header) || header.magic != SHAPE_MAGIC || header.triangleCount != triangles.size() / 3
+		|| header.maxHulls != settings.maxHulls || header.maxConcavity != settings.maxConcavity
+		|| header.planesPerAxis != settings.planesPerAxis || header.triangleHash != hashTriangles(triangles)) {
+		return false;
+	}
+	if (!readValue(in, shape.lower) || !readValue(in, shape.upper) || !readValue(in, shape.box)) {
+		return false;
+	}
+	shape.hulls.resize(header.hullCount);
+	for (auto& hull : shape.hulls) {
+		uint32_t counts[3];
+		if (!readValue(in, counts)) {
+			return false;
+		}
+		hull.vertices.resize(counts[0]);
+		hull.faces.resize(counts[1]);
+		hull.cuts.resize(counts[2]);
+		in.read(reinterpret_cast<char*>(hull.vertices.data()), hull.vertices.size() * sizeof(glm::vec3));
+		in.read(reinterpret_cast<char*>(hull.faces.data()), hull.faces.size() * sizeof(uint32_t));
+		in.read(reinterpret_cast<char*>(hull.cuts.data()), hull.cuts.size() * sizeof(glm::vec4));
+		if (!in) {
+			return false;
+		}
+	}
+	return true;
+}
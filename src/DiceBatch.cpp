@@ -0,0 +1,242 @@
+#include "DiceBatch.h"
+#include <algorithm>
+#include <cmath>
+#include "ContactModel.h"
+#include "Sampling.h"
+
+namespace {
+	const uint32_t CORNERS = 8;
+	const float CORNER_SIGNS[CORNERS][3] = {
+		{ -1, -1, -1 }, { 1, -1, -1 }, { -1, 1, -1 }, { 1, 1, -1 },
+		{ -1, -1, 1 }, { 1, -1, 1 }, { -1, 1, 1 }, { 1, 1, 1 },
+	};
+
+	// The faces along +x, +y and +z; the opposite faces add up to 7.
+	const int POSITIVE_FACES[3] = { 1, 2, 3 };
+
+	/**
+	 * @brief The corner contacts of one packet against the felt, for one step.
+	 */
+	struct PacketContacts {
+		// From each die's center to where its corner meets the felt.
+		float offsetX[CORNERS][DiceBatch::WIDTH];
+		float offsetY[CORNERS][DiceBatch::WIDTH];
+		float offsetZ[CORNERS][DiceBatch::WIDTH];
+		// Zero for corners clear of the felt, so they take no impulse.
+		float normalMass[CORNERS][DiceBatch::WIDTH];
+		float tangentMassX[CORNERS][DiceBatch::WIDTH];
+		float tangentMassZ[CORNERS][DiceBatch::WIDTH];
+		float velocityBias[CORNERS][DiceBatch::WIDTH];
+		float normalImpulse[CORNERS][DiceBatch::WIDTH];
+		float tangentImpulseX[CORNERS][DiceBatch::WIDTH];
+		float tangentImpulseZ[CORNERS][DiceBatch::WIDTH];
+	};
+}
+
+DiceBatch::DiceBatch(uint32_t count, const DiceThrowSettings& dice, const PhysicsSettings& physics)
+	: m_dice(dice), m_physics(physics), m_count(count), m_packets((count + WIDTH - 1) / WIDTH) {
+}
+
+void DiceBatch::throwDice(uint64_t seed, uint64_t firstRoll) {
+	for (uint32_t die = 0; die < m_packets.size() * WIDTH; die++) {
+		Packet& packet = m_packets[die / WIDTH];
+		uint32_t lane = die % WIDTH;
+		CounterRng rng(seed, firstRoll + die);
+		auto between = [&](float lower, float upper) { return lower + (upper - lower) * rng.next(); };
+
+		const DiceThrow& base = m_dice.throws[(firstRoll + die) % m_dice.throws.size()];
+		auto jitter = [&](float value, float amount) { return between(value - amount, value + amount); };
+
+		packet.positionX[lane] = 0;
+		packet.positionY[lane] = jitter(base.position.y - m_dice.feltHeight, m_dice.positionJitter);
+		packet.positionZ[lane] = 0;
+		packet.orientationW[lane] = 1;
+		packet.orientationX[lane] = 0;
+		packet.orientationY[lane] = 0;
+		packet.orientationZ[lane] = 0;
+		packet.velocityX[lane] = jitter(base.velocity.x, m_dice.velocityJitter);
+		packet.velocityY[lane] = jitter(base.velocity.y, m_dice.velocityJitter);
+		packet.velocityZ[lane] = jitter(base.velocity.z, m_dice.velocityJitter);
+		packet.angularVelocityX[lane] = jitter(base.angularVelocity.x, m_dice.spinJitter);
+		packet.angularVelocityY[lane] = jitter(base.angularVelocity.y, m_dice.spinJitter);
+		packet.angularVelocityZ[lane] = jitter(base.angularVelocity.z, m_dice.spinJitter);
+		packet.restingTime[lane] = 0;
+		packet.awake[lane] = die < m_count ? 1.0f : 0.0f;
+	}
+}
+
+void DiceBatch::step(float dt) {
+	// Packets whose dice have all come to rest cost nothing.
+	for (auto& packet : m_packets) {
+		float awake = 0;
+		for (uint32_t i = 0; i < WIDTH; i++) {
+			awake += packet.awake[i];
+		}
+		if (awake > 0) {
+			stepPacket(packet, dt);
+		}
+	}
+}
+
+void DiceBatch::stepPacket(Packet& p, float dt) const {
+	float h = m_dice.halfSize;
+	float inverseMass = 1 / m_dice.mass;
+	// A solid cube: I = m (2h)^2 / 6 about every axis.
+	float inverseInertia = 6 / (m_dice.mass * 4 * h * h);
+	float linearKeep = std::max(0.0f, 1 - m_physics.linearDamping * dt);
+	float angularKeep = std::max(0.0f, 1 - m_physics.angularDamping * dt);
+
+	for (uint32_t i = 0; i < WIDTH; i++) {
+		float keep = linearKeep * p.awake[i];
+		p.velocityX[i] = (p.velocityX[i] + m_physics.gravity.x * dt) * keep;
+		p.velocityY[i] = (p.velocityY[i] + m_physics.gravity.y * dt) * keep;
+		p.velocityZ[i] = (p.velocityZ[i] + m_physics.gravity.z * dt) * keep;
+		p.angularVelocityX[i] *= angularKeep * p.awake[i];
+		p.angularVelocityY[i] *= angularKeep * p.awake[i];
+		p.angularVelocityZ[i] *= angularKeep * p.awake[i];
+	}
+
+	// Corners against the felt at y = 0, whose normal is +y and tangents are x and z.
+	PacketContacts c;
+	float rotation[3][3][WIDTH];
+	for (uint32_t i = 0; i < WIDTH; i++) {
+		float w = p.orientationW[i], x = p.orientationX[i], y = p.orientationY[i], z = p.orientationZ[i];
+		// rotation[column][row], as in glm.
+		rotation[0][0][i] = 1 - 2 * (y * y + z * z);
+		rotation[0][1][i] = 2 * (x * y + w * z);
+		rotation[0][2][i] = 2 * (x * z - w * y);
+		rotation[1][0][i] = 2 * (x * y - w * z);
+		rotation[1][1][i] = 1 - 2 * (x * x + z * z);
+		rotation[1][2][i] = 2 * (y * z + w * x);
+		rotation[2][0][i] = 2 * (x * z + w * y);
+		rotation[2][1][i] = 2 * (y * z - w * x);
+		rotation[2][2][i] = 1 - 2 * (x * x + y * y);
+	}
+	for (uint32_t k = 0; k < CORNERS; k++) {
+		float sx = CORNER_SIGNS[k][0] * h, sy = CORNER_SIGNS[k][1] * h, sz = CORNER_SIGNS[k][2] * h;
+		for (uint32_t i = 0; i < WIDTH; i++) {
+			float cornerX = rotation[0][0][i] * sx + rotation[1][0][i] * sy + rotation[2][0][i] * sz;
+			float cornerY = rotation[0][1][i] * sx + rotation[1][1][i] * sy + rotation[2][1][i] * sz;
+			float cornerZ = rotation[0][2][i] * sx + rotation[1][2][i] * sy + rotation[2][2][i] * sz;
+			float distance = p.positionY[i] + cornerY;
+			float touching = p.awake[i] * (distance <= ContactModel::CONTACT_MARGIN);
+			float rx = cornerX, ry = -p.positionY[i], rz = cornerZ;
+			c.offsetX[k][i] = rx;
+			c.offsetY[k][i] = ry;
+			c.offsetZ[k][i] = rz;
+			// 1 / (1/m + (r x n)^2 / I) for n along y, x and z.
+			c.normalMass[k][i] = touching / (inverseMass + inverseInertia * (rx * rx + rz * rz));
+			c.tangentMassX[k][i] = touching / (inverseMass + inverseInertia * (ry * ry + rz * rz));
+			c.tangentMassZ[k][i] = touching / (inverseMass + inverseInertia * (rx * rx + ry * ry));
+
+			float approach = -(p.velocityY[i] + p.angularVelocityZ[i] * rx - p.angularVelocityX[i] * rz);
+			c.velocityBias[k][i] = ContactModel::velocityBias(approach, m_dice.restitution, -distance, dt);
+			c.normalImpulse[k][i] = 0;
+			c.tangentImpulseX[k][i] = 0;
+			c.tangentImpulseZ[k][i] = 0;
+		}
+	}
+
+	// Sequential impulses, friction before non-penetration as in PhysicsWorld::solveContact.
+	for (uint32_t iteration = 0; iteration < m_physics.solverIterations; iteration++) {
+		for (uint32_t k = 0; k < CORNERS; k++) {
+			for (uint32_t i = 0; i < WIDTH; i++) {
+				float rx = c.offsetX[k][i], ry = c.offsetY[k][i], rz = c.offsetZ[k][i];
+				float limit = m_dice.friction * c.normalImpulse[k][i];
+
+				float velocityX = p.velocityX[i] + p.angularVelocityY[i] * rz - p.angularVelocityZ[i] * ry;
+				float j = ContactModel::frictionImpulse(c.tangentImpulseX[k][i], velocityX, c.tangentMassX[k][i], limit);
+				p.velocityX[i] += j * inverseMass;
+				p.angularVelocityY[i] += inverseInertia * rz * j;
+				p.angularVelocityZ[i] -= inverseInertia * ry * j;
+
+				float velocityZ = p.velocityZ[i] + p.angularVelocityX[i] * ry - p.angularVelocityY[i] * rx;
+				j = ContactModel::frictionImpulse(c.tangentImpulseZ[k][i], velocityZ, c.tangentMassZ[k][i], limit);
+				p.velocityZ[i] += j * inverseMass;
+				p.angularVelocityX[i] += inverseInertia * ry * j;
+				p.angularVelocityY[i] -= inverseInertia * rx * j;
+
+				float velocityY = p.velocityY[i] + p.angularVelocityZ[i] * rx - p.angularVelocityX[i] * rz;
+				j = ContactModel::normalImpulse(c.normalImpulse[k][i], velocityY, c.velocityBias[k][i], c.normalMass[k][i]);
+				p.velocityY[i] += j * inverseMass;
+				p.angularVelocityX[i] -= inverseInertia * rz * j;
+				p.angularVelocityZ[i] += inverseInertia * rx * j;
+			}
+		}
+	}
+
+	// Sleep, then integrate; fast dice stop where their inscribed sphere reaches the felt.
+	float reachSquared = 3 * h * h;
+	float sleepSpeedSquared = m_physics.sleepSpeed * m_physics.sleepSpeed;
+	for (uint32_t i = 0; i < WIDTH; i++) {
+		float speedSquared = p.velocityX[i] * p.velocityX[i] + p.velocityY[i] * p.velocityY[i]
+			+ p.velocityZ[i] * p.velocityZ[i];
+		float spinSquared = p.angularVelocityX[i] * p.angularVelocityX[i]
+			+ p.angularVelocityY[i] * p.angularVelocityY[i] + p.angularVelocityZ[i] * p.angularVelocityZ[i];
+		p.restingTime[i] = (p.restingTime[i] + dt) * (speedSquared + spinSquared * reachSquared < sleepSpeedSquared);
+		float awake = p.awake[i] * (p.restingTime[i] < m_physics.timeToSleep);
+		p.awake[i] = awake;
+		p.velocityX[i] *= awake;
+		p.velocityY[i] *= awake;
+		p.velocityZ[i] *= awake;
+		p.angularVelocityX[i] *= awake;
+		p.angularVelocityY[i] *= awake;
+		p.angularVelocityZ[i] *= awake;
+
+		// Dice already at the felt are left to the contacts, as in PhysicsWorld::timeOfImpact.
+		float fall = -p.velocityY[i] * dt;
+		float gap = p.positionY[i] - h;
+		bool fast = speedSquared * dt * dt > h * h && fall > gap && gap >= ContactModel::CONTACT_MARGIN;
+		float t = fast ? gap / std::max(fall, gap) : 1.0f;
+		float step = dt * t;
+		p.positionX[i] += p.velocityX[i] * step;
+		p.positionY[i] += p.velocityY[i] * step;
+		p.positionZ[i] += p.velocityZ[i] * step;
+
+		// dq/dt = 1/2 w q, renormalized.
+		float w = p.orientationW[i], x = p.orientationX[i], y = p.orientationY[i], z = p.orientationZ[i];
+		float ax = p.angularVelocityX[i] * 0.5f * step;
+		float ay = p.angularVelocityY[i] * 0.5f * step;
+		float az = p.angularVelocityZ[i] * 0.5f * step;
+		float nw = w - (ax * x + ay * y + az * z);
+		float nx = x + (ax * w + ay * z - az * y);
+		float ny = y + (ay * w + az * x - ax * z);
+		float nz = z + (az * w + ax * y - ay * x);
+		float inverseLength = 1 / std::sqrt(nw * nw + nx * nx + ny * ny + nz * nz);
+		p.orientationW[i] = nw * inverseLength;
+		p.orientationX[i] = nx * inverseLength;
+		p.orientationY[i] = ny * inverseLength;
+		p.orientationZ[i] = nz * inverseLength;
+	}
+}
+
+bool DiceBatch::settled() const {
+	for (auto& packet : m_packets) {
+		float awake = 0;
+		for (uint32_t i = 0; i < WIDTH; i++) {
+			awake += packet.awake[i];
+		}
+		if (awake > 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int DiceBatch::face(uint32_t die) const {
+	const Packet& p = m_packets[die / WIDTH];
+	uint32_t i = die % WIDTH;
+	if (p.awake[i] > 0) {
+		return 0;
+	}
+	// How far up each of the die's axes points.
+	float w = p.orientationW[i], x = p.orientationX[i], y = p.orientationY[i], z = p.orientationZ[i];
+	float up[3] = { 2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x) };
+	int axis = 0;
+	for (int a = 1; a < 3; a++) {
+		if (std::abs(up[a]) > std::abs(up[axis])) {
+			axis = a;
+		}
+	}
+	return up[axis] > 0 ? POSITIVE_FACES[axis] : 7 - POSITIVE_FACES[axis];
+}
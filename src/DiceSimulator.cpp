@@ -0,0 +1,133 @@
+// A headless batch simulator for the table game's dice: throws millions of them onto a flat felt,
+// counts the faces they come to rest on, and reports whether the counts look fair. Builds as its
+// own target, without OpenGL, SFML or assimp.
+//
+// Usage: DiceSimulator [--rolls N] [--seed S] [--threads T] [--step seconds] [--report path]
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include "DiceBatch.h"
+#include "ThreadPool.h"
+
+namespace {
+	// Dice per task: enough packets to keep a worker busy, few enough to share out evenly.
+	const uint32_t BATCH_SIZE = 1024;
+	// Dice still moving after this long count as unsettled rather than stalling the run.
+	const float MAX_ROLL_SECONDS = 20;
+	const uint32_t SETTLED_CHECK_INTERVAL = 30;
+
+	/**
+	 * @brief The chance of a chi-squared statistic at least this large with 5 degrees of freedom,
+	 * i.e. from six equally likely faces.
+	 */
+	double chiSquaredPValue(double chiSquared) {
+		double half = chiSquared / 2;
+		return std::erfc(std::sqrt(half)) + std::sqrt(2 * chiSquared / M_PI) * std::exp(-half) * (1 + chiSquared / 3);
+	}
+}
+
+int main(int argc, char** argv) {
+	uint64_t rolls = 1000000;
+	uint64_t seed = 1;
+	uint32_t threads = std::thread::hardware_concurrency();
+	float step = 1.0f / 60.0f;
+	std::string reportPath = "dice_fairness.json";
+	for (int i = 1; i + 1 < argc; i += 2) {
+		std::string arg = argv[i];
+		if (arg == "--rolls") {
+			rolls = std::stoull(argv[i + 1]);
+		}
+		else if (arg == "--seed") {
+			seed = std::stoull(argv[i + 1]);
+		}
+		else if (arg == "--threads") {
+			threads = std::stoul(argv[i + 1]);
+		}
+		else if (arg == "--step") {
+			step = std::stof(argv[i + 1]);
+		}
+		else if (arg == "--report") {
+			reportPath = argv[i + 1];
+		}
+	}
+
+	DiceThrowSettings dice;
+	PhysicsSettings physics;
+	uint32_t maxSteps = static_cast<uint32_t>(MAX_ROLL_SECONDS / step);
+	// faces[0] counts the unsettled dice.
+	std::array<uint64_t, 7> faces{};
+	std::mutex facesMutex;
+	std::atomic<uint64_t> dieSteps = 0;
+
+	// Every roll draws from its own counter-based stream, so results depend only on the seed,
+	// not on how batches land on threads.
+	ThreadPool pool(threads);
+	uint32_t batches = static_cast<uint32_t>((rolls + BATCH_SIZE - 1) / BATCH_SIZE);
+	auto start = std::chrono::steady_clock::now();
+	pool.parallelFor(batches, 1, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t b = begin; b < end; b++) {
+			uint64_t first = uint64_t(b) * BATCH_SIZE;
+			uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(BATCH_SIZE, rolls - first));
+			DiceBatch batch(count, dice, physics);
+			batch.throwDice(seed, first);
+			uint32_t taken = 0;
+			while (taken < maxSteps && !(taken % SETTLED_CHECK_INTERVAL == 0 && batch.settled())) {
+				batch.step(step);
+				taken++;
+			}
+			std::array<uint64_t, 7> counts{};
+			for (uint32_t die = 0; die < count; die++) {
+				counts[batch.face(die)]++;
+			}
+			dieSteps += uint64_t(taken) * count;
+			std::lock_guard<std::mutex> lock(facesMutex);
+			for (int face = 0; face < 7; face++) {
+				faces[face] += counts[face];
+			}
+		}
+	});
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	uint64_t settled = rolls - faces[0];
+	double expected = settled / 6.0;
+	double chiSquared = 0;
+	for (int face = 1; face <= 6; face++) {
+		chiSquared += (faces[face] - expected) * (faces[face] - expected) / std::max(expected, 1.0);
+	}
+	double pValue = chiSquaredPValue(chiSquared);
+
+	std::cout << rolls << " rolls in " << seconds << " s (" << rolls / seconds << " rolls/s, "
+		<< dieSteps / seconds << " die steps/s) on " << pool.threadCount() << " threads" << std::endl;
+	for (int face = 1; face <= 6; face++) {
+		std::cout << "  " << face << ": " << faces[face] << " (" << 100.0 * faces[face] / std::max<uint64_t>(settled, 1)
+			<< "%)" << std::endl;
+	}
+	std::cout << "  unsettled: " << faces[0] << std::endl;
+	std::cout << "chi-squared " << chiSquared << ", p = " << pValue << std::endl;
+
+	std::ofstream report(reportPath);
+	report << "{\n";
+	report << "  \"rolls\": " << rolls << ",\n";
+	report << "  \"seed\": " << seed << ",\n";
+	report << "  \"step\": " << step << ",\n";
+	report << "  \"threads\": " << pool.threadCount() << ",\n";
+	report << "  \"faces\": [";
+	for (int face = 1; face <= 6; face++) {
+		report << faces[face] << (face < 6 ? ", " : "");
+	}
+	report << "],\n";
+	report << "  \"unsettled\": " << faces[0] << ",\n";
+	report << "  \"chiSquared\": " << chiSquared << ",\n";
+	report << "  \"pValue\": " << pValue << ",\n";
+	report << "  \"seconds\": " << seconds << ",\n";
+	report << "  \"rollsPerSecond\": " << rolls / seconds << "\n";
+	report << "}\n";
+	std::cout << "wrote " << reportPath << std::endl;
+	return 0;
+}
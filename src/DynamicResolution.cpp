@@ -0,0 +1,131 @@
+#include "DynamicResolution.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+	// Scale down after this many measurements over budget, up after this many well under it.
+	const uint32_t FRAMES_TO_DECREASE = 3;
+	const uint32_t FRAMES_TO_INCREASE = 30;
+	// Frame times between these fractions of the target leave the scale alone.
+	const float LOWER_BAND = 0.8f;
+	const float UPPER_BAND = 1.0f;
+	// Scales snap to multiples of this, so small changes don't cause visible shimmering.
+	const float SCALE_STEP = 0.05f;
+	// Sharpening at the minimum scale; it fades out towards full resolution.
+	const float MAX_SHARPNESS = 0.5f;
+}
+
+DynamicResolution::DynamicResolution(const ShaderProgram& upscaleShader, uint32_t windowWidth,
+	uint32_t windowHeight, float targetMilliseconds)
+	: m_upscaleShader(upscaleShader), m_width(windowWidth), m_height(windowHeight), m_framebuffer(0),
+	m_colorTexture(0), m_depthBuffer(0), m_targetMilliseconds(targetMilliseconds), m_scale(MAX_SCALE),
+	m_framesOverBudget(0), m_framesUnderBudget(0) {
+	glGenVertexArrays(1, &m_emptyVao);
+	allocate();
+}
+
+DynamicResolution::~DynamicResolution() {
+	release();
+	glDeleteVertexArrays(1, &m_emptyVao);
+}
+
+void DynamicResolution::allocate() {
+	glGenTextures(1, &m_colorTexture);
+	glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_width, m_height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		throw std::runtime_error("Dynamic resolution framebuffer is incomplete");
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DynamicResolution::release() {
+	glDeleteFramebuffers(1, &m_framebuffer);
+	glDeleteRenderbuffers(1, &m_depthBuffer);
+	glDeleteTextures(1, &m_colorTexture);
+}
+
+void DynamicResolution::resize(uint32_t windowWidth, uint32_t windowHeight) {
+	if (windowWidth == m_width && windowHeight == m_height) {
+		return;
+	}
+	release();
+	m_width = std::max(windowWidth, 1u);
+	m_height = std::max(windowHeight, 1u);
+	allocate();
+}
+
+void DynamicResolution::update(double gpuMilliseconds) {
+	if (gpuMilliseconds > m_targetMilliseconds * UPPER_BAND) {
+		m_framesUnderBudget = 0;
+		if (++m_framesOverBudget >= FRAMES_TO_DECREASE) {
+			// GPU time goes roughly with pixel count, i.e. with the square of the scale.
+			float wanted = m_scale * std::sqrt(m_targetMilliseconds * LOWER_BAND / static_cast<float>(gpuMilliseconds));
+			m_scale = std::max(MIN_SCALE, std::floor(wanted / SCALE_STEP) * SCALE_STEP);
+			m_framesOverBudget = 0;
+		}
+	}
+	else if (gpuMilliseconds < m_targetMilliseconds * LOWER_BAND) {
+		m_framesOverBudget = 0;
+		if (++m_framesUnderBudget >= FRAMES_TO_INCREASE) {
+			m_scale = std::min(MAX_SCALE, m_scale + SCALE_STEP);
+			m_framesUnderBudget = 0;
+		}
+	}
+	else {
+		m_framesOverBudget = 0;
+		m_framesUnderBudget = 0;
+	}
+}
+
+uint32_t DynamicResolution::renderWidth() const {
+	return std::max(1u, static_cast<uint32_t>(m_width * m_scale));
+}
+
+uint32_t DynamicResolution::renderHeight() const {
+	return std::max(1u, static_cast<uint32_t>(m_height * m_scale));
+}
+
+void DynamicResolution::beginFrame() {
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, renderWidth(), renderHeight());
+}
+
+void DynamicResolution::endFrame(uint32_t targetFramebuffer) {
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+	glViewport(0, 0, m_width, m_height);
+	glDisable(GL_DEPTH_TEST);
+
+	m_upscaleShader.activate();
+	m_upscaleShader.setUniform("sceneColor", 0);
+	m_upscaleShader.setUniform("uvScale", glm::vec2(static_cast<float>(renderWidth()) / m_width,
+		static_cast<float>(renderHeight()) / m_height));
+	m_upscaleShader.setUniform("texelSize", glm::vec2(1.0f / m_width, 1.0f / m_height));
+	m_upscaleShader.setUniform("sharpness",
+		MAX_SHARPNESS * (MAX_SCALE - m_scale) / (MAX_SCALE - MIN_SCALE));
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+	glBindVertexArray(m_emptyVao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glEnable(GL_DEPTH_TEST);
+}
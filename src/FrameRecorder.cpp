@@ -0,0 +1,205 @@
+#include "FrameRecorder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include "ImageWriter.h"
+
+namespace {
+	uint8_t clampByte(int32_t value) {
+		return static_cast<uint8_t>(std::clamp(value, 0, 255));
+	}
+
+	/**
+	 * @brief Converts a top-down RGBA image to planar YUV 4:2:0 with full-range BT.601 weights,
+	 * as JPEG uses, averaging each 2x2 block for chroma. That average sits centred between the
+	 * luma samples, which is the chroma siting the stream header declares.
+	 */
+	void rgbaToYuv420(const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* yuv) {
+		uint32_t chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+		uint8_t* yPlane = yuv;
+		uint8_t* uPlane = yPlane + static_cast<size_t>(width) * height;
+		uint8_t* vPlane = uPlane + static_cast<size_t>(chromaWidth) * chromaHeight;
+		for (uint32_t y = 0; y < height; y++) {
+			for (uint32_t x = 0; x < width; x++) {
+				const uint8_t* p = rgba + (static_cast<size_t>(y) * width + x) * 4;
+				yPlane[y * width + x] = static_cast<uint8_t>((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+			}
+		}
+		for (uint32_t cy = 0; cy < chromaHeight; cy++) {
+			for (uint32_t cx = 0; cx < chromaWidth; cx++) {
+				int32_t r = 0, g = 0, b = 0, count = 0;
+				for (uint32_t y = cy * 2; y < std::min(cy * 2 + 2, height); y++) {
+					for (uint32_t x = cx * 2; x < std::min(cx * 2 + 2, width); x++) {
+						const uint8_t* p = rgba + (static_cast<size_t>(y) * width + x) * 4;
+						r += p[0];
+						g += p[1];
+						b += p[2];
+						count++;
+					}
+				}
+				r /= count;
+				g /= count;
+				b /= count;
+				uPlane[cy * chromaWidth + cx] = clampByte(((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128);
+				vPlane[cy * chromaWidth + cx] = clampByte(((128 * r - 107 * g - 21 * b + 128) >> 8) + 128);
+			}
+		}
+	}
+}
+
+FrameRecorder::FrameRecorder(uint32_t width, uint32_t height, Format format, const std::filesystem::path& output,
+	uint32_t framesPerSecond, ThreadPool& pool)
+	: m_width(width), m_height(height), m_format(format), m_output(output), m_pool(pool), m_framesRendered(0) {
+	glGenFramebuffers(1, &m_framebuffer);
+	glGenRenderbuffers(1, &m_colorBuffer);
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		throw std::runtime_error("Frame recorder framebuffer is incomplete");
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	for (auto& readback : m_readbacks) {
+		glGenBuffers(1, &readback.buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<size_t>(width) * height * 4, nullptr, GL_STREAM_READ);
+		readback.fence = nullptr;
+		readback.frame = 0;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (format == Format::Png) {
+		std::filesystem::create_directories(output);
+	}
+	else {
+		m_y4m.open(output, std::ios::binary);
+		if (!m_y4m) {
+			throw std::runtime_error("Could not open " + output.string());
+		}
+		m_y4m << "YUV4MPEG2 W" << width << " H" << height << " F" << framesPerSecond
+			<< ":1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n";
+	}
+}
+
+FrameRecorder::~FrameRecorder() {
+	finish();
+	for (auto& readback : m_readbacks) {
+		glDeleteBuffers(1, &readback.buffer);
+	}
+	glDeleteRenderbuffers(1, &m_colorBuffer);
+	glDeleteRenderbuffers(1, &m_depthBuffer);
+	glDeleteFramebuffers(1, &m_framebuffer);
+}
+
+void FrameRecorder::beginFrame() {
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_width, m_height);
+}
+
+void FrameRecorder::endFrame(bool preview) {
+	// The slot is reused every READBACK_LATENCY frames; its previous frame is almost certainly
+	// finished by now, so mapping it doesn't wait on the GPU.
+	Readback& readback = m_readbacks[m_framesRendered % READBACK_LATENCY];
+	if (readback.fence) {
+		collect(readback);
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	// With a pack buffer bound, this only queues the copy and returns immediately.
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	readback.frame = m_framesRendered++;
+
+	if (preview) {
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// Keep a bounded number of frames in memory if encoding falls behind.
+	retireEncodes(2 * static_cast<size_t>(std::max(m_pool.threadCount(), 1u)));
+}
+
+void FrameRecorder::collect(Readback& readback) {
+	glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+	glDeleteSync(readback.fence);
+	readback.fence = nullptr;
+
+	// Copy out of the mapped buffer, flipping GL's bottom-up rows to top-down.
+	size_t rowBytes = static_cast<size_t>(m_width) * 4;
+	auto pixels = std::make_shared<std::vector<uint8_t>>(rowBytes * m_height);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	const uint8_t* mapped = static_cast<const uint8_t*>(
+		glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pixels->size(), GL_MAP_READ_BIT));
+	if (mapped) {
+		for (uint32_t y = 0; y < m_height; y++) {
+			std::memcpy(pixels->data() + y * rowBytes, mapped + (m_height - 1 - y) * rowBytes, rowBytes);
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	Encode encode;
+	uint32_t width = m_width, height = m_height;
+	if (m_format == Format::Png) {
+		char name[32];
+		std::snprintf(name, sizeof(name), "frame_%05u.png", readback.frame);
+		std::filesystem::path path = m_output / name;
+		encode.done = m_pool.submit([pixels, width, height, path]() {
+			writePng(path, pixels->data(), width, height);
+		});
+	}
+	else {
+		size_t chromaSize = static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+		auto yuv = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(width) * height + 2 * chromaSize);
+		encode.y4mFrame = yuv;
+		encode.done = m_pool.submit([pixels, yuv, width, height]() {
+			rgbaToYuv420(pixels->data(), width, height, yuv->data());
+		});
+	}
+	m_encodes.push_back(std::move(encode));
+}
+
+void FrameRecorder::retireEncodes(size_t maxPending) {
+	while (!m_encodes.empty()) {
+		Encode& oldest = m_encodes.front();
+		bool ready = oldest.done.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		if (!ready && m_encodes.size() <= maxPending) {
+			break;
+		}
+		oldest.done.get();
+		if (oldest.y4mFrame) {
+			m_y4m << "FRAME\n";
+			m_y4m.write(reinterpret_cast<const char*>(oldest.y4mFrame->data()), oldest.y4mFrame->size());
+		}
+		m_encodes.pop_front();
+	}
+}
+
+void FrameRecorder::finish() {
+	// Collect the outstanding readbacks oldest first, so Y4M frames stay in order.
+	for (uint32_t i = 0; i < READBACK_LATENCY; i++) {
+		Readback& readback = m_readbacks[(m_framesRendered + i) % READBACK_LATENCY];
+		if (readback.fence) {
+			collect(readback);
+		}
+	}
+	retireEncodes(0);
+	if (m_y4m.is_open()) {
+		m_y4m.flush();
+	}
+}
@@ -0,0 +1,102 @@
+#include "GpuProfiler.h"
+#include <glad/glad.h>
+#include <cstdio>
+
+GpuProfiler::GpuProfiler() : m_currentFrame(0), m_latestFrame(-1), m_droppedFrames(0) {
+}
+
+GpuProfiler::~GpuProfiler() {
+	for (auto& frame : m_frames) {
+		if (!frame.pool.empty()) {
+			glDeleteQueries(static_cast<int32_t>(frame.pool.size()), frame.pool.data());
+		}
+	}
+}
+
+uint32_t GpuProfiler::nextQuery(FrameQueries& frame) {
+	if (frame.used == frame.pool.size()) {
+		uint32_t query;
+		glGenQueries(1, &query);
+		frame.pool.push_back(query);
+	}
+	return frame.pool[frame.used++];
+}
+
+void GpuProfiler::collect(FrameQueries& frame) {
+	frame.pending = false;
+	if (frame.scopes.empty()) {
+		return;
+	}
+	// Timestamps complete in order, so the last one being ready means they all are.
+	int32_t available = 0;
+	glGetQueryObjectiv(frame.scopes.front().endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		m_droppedFrames++;
+		return;
+	}
+
+	m_latest.clear();
+	for (auto& scope : frame.scopes) {
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(scope.beginQuery, GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(scope.endQuery, GL_QUERY_RESULT, &end);
+		m_latest.push_back(ScopeTiming{ scope.path, scope.depth, (end - begin) / 1e6 });
+	}
+	m_latestFrame = frame.frameNumber;
+}
+
+void GpuProfiler::beginFrame() {
+	FrameQueries& frame = m_frames[m_currentFrame % FRAME_LATENCY];
+	if (frame.pending) {
+		collect(frame);
+	}
+	frame.scopes.clear();
+	frame.used = 0;
+	frame.frameNumber = m_currentFrame;
+	m_openScopes.clear();
+	beginScope("frame");
+}
+
+void GpuProfiler::endFrame() {
+	while (!m_openScopes.empty()) {
+		endScope();
+	}
+	m_frames[m_currentFrame % FRAME_LATENCY].pending = true;
+	++m_currentFrame;
+}
+
+void GpuProfiler::beginScope(const std::string& name) {
+	FrameQueries& frame = m_frames[m_currentFrame % FRAME_LATENCY];
+	std::string path = m_openScopes.empty() ? name : frame.scopes[m_openScopes.back()].path + "/" + name;
+	uint32_t query = nextQuery(frame);
+	glQueryCounter(query, GL_TIMESTAMP);
+	frame.scopes.push_back(Scope{ path, static_cast<uint32_t>(m_openScopes.size()), query, 0 });
+	m_openScopes.push_back(static_cast<uint32_t>(frame.scopes.size() - 1));
+}
+
+void GpuProfiler::endScope() {
+	if (m_openScopes.empty()) {
+		return;
+	}
+	FrameQueries& frame = m_frames[m_currentFrame % FRAME_LATENCY];
+	uint32_t query = nextQuery(frame);
+	glQueryCounter(query, GL_TIMESTAMP);
+	frame.scopes[m_openScopes.back()].endQuery = query;
+	m_openScopes.pop_back();
+}
+
+std::string GpuProfiler::summary() const {
+	std::string result;
+	char text[96];
+	for (auto& timing : m_latest) {
+		if (timing.depth > 1) {
+			continue;
+		}
+		// Drop the "frame/" prefix from the passes.
+		std::string name = timing.depth == 0 ? "GPU" : timing.path.substr(timing.path.find('/') + 1);
+		std::snprintf(text, sizeof(text), "%s%s %.2f ms", result.empty() ? "" : " | ", name.c_str(),
+			timing.milliseconds);
+		result += text;
+	}
+	return result;
+}
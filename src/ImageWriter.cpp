@@ -0,0 +1,189 @@
+#include "ImageWriter.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+namespace {
+	void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+		out.push_back(value >> 24);
+		out.push_back(value >> 16);
+		out.push_back(value >> 8);
+		out.push_back(value);
+	}
+
+	template <typename T>
+	void appendLittleEndian(std::vector<uint8_t>& out, T value) {
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+		// Every platform we build for is little-endian.
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+
+	void appendString(std::vector<uint8_t>& out, const std::string& text) {
+		out.insert(out.end(), text.begin(), text.end());
+		out.push_back(0);
+	}
+
+	uint32_t crc32(const uint8_t* data, size_t length) {
+		static uint32_t table[256] = {};
+		if (table[1] == 0) {
+			for (uint32_t n = 0; n < 256; n++) {
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++) {
+					c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+				}
+				table[n] = c;
+			}
+		}
+		uint32_t crc = 0xffffffffu;
+		for (size_t i = 0; i < length; i++) {
+			crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+		}
+		return crc ^ 0xffffffffu;
+	}
+
+	void appendPngChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+		appendBigEndian(out, static_cast<uint32_t>(data.size()));
+		size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		appendBigEndian(out, crc32(out.data() + start, out.size() - start));
+	}
+
+	// The Paeth predictor: whichever of left, up and up-left is nearest to left + up - up-left.
+	uint8_t paeth(uint8_t left, uint8_t up, uint8_t upLeft) {
+		int32_t estimate = left + up - upLeft;
+		int32_t toLeft = std::abs(estimate - left);
+		int32_t toUp = std::abs(estimate - up);
+		int32_t toUpLeft = std::abs(estimate - upLeft);
+		if (toLeft <= toUp && toLeft <= toUpLeft) {
+			return left;
+		}
+		return toUp <= toUpLeft ? up : upLeft;
+	}
+
+	void writeFile(const std::filesystem::path& path, const std::vector<uint8_t>& bytes) {
+		std::ofstream out(path, std::ios::binary);
+		if (!out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size())) {
+			throw std::runtime_error("Could not write image " + path.string());
+		}
+	}
+}
+
+void writePng(const std::filesystem::path& path, const uint8_t* rgba, uint32_t width, uint32_t height) {
+	// Scanlines with the Paeth filter, which turns smooth shading into runs of small
+	// differences that deflate compresses well.
+	size_t rowBytes = static_cast<size_t>(width) * 4;
+	std::vector<uint8_t> raw((rowBytes + 1) * height);
+	for (uint32_t y = 0; y < height; y++) {
+		const uint8_t* row = rgba + y * rowBytes;
+		const uint8_t* above = y > 0 ? row - rowBytes : nullptr;
+		uint8_t* filtered = raw.data() + y * (rowBytes + 1);
+		*filtered++ = 4;
+		for (size_t i = 0; i < rowBytes; i++) {
+			uint8_t left = i >= 4 ? row[i - 4] : 0;
+			uint8_t up = above ? above[i] : 0;
+			uint8_t upLeft = above && i >= 4 ? above[i - 4] : 0;
+			filtered[i] = static_cast<uint8_t>(row[i] - paeth(left, up, upLeft));
+		}
+	}
+
+	// The fastest deflate level: frames are written as fast as they render, and higher levels
+	// take several times longer for a few percent smaller files.
+	uLongf compressedSize = compressBound(static_cast<uLong>(raw.size()));
+	std::vector<uint8_t> zlib(compressedSize);
+	if (compress2(zlib.data(), &compressedSize, raw.data(), static_cast<uLong>(raw.size()), Z_BEST_SPEED) != Z_OK) {
+		throw std::runtime_error("Could not compress image " + path.string());
+	}
+	zlib.resize(compressedSize);
+
+	std::vector<uint8_t> header;
+	appendBigEndian(header, width);
+	appendBigEndian(header, height);
+	// 8 bits per channel, RGBA, deflate, adaptive filtering and no interlacing.
+	header.insert(header.end(), { 8, 6, 0, 0, 0 });
+
+	std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	appendPngChunk(png, "IHDR", header);
+	appendPngChunk(png, "IDAT", zlib);
+	appendPngChunk(png, "IEND", {});
+	writeFile(path, png);
+}
+
+void writeExr(const std::filesystem::path& path, const float* rgb, uint32_t width, uint32_t height) {
+	std::vector<uint8_t> exr;
+	appendLittleEndian<uint32_t>(exr, 20000630); // magic
+	appendLittleEndian<uint32_t>(exr, 2); // version 2, single-part scanline
+
+	// Channels must be listed alphabetically; each is a 32-bit float, unsampled.
+	const char* channels[] = { "B", "G", "R" };
+	appendString(exr, "channels");
+	appendString(exr, "chlist");
+	appendLittleEndian<uint32_t>(exr, 3 * 18 + 1);
+	for (const char* channel : channels) {
+		appendString(exr, channel);
+		appendLittleEndian<int32_t>(exr, 2); // FLOAT
+		appendLittleEndian<uint32_t>(exr, 0); // pLinear and reserved
+		appendLittleEndian<int32_t>(exr, 1);
+		appendLittleEndian<int32_t>(exr, 1);
+	}
+	exr.push_back(0);
+
+	appendString(exr, "compression");
+	appendString(exr, "compression");
+	appendLittleEndian<uint32_t>(exr, 1);
+	exr.push_back(0); // NO_COMPRESSION
+
+	for (const char* window : { "dataWindow", "displayWindow" }) {
+		appendString(exr, window);
+		appendString(exr, "box2i");
+		appendLittleEndian<uint32_t>(exr, 16);
+		appendLittleEndian<int32_t>(exr, 0);
+		appendLittleEndian<int32_t>(exr, 0);
+		appendLittleEndian<int32_t>(exr, width - 1);
+		appendLittleEndian<int32_t>(exr, height - 1);
+	}
+
+	appendString(exr, "lineOrder");
+	appendString(exr, "lineOrder");
+	appendLittleEndian<uint32_t>(exr, 1);
+	exr.push_back(0); // INCREASING_Y
+
+	appendString(exr, "pixelAspectRatio");
+	appendString(exr, "float");
+	appendLittleEndian<uint32_t>(exr, 4);
+	appendLittleEndian<float>(exr, 1.0f);
+
+	appendString(exr, "screenWindowCenter");
+	appendString(exr, "v2f");
+	appendLittleEndian<uint32_t>(exr, 8);
+	appendLittleEndian<float>(exr, 0.0f);
+	appendLittleEndian<float>(exr, 0.0f);
+
+	appendString(exr, "screenWindowWidth");
+	appendString(exr, "float");
+	appendLittleEndian<uint32_t>(exr, 4);
+	appendLittleEndian<float>(exr, 1.0f);
+	exr.push_back(0);
+
+	// One scanline per block: an offset table, then each line's y, byte count and planar channels.
+	uint32_t lineBytes = width * 3 * sizeof(float);
+	uint64_t firstLine = exr.size() + static_cast<uint64_t>(height) * sizeof(uint64_t);
+	for (uint32_t y = 0; y < height; y++) {
+		appendLittleEndian<uint64_t>(exr, firstLine + static_cast<uint64_t>(y) * (8 + lineBytes));
+	}
+	for (uint32_t y = 0; y < height; y++) {
+		appendLittleEndian<int32_t>(exr, y);
+		appendLittleEndian<uint32_t>(exr, lineBytes);
+		const float* row = rgb + static_cast<size_t>(y) * width * 3;
+		for (int channel = 2; channel >= 0; channel--) {
+			for (uint32_t x = 0; x < width; x++) {
+				appendLittleEndian<float>(exr, row[x * 3 + channel]);
+			}
+		}
+	}
+	writeFile(path, exr);
+}
@@ -0,0 +1,259 @@
+#include "Impostors.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+	// The smallest a frame may get in the atlas's mip chain; below this, filtering one frame blends
+	// in too much of its neighbours.
+	const uint32_t MIN_MIP_FRAME_SIZE = 8;
+
+	float signNotZero(float value) {
+		return value >= 0 ? 1.0f : -1.0f;
+	}
+
+	/**
+	 * @brief Maps a point of the [-1, 1] square to a unit direction, with the upper hemisphere in
+	 * the inner diamond. Must match octDecode in impostor.vert.
+	 */
+	glm::vec3 octahedralDecode(const glm::vec2& p) {
+		glm::vec3 v(p.x, 1 - std::abs(p.x) - std::abs(p.y), p.y);
+		if (v.y < 0) {
+			v.x = (1 - std::abs(p.y)) * signNotZero(p.x);
+			v.z = (1 - std::abs(p.x)) * signNotZero(p.y);
+		}
+		return glm::normalize(v);
+	}
+
+	uint32_t createAtlasTexture(uint32_t size, GLenum internalFormat, GLenum type) {
+		uint32_t texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, size, size, 0, GL_RGBA, type, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return texture;
+	}
+}
+
+ImpostorRenderer::ImpostorRenderer(const ShaderProgram& bakeShader, const ShaderProgram& impostorShader,
+	float distance, uint32_t framesPerSide, uint32_t frameSize)
+	: m_bakeShader(bakeShader), m_impostorShader(impostorShader), m_distance(distance),
+	m_framesPerSide(framesPerSide), m_frameSize(frameSize) {
+}
+
+ImpostorRenderer::~ImpostorRenderer() {
+	for (auto& prop : m_props) {
+		glDeleteVertexArrays(1, &prop.vao);
+		glDeleteBuffers(1, &prop.instanceBuffer);
+		glDeleteTextures(1, &prop.colorTexture);
+		glDeleteTextures(1, &prop.normalDepthTexture);
+	}
+}
+
+void ImpostorRenderer::bake(Object3D& prototype, Prop& prop) {
+	// Fit a bounding sphere to the prop in its own space, so any instance can reuse it.
+	glm::mat4 model = prototype.getModelMatrix();
+	glm::vec3 lower(std::numeric_limits<float>::max());
+	glm::vec3 upper(-std::numeric_limits<float>::max());
+	std::vector<glm::vec3> points;
+	prototype.visitMeshes([&](Mesh3D& mesh, const glm::mat4& local) {
+		for (auto& v : mesh.geometry().vertices) {
+			points.push_back(glm::vec3(local * glm::vec4(v.x, v.y, v.z, 1)));
+			lower = glm::min(lower, points.back());
+			upper = glm::max(upper, points.back());
+		}
+	}, glm::inverse(model));
+	if (points.empty()) {
+		throw std::runtime_error("Cannot make an impostor of \"" + prototype.getName() + "\", which has no meshes");
+	}
+	prop.localCenter = (lower + upper) * 0.5f;
+	prop.localRadius = 0;
+	for (auto& p : points) {
+		prop.localRadius = std::max(prop.localRadius, glm::length(p - prop.localCenter));
+	}
+	float r = prop.localRadius;
+
+	uint32_t atlasSize = m_framesPerSide * m_frameSize;
+	prop.colorTexture = createAtlasTexture(atlasSize, GL_RGBA8, GL_UNSIGNED_BYTE);
+	prop.normalDepthTexture = createAtlasTexture(atlasSize, GL_RGBA16F, GL_FLOAT);
+
+	int32_t previousFramebuffer;
+	int32_t previousViewport[4];
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+	uint32_t depthBuffer, framebuffer;
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, atlasSize, atlasSize);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, prop.colorTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, prop.normalDepthTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		throw std::runtime_error("Impostor atlas framebuffer is incomplete");
+	}
+	// Zero alpha marks the texels no view of the prop covers.
+	float transparent[] = { 0, 0, 0, 0 };
+	float farDepth = 1;
+	glClearBufferfv(GL_COLOR, 0, transparent);
+	glClearBufferfv(GL_COLOR, 1, transparent);
+	glClearBufferfv(GL_DEPTH, 0, &farDepth);
+
+	m_bakeShader.activate();
+	// The object renders with its own model matrix; undoing it in the view puts the camera in the
+	// prop's local space, and so does transposing the model matrix for normals.
+	m_bakeShader.setUniform("normalTransform", glm::mat3(glm::transpose(model)));
+	// Depth spans the bounding sphere front to back.
+	m_bakeShader.setUniform("projection", glm::ortho(-r, r, -r, r, r, 3 * r));
+	for (uint32_t y = 0; y < m_framesPerSide; y++) {
+		for (uint32_t x = 0; x < m_framesPerSide; x++) {
+			glm::vec2 cell((x + 0.5f) / m_framesPerSide, (y + 0.5f) / m_framesPerSide);
+			glm::vec3 axis = octahedralDecode(cell * 2.0f - 1.0f);
+			// impostor.vert rebuilds this basis to orient the quad, so keep them in step.
+			glm::vec3 up = std::abs(axis.y) > 0.99f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+			glm::mat4 view = glm::lookAt(prop.localCenter + axis * (2 * r), prop.localCenter, up);
+			m_bakeShader.setUniform("view", view * glm::inverse(model));
+			glViewport(x * m_frameSize, y * m_frameSize, m_frameSize, m_frameSize);
+			prototype.render(m_bakeShader);
+		}
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &depthBuffer);
+
+	// Each level halves the frames, which only stay apart while their size divides evenly, and
+	// stop well short of a texel so bilinear filtering near a frame's edge doesn't reach the next.
+	int32_t maxLevel = 0;
+	for (uint32_t size = m_frameSize; size % 2 == 0 && size / 2 >= MIN_MIP_FRAME_SIZE; size /= 2) {
+		maxLevel++;
+	}
+	for (uint32_t texture : { prop.colorTexture, prop.normalDepthTexture }) {
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, maxLevel);
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+uint32_t ImpostorRenderer::addProp(Object3D& prototype) {
+	Prop prop{};
+	bake(prototype, prop);
+	prop.instances.push_back(&prototype);
+
+	glGenVertexArrays(1, &prop.vao);
+	glGenBuffers(1, &prop.instanceBuffer);
+	glBindVertexArray(prop.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, prop.instanceBuffer);
+	// The quad's corners come from gl_VertexID; only the per-instance attributes are fetched.
+	glVertexAttribPointer(0, 4, GL_FLOAT, false, sizeof(InstanceData), (void*)offsetof(InstanceData, centerRadius));
+	glEnableVertexAttribArray(0);
+	glVertexAttribDivisor(0, 1);
+	for (uint32_t column = 0; column < 3; column++) {
+		glVertexAttribPointer(1 + column, 3, GL_FLOAT, false, sizeof(InstanceData),
+			(void*)(offsetof(InstanceData, rotation) + column * sizeof(glm::vec3)));
+		glEnableVertexAttribArray(1 + column);
+		glVertexAttribDivisor(1 + column, 1);
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_props.push_back(std::move(prop));
+	return static_cast<uint32_t>(m_props.size() - 1);
+}
+
+void ImpostorRenderer::addInstance(uint32_t prop, const Object3D& instance) {
+	m_props.at(prop).instances.push_back(&instance);
+}
+
+void ImpostorRenderer::update(const glm::vec3& cameraPosition) {
+	m_replaced.clear();
+	for (auto& prop : m_props) {
+		prop.distant.clear();
+		for (const Object3D* instance : prop.instances) {
+			glm::mat4 model = instance->getModelMatrix();
+			glm::vec3 center = glm::vec3(model * glm::vec4(prop.localCenter, 1));
+			if (glm::distance(center, cameraPosition) <= m_distance) {
+				continue;
+			}
+			// Split the model matrix into a rotation and a scale for the sphere's radius.
+			glm::mat3 rotation(model);
+			float scale = 0;
+			for (uint32_t column = 0; column < 3; column++) {
+				float length = glm::length(rotation[column]);
+				scale = std::max(scale, length);
+				rotation[column] /= length;
+			}
+			prop.distant.push_back(InstanceData{ glm::vec4(center, prop.localRadius * scale), rotation });
+			m_replaced.insert(instance);
+		}
+		if (prop.distant.empty()) {
+			continue;
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, prop.instanceBuffer);
+		uint32_t count = static_cast<uint32_t>(prop.distant.size());
+		if (count > prop.instanceCapacity) {
+			prop.instanceCapacity = std::max(count, prop.instanceCapacity * 2);
+			glBufferData(GL_ARRAY_BUFFER, prop.instanceCapacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+		}
+		glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), prop.distant.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
+
+bool ImpostorRenderer::isImpostor(const Object3D& object) const {
+	return m_replaced.count(&object) > 0;
+}
+
+void ImpostorRenderer::render(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition,
+	const glm::vec4& material, const glm::vec3& ambientColor, const glm::vec3& lightDirection,
+	const glm::vec3& lightColor) {
+	if (m_replaced.empty()) {
+		return;
+	}
+	m_impostorShader.activate();
+	m_impostorShader.setUniform("view", view);
+	m_impostorShader.setUniform("projection", projection);
+	m_impostorShader.setUniform("cameraPos", cameraPosition);
+	m_impostorShader.setUniform("framesPerSide", static_cast<int32_t>(m_framesPerSide));
+	m_impostorShader.setUniform("frameSize", static_cast<int32_t>(m_frameSize));
+	m_impostorShader.setUniform("material", material);
+	m_impostorShader.setUniform("ambientColor", ambientColor);
+	m_impostorShader.setUniform("directionalLight", lightDirection);
+	m_impostorShader.setUniform("directionalColor", lightColor);
+	m_impostorShader.setUniform("colorAtlas", 0);
+	m_impostorShader.setUniform("normalDepthAtlas", 1);
+
+	// The quads are built facing the camera, so there is nothing to cull.
+	glDisable(GL_CULL_FACE);
+	for (auto& prop : m_props) {
+		if (prop.distant.empty()) {
+			continue;
+		}
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, prop.colorTexture);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, prop.normalDepthTexture);
+		glBindVertexArray(prop.vao);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(prop.distant.size()));
+	}
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glEnable(GL_CULL_FACE);
+}
@@ -0,0 +1,127 @@
+#include "InputRecording.h"
+#include <stdexcept>
+
+namespace {
+	const uint32_t INPUT_MAGIC = 0x32504e49; // "INP2"
+
+	// An event as stored: its type, then a key code, or a width and height.
+	struct StoredEvent {
+		uint32_t type;
+		int32_t first;
+		int32_t second;
+	};
+
+	struct StoredFrame {
+		float timeStep;
+		uint32_t physicsSteps;
+		uint64_t stateChecksum;
+		uint32_t eventCount;
+	};
+
+	template <typename T>
+	void writeValue(std::ofstream& out, const T& value) {
+		out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	bool readValue(std::ifstream& in, T& value) {
+		return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+	}
+}
+
+InputRecorder::InputRecorder(const std::filesystem::path& path)
+	: m_out(path, std::ios::binary), m_frames(0) {
+	if (!m_out) {
+		throw std::runtime_error("Can't write an input recording to " + path.string());
+	}
+	writeValue(m_out, INPUT_MAGIC);
+}
+
+void InputRecorder::recordEvent(const sf::Event& event) {
+	if (event.type == sf::Event::KeyPressed || event.type == sf::Event::Resized || event.type == sf::Event::Closed) {
+		m_events.push_back(event);
+	}
+}
+
+void InputRecorder::endFrame(float timeStep, uint32_t physicsSteps, uint64_t stateChecksum) {
+	// Zeroed first, so the padding after the event count is written as zeroes.
+	StoredFrame frame{};
+	frame.timeStep = timeStep;
+	frame.physicsSteps = physicsSteps;
+	frame.stateChecksum = stateChecksum;
+	frame.eventCount = static_cast<uint32_t>(m_events.size());
+	writeValue(m_out, frame);
+	for (auto& event : m_events) {
+		StoredEvent stored{ static_cast<uint32_t>(event.type), 0, 0 };
+		if (event.type == sf::Event::KeyPressed) {
+			stored.first = event.key.code;
+		}
+		else if (event.type == sf::Event::Resized) {
+			stored.first = static_cast<int32_t>(event.size.width);
+			stored.second = static_cast<int32_t>(event.size.height);
+		}
+		writeValue(m_out, stored);
+	}
+	m_events.clear();
+	m_frames++;
+	// Flushed every frame, so a session that crashes still leaves a recording to replay.
+	m_out.flush();
+}
+
+InputReplay::InputReplay(const std::filesystem::path& path)
+	: m_frame(0), m_nextEvent(0), m_divergedAt(-1) {
+	std::ifstream in(path, std::ios::binary);
+	uint32_t magic;
+	if (!readValue(in, magic) || magic != INPUT_MAGIC) {
+		throw std::runtime_error(path.string() + " isn't an input recording");
+	}
+	StoredFrame stored;
+	while (readValue(in, stored)) {
+		Frame frame{ stored.timeStep, stored.physicsSteps, stored.stateChecksum, static_cast<uint32_t>(m_events.size()),
+			stored.eventCount };
+		for (uint32_t i = 0; i < stored.eventCount; i++) {
+			StoredEvent storedEvent;
+			if (!readValue(in, storedEvent)) {
+				throw std::runtime_error(path.string() + " ends partway through frame " + std::to_string(m_frames.size()));
+			}
+			sf::Event event{};
+			event.type = static_cast<sf::Event::EventType>(storedEvent.type);
+			if (event.type == sf::Event::KeyPressed) {
+				event.key.code = static_cast<sf::Keyboard::Key>(storedEvent.first);
+			}
+			else if (event.type == sf::Event::Resized) {
+				event.size.width = static_cast<unsigned>(storedEvent.first);
+				event.size.height = static_cast<unsigned>(storedEvent.second);
+			}
+			m_events.push_back(event);
+		}
+		m_frames.push_back(frame);
+	}
+	if (m_frames.empty()) {
+		throw std::runtime_error(path.string() + " has no frames to replay");
+	}
+}
+
+bool InputReplay::pollEvent(sf::Event& event) {
+	if (finished()) {
+		return false;
+	}
+	const Frame& frame = m_frames[m_frame];
+	if (m_nextEvent >= frame.eventCount) {
+		return false;
+	}
+	event = m_events[frame.firstEvent + m_nextEvent++];
+	return true;
+}
+
+void InputReplay::endFrame(uint32_t physicsSteps, uint64_t stateChecksum) {
+	if (finished()) {
+		return;
+	}
+	const Frame& frame = m_frames[m_frame];
+	if (m_divergedAt < 0 && (physicsSteps != frame.physicsSteps || stateChecksum != frame.stateChecksum)) {
+		m_divergedAt = static_cast<int64_t>(m_frame);
+	}
+	m_frame++;
+	m_nextEvent = 0;
+}
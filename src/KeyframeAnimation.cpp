@@ -0,0 +1,138 @@
+#include "KeyframeAnimation.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	Object3D* findObject(Object3D& object, const std::string& name) {
+		if (object.getName() == name) {
+			return &object;
+		}
+		for (size_t i = 0; i < object.numberOfChildren(); i++) {
+			Object3D* found = findObject(object.getChild(i), name);
+			if (found) {
+				return found;
+			}
+		}
+		return nullptr;
+	}
+
+	/**
+	 * @brief The last key at or before the given time (or the first key, before the clip's first
+	 * key). Playing forward steps the cursor on from where it was; anything else searches.
+	 */
+	uint32_t findKey(const std::vector<float>& times, float time, uint32_t cursor, bool forward) {
+		uint32_t last = static_cast<uint32_t>(times.size() - 1);
+		if (forward && times[cursor] <= time) {
+			while (cursor < last && times[cursor + 1] <= time) {
+				cursor++;
+			}
+			return cursor;
+		}
+		auto after = std::upper_bound(times.begin(), times.end(), time);
+		return after == times.begin() ? 0 : static_cast<uint32_t>(after - times.begin() - 1);
+	}
+
+	glm::vec3 interpolate(const glm::vec3& a, const glm::vec3& b, float s) {
+		return glm::mix(a, b, s);
+	}
+
+	glm::quat interpolate(const glm::quat& a, const glm::quat& b, float s) {
+		return glm::slerp(a, b, s);
+	}
+
+	glm::vec3 normalized(const glm::vec3& value) {
+		return value;
+	}
+
+	glm::quat normalized(const glm::quat& value) {
+		return glm::normalize(value);
+	}
+
+	template <typename T>
+	T sampleTrack(const KeyframeTrack<T>& track, uint32_t key, float time) {
+		if (key + 1 >= track.times.size() || time <= track.times[key]) {
+			return track.values[key];
+		}
+		float span = track.times[key + 1] - track.times[key];
+		float s = (time - track.times[key]) / span;
+		switch (track.interpolation) {
+		case KeyframeInterpolation::Step:
+			return track.values[key];
+		case KeyframeInterpolation::Linear:
+			return interpolate(track.values[key], track.values[key + 1], s);
+		case KeyframeInterpolation::CubicSpline:
+			break;
+		}
+		// Hermite basis, with the tangents scaled from per second to per span.
+		float s2 = s * s;
+		float s3 = s2 * s;
+		return normalized((2 * s3 - 3 * s2 + 1) * track.values[key]
+			+ (s3 - 2 * s2 + s) * span * track.outTangents[key]
+			+ (-2 * s3 + 3 * s2) * track.values[key + 1]
+			+ (s3 - s2) * span * track.inTangents[key + 1]);
+	}
+}
+
+KeyframeSampler::KeyframeSampler(KeyframeClip clip, Object3D& root, bool looping)
+	: m_clip(std::move(clip)), m_skeleton(nullptr), m_time(0), m_looping(looping) {
+	for (uint32_t i = 0; i < m_clip.nodes.size(); i++) {
+		Object3D* object = findObject(root, m_clip.nodes[i].node);
+		if (object) {
+			m_bindings.push_back(Binding{ i, object, 0, 0, 0, 0 });
+		}
+	}
+	sample(false);
+}
+
+KeyframeSampler::KeyframeSampler(KeyframeClip clip, Skeleton& skeleton, bool looping)
+	: m_clip(std::move(clip)), m_skeleton(&skeleton), m_time(0), m_looping(looping) {
+	for (uint32_t i = 0; i < m_clip.nodes.size(); i++) {
+		int32_t joint = skeleton.find(m_clip.nodes[i].node);
+		if (joint >= 0) {
+			m_bindings.push_back(Binding{ i, nullptr, skeleton.animate(joint), 0, 0, 0 });
+		}
+	}
+	sample(false);
+}
+
+void KeyframeSampler::sample(bool forward) {
+	for (auto& binding : m_bindings) {
+		const NodeKeyframes& keys = m_clip.nodes[binding.node];
+		binding.translationKey = findKey(keys.translation.times, m_time, binding.translationKey, forward);
+		binding.rotationKey = findKey(keys.rotation.times, m_time, binding.rotationKey, forward);
+		binding.scaleKey = findKey(keys.scale.times, m_time, binding.scaleKey, forward);
+
+		glm::vec3 translation = sampleTrack(keys.translation, binding.translationKey, m_time);
+		glm::quat rotation = sampleTrack(keys.rotation, binding.rotationKey, m_time);
+		glm::vec3 scale = sampleTrack(keys.scale, binding.scaleKey, m_time);
+		if (binding.object) {
+			binding.object->setBaseTransform(glm::translate(glm::mat4(1), translation) * glm::mat4_cast(rotation)
+				* glm::scale(glm::mat4(1), scale));
+		}
+		else {
+			m_skeleton->setPose(binding.joint, translation, rotation, scale);
+		}
+	}
+}
+
+void KeyframeSampler::seek(float time) {
+	if (m_looping && m_clip.duration > 0) {
+		time = std::fmod(time, m_clip.duration);
+		m_time = time < 0 ? time + m_clip.duration : time;
+	}
+	else {
+		m_time = std::clamp(time, 0.0f, m_clip.duration);
+	}
+	sample(false);
+}
+
+void KeyframeSampler::advance(float dt) {
+	float time = m_time + dt;
+	if (m_looping && m_clip.duration > 0 && time >= m_clip.duration) {
+		// Wrapping around moves the cursors back, so they're searched for again.
+		seek(time);
+		return;
+	}
+	m_time = std::min(time, m_clip.duration);
+	sample(true);
+}
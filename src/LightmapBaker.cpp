@@ -0,0 +1,389 @@
+#include "LightmapBaker.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include "Bvh.h"
+#include "ContentHash.h"
+#include "Sampling.h"
+
+namespace {
+	// Lightmaps store lighting divided by this, so texels can exceed 1 before the texture is applied.
+	const float LIGHTMAP_RANGE = 2.0f;
+	const uint32_t LIGHTMAP_MAGIC = 0x33504d4c; // "LMP3"
+	// Pushes ray origins off their surface to avoid self-intersection.
+	const float SURFACE_OFFSET = 2e-3f;
+	// Empty texels this close to a chart are filled from it, so bilinear filtering doesn't bleed black.
+	const uint32_t DILATION_PASSES = 2;
+
+	struct LightmapHeader {
+		uint32_t magic;
+		uint32_t width;
+		uint32_t height;
+		// Used to reject a lightmap baked for a different version of the mesh.
+		uint32_t vertexCount;
+		uint32_t faceCount;
+		// Used to reject a lightmap baked with the mesh somewhere else or under other lighting.
+		uint64_t inputHash;
+	};
+
+	struct BakeTarget {
+		Mesh3D* mesh;
+		glm::mat4 model;
+		std::filesystem::path path;
+	};
+
+	struct Texel {
+		glm::vec3 position;
+		glm::vec3 normal;
+		bool covered;
+	};
+
+	uint64_t hashInputs(const glm::mat4& model, const LightmapBakeSettings& settings) {
+		ContentHash hash;
+		hash.add(model);
+		hash.add(settings.lightDirection);
+		hash.add(settings.lightColor);
+		hash.add(settings.ambientColor);
+		hash.add(settings.material);
+		hash.add(settings.albedo);
+		hash.add(settings.samplesPerTexel);
+		hash.add(settings.bounces);
+		hash.add(settings.occlusionDistance);
+		return hash.value();
+	}
+
+	bool hasLightmapUVs(const MeshGeometry& geometry) {
+		for (auto& vertex : geometry.vertices) {
+			if (vertex.u2 != 0 || vertex.v2 != 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * @brief Collects the static meshes that can receive a lightmap, in a stable order so each
+	 * one always maps to the same file.
+	 */
+	std::vector<BakeTarget> findTargets(std::vector<Object3D>& objects, const std::filesystem::path& directory) {
+		std::vector<BakeTarget> targets;
+		for (size_t i = 0; i < objects.size(); i++) {
+			if (!objects[i].isStatic()) {
+				continue;
+			}
+			uint32_t meshIndex = 0;
+			objects[i].visitMeshes([&](Mesh3D& mesh, const glm::mat4& model) {
+				if (hasLightmapUVs(mesh.geometry())) {
+					std::string name = "object" + std::to_string(i) + "_mesh" + std::to_string(meshIndex) + ".lmap";
+					targets.push_back(BakeTarget{ &mesh, model, directory / name });
+				}
+				meshIndex++;
+			});
+		}
+		return targets;
+	}
+
+	class Baker {
+	private:
+		const LightmapBakeSettings& m_settings;
+		WideBvh m_bvh;
+		// Geometric normal of each scene triangle, by original index.
+		std::vector<glm::vec3> m_normals;
+		glm::vec3 m_toLight;
+
+	public:
+		Baker(std::vector<Object3D>& objects, const LightmapBakeSettings& settings)
+			: m_settings(settings), m_toLight(-glm::normalize(settings.lightDirection)) {
+			std::vector<glm::vec3> triangles;
+			for (auto& object : objects) {
+				if (!object.isStatic()) {
+					continue;
+				}
+				object.visitMeshes([&](Mesh3D& mesh, const glm::mat4& model) {
+					const MeshGeometry& geometry = mesh.geometry();
+					for (uint32_t index : geometry.faces) {
+						const Vertex3D& v = geometry.vertices[index];
+						triangles.push_back(glm::vec3(model * glm::vec4(v.x, v.y, v.z, 1)));
+					}
+				});
+			}
+			for (size_t t = 0; t + 2 < triangles.size(); t += 3) {
+				glm::vec3 normal = glm::cross(triangles[t + 1] - triangles[t], triangles[t + 2] - triangles[t]);
+				float length = glm::length(normal);
+				m_normals.push_back(length > 0 ? normal / length : glm::vec3(0, 1, 0));
+			}
+			m_bvh = WideBvh(TriangleBvh(triangles));
+			std::cout << "lightmap bake: " << m_bvh.triangleCount() << " static triangles" << std::endl;
+		}
+
+		/**
+		 * @brief Light arriving at a surface point straight from the directional light, with a
+		 * shadow ray. The surface's own reflectance is left to the caller.
+		 */
+		glm::vec3 directIrradiance(const glm::vec3& position, const glm::vec3& normal) const {
+			float lambert = glm::dot(normal, m_toLight);
+			if (lambert <= 0) {
+				return glm::vec3(0);
+			}
+			Ray shadowRay{ position + normal * SURFACE_OFFSET, m_toLight, std::numeric_limits<float>::max() };
+			if (m_bvh.occluded(shadowRay)) {
+				return glm::vec3(0);
+			}
+			return m_settings.lightColor * lambert;
+		}
+
+		/**
+		 * @brief Light leaving a surface point towards a receiver after one or more bounces. Each
+		 * reflecting surface scales it by the albedo; the receiver's k_d is applied by the caller.
+		 */
+		glm::vec3 bouncedLight(glm::vec3 position, glm::vec3 normal, Rng& rng) const {
+			glm::vec3 result(0);
+			float throughput = m_settings.albedo;
+			for (uint32_t bounce = 0; bounce < m_settings.bounces; bounce++) {
+				result += throughput * directIrradiance(position, normal);
+				if (bounce + 1 == m_settings.bounces) {
+					break;
+				}
+				Ray ray{ position + normal * SURFACE_OFFSET, cosineSample(normal, rng), std::numeric_limits<float>::max() };
+				RayHit hit;
+				if (!m_bvh.intersect(ray, hit)) {
+					break;
+				}
+				position = ray.origin + ray.direction * hit.t;
+				normal = m_normals[hit.triangle];
+				if (glm::dot(normal, ray.direction) > 0) {
+					normal = -normal;
+				}
+				throughput *= m_settings.albedo;
+			}
+			return result;
+		}
+
+		/**
+		 * @brief The baked lighting for one texel: occluded ambient and indirect. Direct light is
+		 * left to lighting.frag, which shadows it with the shadow atlas and adds specular.
+		 */
+		glm::vec3 texelLight(const Texel& texel, Rng& rng) const {
+			glm::vec3 origin = texel.position + texel.normal * SURFACE_OFFSET;
+			float tMax = m_settings.bounces > 0 ? std::numeric_limits<float>::max() : m_settings.occlusionDistance;
+			uint32_t samples = std::max(m_settings.samplesPerTexel, 1u);
+			uint32_t unoccluded = 0;
+			glm::vec3 indirect(0);
+			for (uint32_t s = 0; s < samples; s++) {
+				Ray ray{ origin, cosineSample(texel.normal, rng), tMax };
+				RayHit hit;
+				if (!m_bvh.intersect(ray, hit)) {
+					unoccluded++;
+					continue;
+				}
+				if (hit.t > m_settings.occlusionDistance) {
+					unoccluded++;
+				}
+				if (m_settings.bounces > 0) {
+					glm::vec3 normal = m_normals[hit.triangle];
+					if (glm::dot(normal, ray.direction) > 0) {
+						normal = -normal;
+					}
+					indirect += bouncedLight(origin + ray.direction * hit.t, normal, rng);
+				}
+			}
+			float occlusion = static_cast<float>(unoccluded) / samples;
+			glm::vec3 ambient = m_settings.material.x * m_settings.ambientColor * occlusion;
+			// Cosine-weighted sampling makes the plain average an estimate of diffuse irradiance.
+			indirect *= m_settings.material.y / samples;
+			return ambient + indirect;
+		}
+
+		/**
+		 * @brief Rasterizes a mesh into lightmap space and lights each covered texel.
+		 */
+		std::vector<uint8_t> bake(const BakeTarget& target, ThreadPool& pool, uint32_t& resolution) const {
+			const MeshGeometry& geometry = target.mesh->geometry();
+			glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(target.model)));
+
+			std::vector<glm::vec3> positions;
+			std::vector<glm::vec3> normals;
+			for (auto& v : geometry.vertices) {
+				positions.push_back(glm::vec3(target.model * glm::vec4(v.x, v.y, v.z, 1)));
+				normals.push_back(glm::normalize(normalMatrix * glm::vec3(v.nx, v.ny, v.nz)));
+			}
+
+			// Pick the resolution from how much world area each unit of lightmap area covers.
+			double worldArea = 0, uvArea = 0;
+			for (size_t f = 0; f + 2 < geometry.faces.size(); f += 3) {
+				const Vertex3D& a = geometry.vertices[geometry.faces[f]];
+				const Vertex3D& b = geometry.vertices[geometry.faces[f + 1]];
+				const Vertex3D& c = geometry.vertices[geometry.faces[f + 2]];
+				worldArea += 0.5 * glm::length(glm::cross(positions[geometry.faces[f + 1]] - positions[geometry.faces[f]],
+					positions[geometry.faces[f + 2]] - positions[geometry.faces[f]]));
+				uvArea += 0.5 * std::abs((b.u2 - a.u2) * (c.v2 - a.v2) - (c.u2 - a.u2) * (b.v2 - a.v2));
+			}
+			float side = uvArea > 0 ? static_cast<float>(std::sqrt(worldArea / uvArea)) : 0;
+			resolution = std::clamp(static_cast<uint32_t>(side * m_settings.texelsPerUnit),
+				m_settings.minResolution, m_settings.maxResolution);
+			uint32_t res = resolution;
+
+			std::vector<Texel> texels(res * res, Texel{ glm::vec3(0), glm::vec3(0), false });
+			for (size_t f = 0; f + 2 < geometry.faces.size(); f += 3) {
+				uint32_t i[3] = { geometry.faces[f], geometry.faces[f + 1], geometry.faces[f + 2] };
+				glm::vec2 uv[3];
+				for (uint32_t k = 0; k < 3; k++) {
+					uv[k] = glm::vec2(geometry.vertices[i[k]].u2, geometry.vertices[i[k]].v2) * static_cast<float>(res);
+				}
+				float area = (uv[1].x - uv[0].x) * (uv[2].y - uv[0].y) - (uv[2].x - uv[0].x) * (uv[1].y - uv[0].y);
+				if (std::abs(area) < 1e-12f) {
+					continue;
+				}
+				auto writeTexel = [&](int32_t x, int32_t y, float w0, float w1, float w2) {
+					Texel& texel = texels[y * res + x];
+					texel.position = positions[i[0]] * w0 + positions[i[1]] * w1 + positions[i[2]] * w2;
+					glm::vec3 normal = normals[i[0]] * w0 + normals[i[1]] * w1 + normals[i[2]] * w2;
+					texel.normal = glm::dot(normal, normal) > 0 ? glm::normalize(normal) : normals[i[0]];
+					texel.covered = true;
+				};
+
+				glm::vec2 lo = glm::min(uv[0], glm::min(uv[1], uv[2]));
+				glm::vec2 hi = glm::max(uv[0], glm::max(uv[1], uv[2]));
+				int32_t x0 = std::max(0, static_cast<int32_t>(std::floor(lo.x)));
+				int32_t y0 = std::max(0, static_cast<int32_t>(std::floor(lo.y)));
+				int32_t x1 = std::min(static_cast<int32_t>(res) - 1, static_cast<int32_t>(std::ceil(hi.x)));
+				int32_t y1 = std::min(static_cast<int32_t>(res) - 1, static_cast<int32_t>(std::ceil(hi.y)));
+				bool wroteAny = false;
+				for (int32_t y = y0; y <= y1; y++) {
+					for (int32_t x = x0; x <= x1; x++) {
+						glm::vec2 p(x + 0.5f, y + 0.5f);
+						float w1 = ((p.x - uv[0].x) * (uv[2].y - uv[0].y) - (uv[2].x - uv[0].x) * (p.y - uv[0].y)) / area;
+						float w2 = ((uv[1].x - uv[0].x) * (p.y - uv[0].y) - (p.x - uv[0].x) * (uv[1].y - uv[0].y)) / area;
+						float w0 = 1 - w1 - w2;
+						if (w0 >= -1e-4f && w1 >= -1e-4f && w2 >= -1e-4f) {
+							writeTexel(x, y, w0, w1, w2);
+							wroteAny = true;
+						}
+					}
+				}
+				// Triangles smaller than a texel still claim the texel their centroid falls in.
+				if (!wroteAny) {
+					glm::vec2 centroid = (uv[0] + uv[1] + uv[2]) / 3.0f;
+					int32_t x = std::clamp(static_cast<int32_t>(centroid.x), 0, static_cast<int32_t>(res) - 1);
+					int32_t y = std::clamp(static_cast<int32_t>(centroid.y), 0, static_cast<int32_t>(res) - 1);
+					if (!texels[y * res + x].covered) {
+						writeTexel(x, y, 1.0f / 3, 1.0f / 3, 1.0f / 3);
+					}
+				}
+			}
+
+			std::vector<glm::vec3> light(res * res, glm::vec3(0));
+			pool.parallelFor(res, 1, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t y = begin; y < end; y++) {
+					for (uint32_t x = 0; x < res; x++) {
+						uint32_t index = y * res + x;
+						if (texels[index].covered) {
+							Rng rng(index * 9781u + 1);
+							light[index] = texelLight(texels[index], rng);
+						}
+					}
+				}
+			});
+
+			// Grow the charts outwards so filtering near their edges only sees baked texels.
+			std::vector<bool> covered(res * res);
+			for (uint32_t i = 0; i < res * res; i++) {
+				covered[i] = texels[i].covered;
+			}
+			for (uint32_t pass = 0; pass < DILATION_PASSES; pass++) {
+				std::vector<bool> next = covered;
+				for (int32_t y = 0; y < static_cast<int32_t>(res); y++) {
+					for (int32_t x = 0; x < static_cast<int32_t>(res); x++) {
+						if (covered[y * res + x]) {
+							continue;
+						}
+						glm::vec3 sum(0);
+						uint32_t count = 0;
+						for (int32_t dy = -1; dy <= 1; dy++) {
+							for (int32_t dx = -1; dx <= 1; dx++) {
+								int32_t nx = x + dx, ny = y + dy;
+								if (nx >= 0 && ny >= 0 && nx < static_cast<int32_t>(res) && ny < static_cast<int32_t>(res)
+									&& covered[ny * res + nx]) {
+									sum += light[ny * res + nx];
+									count++;
+								}
+							}
+						}
+						if (count > 0) {
+							light[y * res + x] = sum / static_cast<float>(count);
+							next[y * res + x] = true;
+						}
+					}
+				}
+				covered = std::move(next);
+			}
+
+			std::vector<uint8_t> pixels(res * res * 4);
+			for (uint32_t i = 0; i < res * res; i++) {
+				glm::vec3 encoded = glm::clamp(light[i] / LIGHTMAP_RANGE, 0.0f, 1.0f) * 255.0f + 0.5f;
+				pixels[4 * i] = static_cast<uint8_t>(encoded.x);
+				pixels[4 * i + 1] = static_cast<uint8_t>(encoded.y);
+				pixels[4 * i + 2] = static_cast<uint8_t>(encoded.z);
+				pixels[4 * i + 3] = 255;
+			}
+			return pixels;
+		}
+	};
+}
+
+void bakeLightmaps(std::vector<Object3D>& objects, const LightmapBakeSettings& settings, ThreadPool& pool,
+	const std::filesystem::path& directory) {
+	std::filesystem::create_directories(directory);
+	Baker baker(objects, settings);
+	auto targets = findTargets(objects, directory);
+	for (size_t t = 0; t < targets.size(); t++) {
+		uint32_t resolution;
+		std::vector<uint8_t> pixels = baker.bake(targets[t], pool, resolution);
+		std::cout << "baked " << targets[t].path << " (" << resolution << "x" << resolution << ", "
+			<< t + 1 << "/" << targets.size() << ")" << std::endl;
+
+		const MeshGeometry& geometry = targets[t].mesh->geometry();
+		// Zeroed first, so the padding written with it is too.
+		LightmapHeader header{};
+		header.magic = LIGHTMAP_MAGIC;
+		header.width = resolution;
+		header.height = resolution;
+		header.vertexCount = static_cast<uint32_t>(geometry.vertices.size());
+		header.faceCount = static_cast<uint32_t>(geometry.faces.size());
+		header.inputHash = hashInputs(targets[t].model, settings);
+		std::ofstream out(targets[t].path, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+
+		targets[t].mesh->setLightMap(Texture::loadPixels(pixels.data(), resolution, resolution, "lightMap",
+			GL_CLAMP_TO_EDGE));
+	}
+}
+
+uint32_t loadLightmaps(std::vector<Object3D>& objects, const LightmapBakeSettings& settings,
+	const std::filesystem::path& directory) {
+	uint32_t loaded = 0;
+	for (auto& target : findTargets(objects, directory)) {
+		std::ifstream in(target.path, std::ios::binary);
+		LightmapHeader header;
+		if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+			continue;
+		}
+		const MeshGeometry& geometry = target.mesh->geometry();
+		if (header.magic != LIGHTMAP_MAGIC || header.vertexCount != geometry.vertices.size()
+			|| header.faceCount != geometry.faces.size() || header.inputHash != hashInputs(target.model, settings)) {
+			std::cerr << "skipping stale lightmap " << target.path << std::endl;
+			continue;
+		}
+		std::vector<uint8_t> pixels(static_cast<size_t>(header.width) * header.height * 4);
+		if (!in.read(reinterpret_cast<char*>(pixels.data()), pixels.size())) {
+			continue;
+		}
+		target.mesh->setLightMap(Texture::loadPixels(pixels.data(), header.width, header.height, "lightMap",
+			GL_CLAMP_TO_EDGE));
+		loaded++;
+	}
+	return loaded;
+}
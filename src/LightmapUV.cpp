@@ -0,0 +1,165 @@
+#include "LightmapUV.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+	// Charts are padded so that they sit this many texels apart in a lightmap of the nominal size;
+	// smaller lightmaps get proportionally less, which the baker's dilation covers.
+	const float PADDING_TEXELS = 2;
+	const float NOMINAL_RESOLUTION = 128;
+
+	uint32_t findRoot(std::vector<uint32_t>& parents, uint32_t i) {
+		while (parents[i] != i) {
+			parents[i] = parents[parents[i]];
+			i = parents[i];
+		}
+		return i;
+	}
+
+	glm::vec3 positionOf(const Vertex3D& v) {
+		return glm::vec3(v.x, v.y, v.z);
+	}
+
+	struct Chart {
+		uint32_t axis;
+		glm::vec2 min{ std::numeric_limits<float>::max() };
+		glm::vec2 max{ -std::numeric_limits<float>::max() };
+		glm::vec2 offset;
+	};
+
+	/**
+	 * @brief Shelf-packs the charts, tallest first, into rows of roughly the given width.
+	 * @return the side of the square that contains every chart.
+	 */
+	float packCharts(std::vector<Chart>& charts, const std::vector<uint32_t>& order, float padding) {
+		float area = 0;
+		for (auto& chart : charts) {
+			glm::vec2 size = chart.max - chart.min;
+			area += (size.x + padding) * (size.y + padding);
+		}
+		float rowLimit = std::sqrt(area);
+
+		float x = 0, y = 0, rowHeight = 0, width = 0;
+		for (uint32_t c : order) {
+			glm::vec2 size = charts[c].max - charts[c].min;
+			if (x > 0 && x + size.x + padding > rowLimit) {
+				y += rowHeight;
+				x = 0;
+				rowHeight = 0;
+			}
+			charts[c].offset = glm::vec2(x + padding * 0.5f, y + padding * 0.5f);
+			x += size.x + padding;
+			rowHeight = std::max(rowHeight, size.y + padding);
+			width = std::max(width, x);
+		}
+		return std::max(width, y + rowHeight);
+	}
+}
+
+std::vector<uint32_t> generateLightmapUVs(std::vector<Vertex3D>& vertices, std::vector<uint32_t>& faces) {
+	uint32_t triangleCount = static_cast<uint32_t>(faces.size() / 3);
+	if (triangleCount == 0) {
+		std::vector<uint32_t> unchanged(vertices.size());
+		std::iota(unchanged.begin(), unchanged.end(), 0);
+		return unchanged;
+	}
+
+	// Classify each triangle by the signed axis its normal points along most.
+	std::vector<uint8_t> classes(triangleCount);
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		const Vertex3D& a = vertices[faces[3 * t]];
+		const Vertex3D& b = vertices[faces[3 * t + 1]];
+		const Vertex3D& c = vertices[faces[3 * t + 2]];
+		glm::vec3 normal = glm::cross(positionOf(b) - positionOf(a), positionOf(c) - positionOf(a));
+		if (glm::dot(normal, normal) < 1e-20f) {
+			normal = glm::vec3(a.nx + b.nx + c.nx, a.ny + b.ny + c.ny, a.nz + b.nz + c.nz);
+		}
+		glm::vec3 magnitude = glm::abs(normal);
+		uint32_t axis = magnitude.x > magnitude.y ? (magnitude.x > magnitude.z ? 0 : 2) : (magnitude.y > magnitude.z ? 1 : 2);
+		classes[t] = static_cast<uint8_t>(axis * 2 + (normal[axis] < 0 ? 1 : 0));
+	}
+
+	// Join triangles of the same class that share an edge into charts.
+	std::vector<std::pair<uint64_t, uint32_t>> edges;
+	edges.reserve(faces.size());
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		for (uint32_t k = 0; k < 3; k++) {
+			uint64_t i0 = faces[3 * t + k];
+			uint64_t i1 = faces[3 * t + (k + 1) % 3];
+			edges.emplace_back(std::min(i0, i1) << 32 | std::max(i0, i1), t);
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	std::vector<uint32_t> parents(triangleCount);
+	std::iota(parents.begin(), parents.end(), 0);
+	for (size_t i = 1; i < edges.size(); i++) {
+		if (edges[i].first == edges[i - 1].first && classes[edges[i].second] == classes[edges[i - 1].second]) {
+			parents[findRoot(parents, edges[i].second)] = findRoot(parents, edges[i - 1].second);
+		}
+	}
+
+	std::vector<uint32_t> chartOf(triangleCount);
+	std::unordered_map<uint32_t, uint32_t> chartIds;
+	std::vector<Chart> charts;
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		uint32_t root = findRoot(parents, t);
+		auto found = chartIds.find(root);
+		if (found == chartIds.end()) {
+			found = chartIds.emplace(root, static_cast<uint32_t>(charts.size())).first;
+			charts.push_back(Chart{ classes[t] / 2u });
+		}
+		chartOf[t] = found->second;
+	}
+
+	// Give every (chart, vertex) pair its own vertex, projected onto the chart's plane.
+	std::vector<Vertex3D> newVertices;
+	std::vector<glm::vec2> projected;
+	std::vector<uint32_t> sources;
+	std::unordered_map<uint64_t, uint32_t> remap;
+	newVertices.reserve(vertices.size());
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		Chart& chart = charts[chartOf[t]];
+		for (uint32_t k = 0; k < 3; k++) {
+			uint32_t old = faces[3 * t + k];
+			uint64_t key = static_cast<uint64_t>(chartOf[t]) << 32 | old;
+			auto found = remap.find(key);
+			if (found == remap.end()) {
+				glm::vec3 p = positionOf(vertices[old]);
+				glm::vec2 uv(p[(chart.axis + 1) % 3], p[(chart.axis + 2) % 3]);
+				chart.min = glm::min(chart.min, uv);
+				chart.max = glm::max(chart.max, uv);
+				found = remap.emplace(key, static_cast<uint32_t>(newVertices.size())).first;
+				newVertices.push_back(vertices[old]);
+				projected.push_back(uv);
+				sources.push_back(old);
+			}
+			faces[3 * t + k] = found->second;
+		}
+	}
+
+	// Pack tallest charts first. The padding depends on the packed size, so pack twice.
+	std::vector<uint32_t> order(charts.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return charts[a].max.y - charts[a].min.y > charts[b].max.y - charts[b].min.y;
+	});
+	float side = packCharts(charts, order, 0);
+	side = packCharts(charts, order, side * PADDING_TEXELS / NOMINAL_RESOLUTION);
+	side = packCharts(charts, order, side * PADDING_TEXELS / NOMINAL_RESOLUTION);
+	float scale = side > 0 ? 1.0f / side : 0;
+
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		const Chart& chart = charts[chartOf[t]];
+		for (uint32_t k = 0; k < 3; k++) {
+			uint32_t i = faces[3 * t + k];
+			glm::vec2 uv = (chart.offset + projected[i] - chart.min) * scale;
+			newVertices[i].u2 = uv.x;
+			newVertices[i].v2 = uv.y;
+		}
+	}
+	vertices = std::move(newVertices);
+	return sources;
+}
@@ -1,6 +1,7 @@
 #include <iostream>
 #include "Mesh3D.h"
 #include <glad/glad.h>
+#include <stdexcept>
 
 
 Mesh3D::Mesh3D(std::vector<Vertex3D>&& vertices, std::vector<uint32_t>&& faces,
@@ -9,34 +10,56 @@ Mesh3D::Mesh3D(std::vector<Vertex3D>&& vertices, std::vector<uint32_t>&& faces,
 }
 
 Mesh3D::Mesh3D(std::vector<Vertex3D>&& vertices, std::vector<uint32_t>&& faces, std::vector<Texture>&& textures)
-	: m_vertexCount(vertices.size()), m_faceCount(faces.size()), m_textures(textures) {
+	: m_vertexCount(vertices.size()), m_faceCount(faces.size()), m_textures(textures), m_hasLightMap(false),
+	m_hasVertexOcclusion(false), m_occlusionVbo(0) {
+
+	// Split the interleaved vertices into a position stream and an attribute stream, so that
+	// the depth pre-pass only has to fetch 12 bytes per vertex.
+	std::vector<glm::vec3> positions;
+	std::vector<VertexAttributes3D> attributes;
+	positions.reserve(vertices.size());
+	attributes.reserve(vertices.size());
+	for (auto& vertex : vertices) {
+		positions.emplace_back(vertex.x, vertex.y, vertex.z);
+		attributes.push_back(VertexAttributes3D{ vertex.nx, vertex.ny, vertex.nz, vertex.u, vertex.v,
+			vertex.u2, vertex.v2 });
+	}
 
 	// Generate a vertex array object on the GPU.
 	glGenVertexArrays(1, &m_vao);
 	// "Bind" the newly-generated vao, which makes future functions operate on that specific object.
 	glBindVertexArray(m_vao);
 
-	// Generate a vertex buffer object on the GPU.
-	uint32_t vbo;
-	glGenBuffers(1, &vbo);
-
-	// "Bind" the newly-generated vbo, which makes future functions operate on that specific object.
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	// This vbo is now associated with m_vao.
-	// Copy the contents of the vertices list to the buffer that lives on the GPU.
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex3D), &vertices[0], GL_STATIC_DRAW);
-	// Inform OpenGL how to interpret the buffer: each vertex is 3 floats for position...
-	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(Vertex3D), 0);
+	// Generate the vertex buffer objects on the GPU: one for positions, one for everything else.
+	uint32_t positionVbo;
+	glGenBuffers(1, &positionVbo);
+	uint32_t attributeVbo;
+	glGenBuffers(1, &attributeVbo);
+
+	// "Bind" the position vbo, which makes future functions operate on that specific object.
+	glBindBuffer(GL_ARRAY_BUFFER, positionVbo);
+	// Copy the positions to the buffer that lives on the GPU.
+	glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), &positions[0], GL_STATIC_DRAW);
+	// Inform OpenGL how to interpret the buffer: each vertex is 3 floats for position.
+	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(glm::vec3), 0);
 	glEnableVertexAttribArray(0);
 
-	// Inform OpenGL how to interpret the buffer: ... then 3 floats for normal vector...
-	glVertexAttribPointer(1, 3, GL_FLOAT, false, sizeof(Vertex3D), (void*)12);
+	// The remaining attributes come from the second buffer.
+	glBindBuffer(GL_ARRAY_BUFFER, attributeVbo);
+	glBufferData(GL_ARRAY_BUFFER, attributes.size() * sizeof(VertexAttributes3D), &attributes[0], GL_STATIC_DRAW);
+
+	// Inform OpenGL how to interpret the buffer: 3 floats for normal vector...
+	glVertexAttribPointer(1, 3, GL_FLOAT, false, sizeof(VertexAttributes3D), 0);
 	glEnableVertexAttribArray(1);
 
-	// Inform OpenGL how to interpret the buffer: ... the 2 floats for texture coordinate.
-	glVertexAttribPointer(2, 2, GL_FLOAT, false, sizeof(Vertex3D), (void*)24);
+	// Inform OpenGL how to interpret the buffer: ... then 2 floats for texture coordinate...
+	glVertexAttribPointer(2, 2, GL_FLOAT, false, sizeof(VertexAttributes3D), (void*)12);
 	glEnableVertexAttribArray(2);
 
+	// Inform OpenGL how to interpret the buffer: ... then 2 floats for lightmap coordinate.
+	glVertexAttribPointer(3, 2, GL_FLOAT, false, sizeof(VertexAttributes3D), (void*)20);
+	glEnableVertexAttribArray(3);
+
 
 	// Generate a second buffer, to store the indices of each triangle in the mesh.
 	uint32_t ebo;
@@ -44,16 +67,115 @@ Mesh3D::Mesh3D(std::vector<Vertex3D>&& vertices, std::vector<uint32_t>&& faces,
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, faces.size() * sizeof(uint32_t), &faces[0], GL_STATIC_DRAW);
 
+	// The depth-only vertex array reuses the position and index buffers.
+	glGenVertexArrays(1, &m_depthVao);
+	glBindVertexArray(m_depthVao);
+	glBindBuffer(GL_ARRAY_BUFFER, positionVbo);
+	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(glm::vec3), 0);
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+
 	// Unbind the vertex array, so no one else can accidentally mess with it.
 	glBindVertexArray(0);
+
+	// Keep the CPU copy around for baking.
+	m_geometry = std::make_shared<const MeshGeometry>(MeshGeometry{ std::move(vertices), std::move(faces) });
+}
+
+Mesh3D::~Mesh3D() {
+	glDeleteBuffers(1, &m_occlusionVbo);
+}
+
+Mesh3D::Mesh3D(Mesh3D&& other) noexcept
+	: m_vao(other.m_vao), m_depthVao(other.m_depthVao), m_textures(std::move(other.m_textures)),
+	m_vertexCount(other.m_vertexCount), m_faceCount(other.m_faceCount), m_geometry(std::move(other.m_geometry)),
+	m_posedGeometry(std::move(other.m_posedGeometry)), m_hasLightMap(other.m_hasLightMap),
+	m_hasVertexOcclusion(other.m_hasVertexOcclusion), m_occlusionVbo(other.m_occlusionVbo) {
+	other.m_occlusionVbo = 0;
+}
+
+Mesh3D& Mesh3D::operator=(Mesh3D&& other) noexcept {
+	if (this != &other) {
+		glDeleteBuffers(1, &m_occlusionVbo);
+		m_vao = other.m_vao;
+		m_depthVao = other.m_depthVao;
+		m_textures = std::move(other.m_textures);
+		m_vertexCount = other.m_vertexCount;
+		m_faceCount = other.m_faceCount;
+		m_geometry = std::move(other.m_geometry);
+		m_posedGeometry = std::move(other.m_posedGeometry);
+		m_hasLightMap = other.m_hasLightMap;
+		m_hasVertexOcclusion = other.m_hasVertexOcclusion;
+		m_occlusionVbo = other.m_occlusionVbo;
+		other.m_occlusionVbo = 0;
+	}
+	return *this;
 }
 
 void Mesh3D::addTexture(Texture texture) {
 	m_textures.push_back(texture);
 }
 
+void Mesh3D::setLightMap(Texture lightMap) {
+	lightMap.samplerName = "lightMap";
+	m_textures.push_back(lightMap);
+	m_hasLightMap = true;
+}
+
+void Mesh3D::setVertexOcclusion(const std::vector<uint8_t>& occlusion) {
+	// Rebaking replaces the contents of the buffer already attached rather than adding another.
+	if (m_occlusionVbo == 0) {
+		glGenBuffers(1, &m_occlusionVbo);
+	}
+	glBindVertexArray(m_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, m_occlusionVbo);
+	glBufferData(GL_ARRAY_BUFFER, occlusion.size(), occlusion.data(), GL_STATIC_DRAW);
+	// One normalized byte per vertex, read as a float in [0, 1].
+	glVertexAttribPointer(4, 1, GL_UNSIGNED_BYTE, true, 1, 0);
+	glEnableVertexAttribArray(4);
+	glBindVertexArray(0);
+	m_hasVertexOcclusion = true;
+}
+
+void Mesh3D::setSkin(std::vector<VertexSkin>&& skin, std::vector<std::string>&& jointNames,
+	std::vector<glm::mat4>&& inverseBindMatrices) {
+	if (skin.size() != m_geometry->vertices.size()) {
+		throw std::runtime_error("Skin has " + std::to_string(skin.size()) + " vertices; the mesh has "
+			+ std::to_string(m_geometry->vertices.size()));
+	}
+	uint32_t skinVbo;
+	glGenBuffers(1, &skinVbo);
+	glBindBuffer(GL_ARRAY_BUFFER, skinVbo);
+	glBufferData(GL_ARRAY_BUFFER, skin.size() * sizeof(VertexSkin), skin.data(), GL_STATIC_DRAW);
+	// Both vertex arrays read the skin, since skinned depth has to move with the joints too:
+	// four joint indices as integers, then four weights normalized from bytes.
+	for (uint32_t vao : { m_vao, m_depthVao }) {
+		glBindVertexArray(vao);
+		glVertexAttribIPointer(5, 4, GL_UNSIGNED_BYTE, sizeof(VertexSkin), 0);
+		glEnableVertexAttribArray(5);
+		glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, true, sizeof(VertexSkin), (void*)4);
+		glEnableVertexAttribArray(6);
+	}
+	glBindVertexArray(0);
+
+	auto geometry = std::make_shared<MeshGeometry>(*m_geometry);
+	geometry->skin = std::move(skin);
+	geometry->jointNames = std::move(jointNames);
+	geometry->inverseBindMatrices = std::move(inverseBindMatrices);
+	m_geometry = geometry;
+}
+
+void Mesh3D::setPosedVertices(std::vector<Vertex3D>&& vertices) {
+	m_posedGeometry = std::make_shared<const MeshGeometry>(MeshGeometry{ std::move(vertices), m_geometry->faces });
+}
+
 void Mesh3D::render(ShaderProgram& program) const {
 	glBindVertexArray(m_vao);
+	program.setUniform("hasLightMap", m_hasLightMap);
+	// Without the attribute array, the shader reads this constant instead: fully unoccluded.
+	if (!m_hasVertexOcclusion) {
+		glVertexAttrib1f(4, 1.0f);
+	}
 	for (auto i = 0; i < m_textures.size(); i++) {
 		program.setUniform(m_textures[i].samplerName, i);
 		glActiveTexture(GL_TEXTURE0 + i);
@@ -67,14 +189,21 @@ void Mesh3D::render(ShaderProgram& program) const {
 	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+void Mesh3D::renderDepth() const {
+	glBindVertexArray(m_depthVao);
+	glDrawElements(GL_TRIANGLES, m_faceCount, GL_UNSIGNED_INT, nullptr);
+	glBindVertexArray(0);
+}
+
 
 Mesh3D Mesh3D::square(const std::vector<Texture>& textures) {
 	return Mesh3D(
 		{
-			{ 0.5, 0.5, 0, 0, 0, 1, 1, 0 },    // TR
-			{ 0.5, -0.5, 0, 0, 0, 1, 1, 1 },   // BR
-			{ -0.5, -0.5, 0, 0, 0, 1, 0, 1 },  // BL
-			{ -0.5, 0.5, 0, 0, 0, 1, 0, 0 },   // TL
+			// The texture coordinates double as lightmap coordinates, since they don't overlap.
+			{ 0.5, 0.5, 0, 0, 0, 1, 1, 0, 1, 0 },    // TR
+			{ 0.5, -0.5, 0, 0, 0, 1, 1, 1, 1, 1 },   // BR
+			{ -0.5, -0.5, 0, 0, 0, 1, 0, 1, 0, 1 },  // BL
+			{ -0.5, 0.5, 0, 0, 0, 1, 0, 0, 0, 0 },   // TL
 		},
 		{
 			2, 1, 3,
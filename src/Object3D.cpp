@@ -7,16 +7,29 @@
 
 bool isMoving = false;
 
+namespace {
+	glm::quat fromEulerAngles(const glm::vec3& angles) {
+		return glm::angleAxis(angles.z, glm::vec3(0, 0, 1)) * glm::angleAxis(angles.x, glm::vec3(1, 0, 0))
+			* glm::angleAxis(angles.y, glm::vec3(0, 1, 0));
+	}
+}
+
 glm::mat4 Object3D::buildModelMatrix() const {
-	auto m = glm::translate(glm::mat4(1), m_position);
-	m = glm::translate(m, m_center * m_scale);
-	m = glm::rotate(m, m_orientation[2], glm::vec3(0, 0, 1));
-	m = glm::rotate(m, m_orientation[0], glm::vec3(1, 0, 0));
-	m = glm::rotate(m, m_orientation[1], glm::vec3(0, 1, 0));
-	m = glm::scale(m, m_scale);
-	m = glm::translate(m, -m_center);
-	m = m * m_baseTransform;
-	return m;
+	// T(position) * T(center * scale) * R * S * T(-center), written out directly: the rotation's
+	// columns scaled, and the translation that keeps the center in place.
+	glm::mat3 rotation = glm::mat3_cast(m_orientation);
+	glm::mat4 m(1);
+	m[0] = glm::vec4(rotation[0] * m_scale.x, 0);
+	m[1] = glm::vec4(rotation[1] * m_scale.y, 0);
+	m[2] = glm::vec4(rotation[2] * m_scale.z, 0);
+	glm::vec3 scaledCenter = m_center * m_scale;
+	m[3] = glm::vec4(m_position + scaledCenter - rotation * scaledCenter, 1);
+	return m * m_baseTransform;
+}
+
+Object3D::Object3D(Mesh3D&& mesh)
+	: Object3D(std::vector<Mesh3D>()) {
+	m_meshes.push_back(std::move(mesh));
 }
 
 Object3D::Object3D(std::vector<Mesh3D>&& meshes)
@@ -24,7 +37,7 @@ Object3D::Object3D(std::vector<Mesh3D>&& meshes)
 }
 
 Object3D::Object3D(std::vector<Mesh3D>&& meshes, const glm::mat4& baseTransform)
-	: m_meshes(meshes), m_position(), m_orientation(), m_scale(1.0),
+	: m_meshes(std::move(meshes)), m_position(), m_orientation(1, 0, 0, 0), m_scale(1.0),
 	m_center(), m_baseTransform(baseTransform), m_material(0.1, 1.0, 0.3, 4)
 {
 }
@@ -33,7 +46,7 @@ const glm::vec3& Object3D::getPosition() const {
 	return m_position;
 }
 
-const glm::vec3& Object3D::getOrientation() const {
+const glm::quat& Object3D::getOrientation() const {
 	return m_orientation;
 }
 
@@ -65,6 +78,17 @@ const float Object3D::getBounceCoeff() const {
 	return m_bounceCoeff;
 }
 
+/**
+ * @brief Whether the object (and all of its children) never moves after the scene is built.
+ */
+bool Object3D::isStatic() const {
+	return m_isStatic;
+}
+
+glm::mat4 Object3D::getModelMatrix() const {
+	return buildModelMatrix();
+}
+
 size_t Object3D::numberOfChildren() const {
 	return m_children.size();
 }
@@ -77,14 +101,42 @@ Object3D& Object3D::getChild(size_t index) {
 	return m_children[index];
 }
 
+size_t Object3D::numberOfMeshes() const {
+	return m_meshes.size();
+}
+
+Mesh3D& Object3D::getMesh(size_t index) {
+	return m_meshes[index];
+}
+
+/**
+ * @brief Calls the visitor on every mesh of the object and its children, depth first, along with
+ * the mesh's local->world model matrix.
+ * @param parentMatrix the model matrix of this object's parent in the model hierarchy.
+ */
+void Object3D::visitMeshes(const std::function<void(Mesh3D& mesh, const glm::mat4& model)>& visitor,
+	const glm::mat4& parentMatrix) {
+	glm::mat4 trueModel = parentMatrix * buildModelMatrix();
+	for (auto& mesh : m_meshes) {
+		visitor(mesh, trueModel);
+	}
+	for (auto& child : m_children) {
+		child.visitMeshes(visitor, trueModel);
+	}
+}
+
 void Object3D::setPosition(const glm::vec3& position) {
 	m_position = position;
 }
 
-void Object3D::setOrientation(const glm::vec3& orientation) {
+void Object3D::setOrientation(const glm::quat& orientation) {
 	m_orientation = orientation;
 }
 
+void Object3D::setOrientation(const glm::vec3& eulerAngles) {
+	m_orientation = fromEulerAngles(eulerAngles);
+}
+
 void Object3D::setScale(const glm::vec3& scale) {
 	m_scale = scale;
 }
@@ -117,11 +169,21 @@ void Object3D::setAngularVelocity(const glm::vec3& angularVelocity) {
 void Object3D::setBounceCoeff(float bounceCoeff) {
 	m_bounceCoeff = bounceCoeff;
 }
+void Object3D::setStatic(bool isStatic) {
+	m_isStatic = isStatic;
+}
+void Object3D::setBaseTransform(const glm::mat4& baseTransform) {
+	m_baseTransform = baseTransform;
+}
 void Object3D::move(const glm::vec3& offset) {
 	m_position = m_position + offset;
 }
-void Object3D::rotate(const glm::vec3& rotation) {
-	m_orientation = m_orientation + rotation;
+void Object3D::rotate(const glm::quat& rotation) {
+	m_orientation = glm::normalize(m_orientation * rotation);
+}
+
+void Object3D::rotate(const glm::vec3& eulerAngles) {
+	rotate(fromEulerAngles(eulerAngles));
 }
 
 void Object3D::grow(const glm::vec3& growth) {
@@ -129,7 +191,7 @@ void Object3D::grow(const glm::vec3& growth) {
 }
 
 void Object3D::addChild(Object3D&& child) {
-	m_children.emplace_back(child);
+	m_children.emplace_back(std::move(child));
 }
 
 void Object3D::render(ShaderProgram& shaderProgram) const {
@@ -144,17 +206,45 @@ void Object3D::renderRecursive(ShaderProgram& shaderProgram, const glm::mat4& pa
 	// This object's true model matrix is the combination of its parent's matrix and the object's matrix.
 	glm::mat4 trueModel = parentMatrix * buildModelMatrix();
 	shaderProgram.setUniform("model", trueModel);
-	// Render each mesh in the object.
+	// Render each mesh in the object. Skinned meshes need a pose, which a SkinnedModel supplies.
 	for (auto& mesh : m_meshes) {
-		mesh.render(shaderProgram);
+		if (!mesh.isSkinned()) {
+			mesh.render(shaderProgram);
+		}
 	}
 	// Render the children of the object.
 	for (auto& child : m_children) {
 		child.renderRecursive(shaderProgram, trueModel);
 	}
 }
+
+void Object3D::renderDepth(ShaderProgram& shaderProgram) const {
+	renderDepthRecursive(shaderProgram, glm::mat4(1));
+}
+
+/**
+ * @brief Renders only the depth of the object and its children, recursively, using each mesh's
+ * position-only vertex stream.
+ * @param parentMatrix the model matrix of this object's parent in the model hierarchy.
+ */
+void Object3D::renderDepthRecursive(ShaderProgram& shaderProgram, const glm::mat4& parentMatrix) const {
+	glm::mat4 trueModel = parentMatrix * buildModelMatrix();
+	shaderProgram.setUniform("model", trueModel);
+	for (auto& mesh : m_meshes) {
+		if (!mesh.isSkinned()) {
+			mesh.renderDepth();
+		}
+	}
+	for (auto& child : m_children) {
+		child.renderDepthRecursive(shaderProgram, trueModel);
+	}
+}
 void Object3D::tick(float dt) {
 	m_velocity += m_acceleration * dt;
 	m_position += m_velocity * dt;
-	m_orientation += m_angularVelocity * dt;
+	// The angular velocity is in world space, so its turn applies before the current orientation.
+	float angle = glm::length(m_angularVelocity) * dt;
+	if (angle > 0) {
+		m_orientation = glm::normalize(glm::angleAxis(angle, glm::normalize(m_angularVelocity)) * m_orientation);
+	}
 };
\ No newline at end of file
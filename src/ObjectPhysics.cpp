@@ -0,0 +1,73 @@
+#include "ObjectPhysics.h"
+#include <atomic>
+#include <iostream>
+#include <limits>
+
+void appendCollisionTriangles(Object3D& object, std::vector<glm::vec3>& triangles) {
+	object.visitMeshes([&](Mesh3D& mesh, const glm::mat4& model) {
+		const MeshGeometry& geometry = mesh.geometry();
+		for (uint32_t index : geometry.faces) {
+			const Vertex3D& v = geometry.vertices[index];
+			triangles.push_back(glm::vec3(model * glm::vec4(v.x, v.y, v.z, 1)));
+		}
+	});
+}
+
+std::vector<CollisionShape> cookCollisionShapes(std::vector<Object3D>& objects, const CollisionShapeSettings& settings,
+	ThreadPool& pool, const std::filesystem::path& cacheDirectory) {
+	std::filesystem::create_directories(cacheDirectory);
+	std::vector<CollisionShape> shapes(objects.size());
+	std::atomic<uint32_t> built = 0, cached = 0;
+	// One object per task: the tables take far longer than the walls.
+	pool.parallelFor(static_cast<uint32_t>(objects.size()), 1, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			if (!objects[i].isStatic()) {
+				continue;
+			}
+			std::vector<glm::vec3> triangles;
+			appendCollisionTriangles(objects[i], triangles);
+			std::filesystem::path path = cacheDirectory / ("object" + std::to_string(i) + ".shape");
+			if (loadCollisionShape(path, triangles, settings, shapes[i])) {
+				cached++;
+				continue;
+			}
+			shapes[i] = buildCollisionShape(triangles, settings);
+			saveCollisionShape(path, shapes[i], triangles, settings);
+			built++;
+		}
+	});
+	std::cout << "collision shapes: " << built << " built, " << cached << " loaded from cache" << std::endl;
+	return shapes;
+}
+
+PhysicsBinding addBoxBody(PhysicsWorld& world, Object3D& object, float mass, float friction) {
+	glm::vec3 lower(std::numeric_limits<float>::max());
+	glm::vec3 upper(-std::numeric_limits<float>::max());
+	object.visitMeshes([&](Mesh3D& mesh, const glm::mat4& model) {
+		for (auto& v : mesh.geometry().vertices) {
+			glm::vec3 world = glm::vec3(model * glm::vec4(v.x, v.y, v.z, 1));
+			lower = glm::min(lower, world);
+			upper = glm::max(upper, world);
+		}
+	});
+
+	glm::quat orientation = object.getOrientation();
+	glm::vec3 center = (lower + upper) * 0.5f;
+	RigidBody body = RigidBody::box((upper - lower) * 0.5f, mass, center, orientation);
+	body.linearVelocity = object.getVelocity();
+	body.angularVelocity = object.getAngularVelocity();
+	body.restitution = object.getBounceCoeff();
+	body.friction = friction;
+
+	glm::vec3 pivot = object.getPosition() + object.getCenter() * object.getScale();
+	glm::vec3 offset = glm::inverse(orientation) * (center - pivot);
+	return PhysicsBinding{ &object, world.addBody(body), offset };
+}
+
+void syncObject(const PhysicsWorld& world, const PhysicsBinding& binding) {
+	const RigidBody& body = world.body(binding.body);
+	glm::vec3 pivot = body.position - body.orientation * binding.pivotOffset;
+	Object3D& object = *binding.object;
+	object.setPosition(pivot - object.getCenter() * object.getScale());
+	object.setOrientation(body.orientation);
+}
@@ -0,0 +1,389 @@
+#include "PathTracer.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <unordered_map>
+#include "ImageWriter.h"
+
+namespace {
+	// Pushes ray origins off their surface to avoid self-intersection.
+	const float SURFACE_OFFSET = 2e-3f;
+	// Bounces before Russian roulette may end a path.
+	const uint32_t ROULETTE_START = 3;
+	// Samples per pixel in the largest progressive pass; early passes are smaller so a preview
+	// shows up quickly.
+	const uint32_t MAX_SAMPLES_PER_PASS = 16;
+	// Used when a mesh has no texture of that kind.
+	const glm::vec3 DEFAULT_BASE_COLOR = glm::vec3(0.5f);
+	const float DEFAULT_ROUGHNESS = 0.8f;
+
+	/**
+	 * @brief Copies a texture's finest resident mip level out of VRAM.
+	 */
+	PathTracer::Image readTexture(uint32_t textureId) {
+		PathTracer::Image image;
+		int32_t baseLevel = 0, width = 0, height = 0;
+		glBindTexture(GL_TEXTURE_2D, textureId);
+		// Streamed textures may not have their finer levels loaded.
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, &baseLevel);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, baseLevel, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, baseLevel, GL_TEXTURE_HEIGHT, &height);
+		std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glGetTexImage(GL_TEXTURE_2D, baseLevel, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		image.width = width;
+		image.height = height;
+		image.texels.resize(static_cast<size_t>(width) * height);
+		for (size_t i = 0; i < image.texels.size(); i++) {
+			image.texels[i] = glm::vec4(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2], rgba[i * 4 + 3]) / 255.0f;
+		}
+		return image;
+	}
+
+	uint32_t hashSeed(uint32_t pixel, uint32_t sample) {
+		uint32_t h = pixel * 0x9e3779b1u ^ (sample + 0x7f4a7c15u) * 0x85ebca77u;
+		h ^= h >> 16;
+		h *= 0x7feb352du;
+		h ^= h >> 15;
+		return h;
+	}
+
+	float ggxDistribution(float nDotH, float alpha2) {
+		float d = nDotH * nDotH * (alpha2 - 1) + 1;
+		return alpha2 / (glm::pi<float>() * d * d);
+	}
+
+	float smithMasking(float nDotV, float alpha2) {
+		return 2 * nDotV / (nDotV + std::sqrt(alpha2 + (1 - alpha2) * nDotV * nDotV));
+	}
+
+	/**
+	 * @brief A surface's Lambert + GGX reflectance, and the lobe choices used to sample it.
+	 */
+	struct Surface {
+		glm::vec3 normal;
+		glm::vec3 baseColor;
+		float metallic;
+		float alpha2;
+		// The chance of sampling the specular lobe rather than the diffuse one.
+		float specularChance;
+
+		glm::vec3 brdf(const glm::vec3& toViewer, const glm::vec3& toLight) const {
+			float nDotL = glm::dot(normal, toLight);
+			float nDotV = glm::dot(normal, toViewer);
+			if (nDotL <= 0 || nDotV <= 0) {
+				return glm::vec3(0);
+			}
+			glm::vec3 half = glm::normalize(toViewer + toLight);
+			float vDotH = std::max(glm::dot(toViewer, half), 0.0f);
+			glm::vec3 f0 = glm::mix(glm::vec3(0.04f), baseColor, metallic);
+			glm::vec3 fresnel = f0 + (1.0f - f0) * std::pow(1 - vDotH, 5.0f);
+			glm::vec3 diffuse = (1.0f - metallic) * (1.0f - fresnel) * baseColor / glm::pi<float>();
+			float specular = ggxDistribution(std::max(glm::dot(normal, half), 0.0f), alpha2)
+				* smithMasking(nDotL, alpha2) * smithMasking(nDotV, alpha2) / (4 * nDotL * nDotV);
+			return diffuse + fresnel * specular;
+		}
+
+		float pdf(const glm::vec3& toViewer, const glm::vec3& toLight) const {
+			float nDotL = glm::dot(normal, toLight);
+			if (nDotL <= 0) {
+				return 0;
+			}
+			glm::vec3 half = glm::normalize(toViewer + toLight);
+			float nDotH = std::max(glm::dot(normal, half), 0.0f);
+			float vDotH = std::max(glm::dot(toViewer, half), 1e-6f);
+			float specularPdf = ggxDistribution(nDotH, alpha2) * nDotH / (4 * vDotH);
+			return specularChance * specularPdf + (1 - specularChance) * nDotL / glm::pi<float>();
+		}
+
+		glm::vec3 sample(const glm::vec3& toViewer, Rng& rng) const {
+			if (rng.next() >= specularChance) {
+				return cosineSample(normal, rng);
+			}
+			// GGX half-vector sampling (Walter et al. 2007).
+			float phi = glm::two_pi<float>() * rng.next();
+			float u = rng.next();
+			float cosTheta = std::sqrt((1 - u) / (1 + (alpha2 - 1) * u));
+			float sinTheta = std::sqrt(std::max(0.0f, 1 - cosTheta * cosTheta));
+			glm::vec3 tangent, bitangent;
+			orthonormalBasis(normal, tangent, bitangent);
+			glm::vec3 half = tangent * (sinTheta * std::cos(phi)) + bitangent * (sinTheta * std::sin(phi))
+				+ normal * cosTheta;
+			return glm::reflect(-toViewer, half);
+		}
+	};
+}
+
+glm::vec4 PathTracer::Image::sample(glm::vec2 uv) const {
+	float x = uv.x * width - 0.5f;
+	float y = uv.y * height - 0.5f;
+	float fx = x - std::floor(x), fy = y - std::floor(y);
+	auto texel = [&](int64_t tx, int64_t ty) {
+		tx = ((tx % width) + width) % width;
+		ty = ((ty % height) + height) % height;
+		return texels[ty * width + tx];
+	};
+	int64_t x0 = static_cast<int64_t>(std::floor(x)), y0 = static_cast<int64_t>(std::floor(y));
+	return glm::mix(glm::mix(texel(x0, y0), texel(x0 + 1, y0), fx),
+		glm::mix(texel(x0, y0 + 1), texel(x0 + 1, y0 + 1), fx), fy);
+}
+
+PathTracer::PathTracer(std::vector<Object3D>& objects, const PathTraceSettings& settings)
+	: m_settings(settings), m_samples(0) {
+	std::vector<glm::vec3> triangles;
+	std::unordered_map<uint32_t, int32_t> imageIndices;
+	auto imageFor = [&](uint32_t textureId) {
+		auto existing = imageIndices.find(textureId);
+		if (existing != imageIndices.end()) {
+			return existing->second;
+		}
+		m_images.push_back(readTexture(textureId));
+		int32_t index = static_cast<int32_t>(m_images.size() - 1);
+		imageIndices[textureId] = index;
+		return index;
+	};
+
+	for (auto& object : objects) {
+		object.visitMeshes([&](Mesh3D& mesh, const glm::mat4& model) {
+			Material material;
+			for (auto& texture : mesh.textures()) {
+				if (texture.samplerName == "baseTexture" && material.baseColor < 0) {
+					material.baseColor = imageFor(texture.textureId);
+				}
+				else if (texture.samplerName == "metallicRoughness" && material.metallicRoughness < 0) {
+					material.metallicRoughness = imageFor(texture.textureId);
+				}
+				else if (texture.samplerName == "normalMap" && material.normalMap < 0) {
+					material.normalMap = imageFor(texture.textureId);
+				}
+			}
+			m_materials.push_back(material);
+
+			// Skinned meshes as last skinned on the CPU.
+			const MeshGeometry& geometry = mesh.posedGeometry();
+			glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+			for (size_t f = 0; f + 2 < geometry.faces.size(); f += 3) {
+				TriangleShading shading;
+				glm::vec3 positions[3];
+				for (int k = 0; k < 3; k++) {
+					const Vertex3D& v = geometry.vertices[geometry.faces[f + k]];
+					positions[k] = glm::vec3(model * glm::vec4(v.x, v.y, v.z, 1));
+					shading.normals[k] = normalMatrix * glm::vec3(v.nx, v.ny, v.nz);
+					shading.uvs[k] = glm::vec2(v.u, v.v);
+					triangles.push_back(positions[k]);
+				}
+
+				glm::vec3 edge1 = positions[1] - positions[0], edge2 = positions[2] - positions[0];
+				glm::vec3 normal = glm::cross(edge1, edge2);
+				float length = glm::length(normal);
+				normal = length > 0 ? normal / length : glm::vec3(0, 1, 0);
+				m_geometricNormals.push_back(normal);
+
+				glm::vec2 duv1 = shading.uvs[1] - shading.uvs[0], duv2 = shading.uvs[2] - shading.uvs[0];
+				float determinant = duv1.x * duv2.y - duv1.y * duv2.x;
+				if (std::abs(determinant) > 1e-12f) {
+					shading.tangent = (edge1 * duv2.y - edge2 * duv1.y) / determinant;
+					shading.bitangent = (edge2 * duv1.x - edge1 * duv2.x) / determinant;
+				}
+				else {
+					orthonormalBasis(normal, shading.tangent, shading.bitangent);
+				}
+				shading.material = static_cast<uint32_t>(m_materials.size() - 1);
+				m_shading.push_back(shading);
+			}
+		});
+	}
+	m_bvh = WideBvh(TriangleBvh(triangles));
+	std::cout << "path tracer: " << m_bvh.triangleCount() << " triangles, " << m_images.size()
+		<< " textures" << std::endl;
+}
+
+glm::vec3 PathTracer::radiance(Ray ray, Rng& rng) const {
+	glm::vec3 toSun = -glm::normalize(m_settings.lightDirection);
+	// lighting.frag scales a Lambert surface's light by k_d * color * cos, with no 1/pi; the sun's
+	// irradiance is scaled by pi so a diffuse BRDF reproduces that brightness.
+	glm::vec3 sunIrradiance = glm::pi<float>() * m_settings.material.y * m_settings.lightColor;
+	glm::vec3 ambientRadiance = m_settings.material.x * m_settings.ambientColor;
+
+	glm::vec3 result(0);
+	glm::vec3 throughput(1);
+	RayHit hit;
+	if (!m_bvh.intersect(ray, hit)) {
+		return result;
+	}
+	for (uint32_t bounce = 0; ; bounce++) {
+		const TriangleShading& shading = m_shading[hit.triangle];
+		const Material& material = m_materials[shading.material];
+		float w = 1 - hit.u - hit.v;
+		glm::vec3 position = ray.origin + ray.direction * hit.t;
+		glm::vec2 uv = shading.uvs[0] * w + shading.uvs[1] * hit.u + shading.uvs[2] * hit.v;
+		glm::vec3 toViewer = -glm::normalize(ray.direction);
+
+		// Face the geometric normal towards the viewer, and the shading normal to match it.
+		glm::vec3 geometricNormal = m_geometricNormals[hit.triangle];
+		if (glm::dot(geometricNormal, toViewer) < 0) {
+			geometricNormal = -geometricNormal;
+		}
+		glm::vec3 normal = shading.normals[0] * w + shading.normals[1] * hit.u + shading.normals[2] * hit.v;
+		float normalLength = glm::length(normal);
+		normal = normalLength > 0 ? normal / normalLength : geometricNormal;
+		if (glm::dot(normal, geometricNormal) < 0) {
+			normal = -normal;
+		}
+		if (material.normalMap >= 0) {
+			glm::vec3 mapped = glm::vec3(m_images[material.normalMap].sample(uv)) * 2.0f - 1.0f;
+			glm::vec3 tangent = shading.tangent - normal * glm::dot(normal, shading.tangent);
+			glm::vec3 bitangent = shading.bitangent - normal * glm::dot(normal, shading.bitangent);
+			if (glm::dot(tangent, tangent) > 0 && glm::dot(bitangent, bitangent) > 0) {
+				glm::vec3 perturbed = glm::normalize(tangent) * mapped.x + glm::normalize(bitangent) * mapped.y
+					+ normal * mapped.z;
+				if (glm::dot(perturbed, perturbed) > 0 && glm::dot(perturbed, geometricNormal) > 0) {
+					normal = glm::normalize(perturbed);
+				}
+			}
+		}
+
+		Surface surface;
+		surface.normal = normal;
+		surface.baseColor = material.baseColor >= 0
+			? glm::vec3(m_images[material.baseColor].sample(uv)) : DEFAULT_BASE_COLOR;
+		surface.metallic = 0;
+		float roughness = DEFAULT_ROUGHNESS;
+		if (material.metallicRoughness >= 0) {
+			// glTF packs roughness in green and metalness in blue.
+			glm::vec4 packed = m_images[material.metallicRoughness].sample(uv);
+			roughness = packed.g;
+			surface.metallic = packed.b;
+		}
+		float alpha = std::max(roughness * roughness, 1e-3f);
+		surface.alpha2 = alpha * alpha;
+		surface.specularChance = glm::mix(0.25f, 1.0f, surface.metallic);
+
+		// Direct light from the sun, with a shadow ray.
+		glm::vec3 origin = position + geometricNormal * SURFACE_OFFSET;
+		float nDotSun = glm::dot(normal, toSun);
+		if (nDotSun > 0 && glm::dot(geometricNormal, toSun) > 0
+			&& !m_bvh.occluded(Ray{ origin, toSun, std::numeric_limits<float>::max() })) {
+			result += throughput * surface.brdf(toViewer, toSun) * sunIrradiance * nDotSun;
+		}
+
+		// Continue the path along a direction drawn from the BRDF.
+		glm::vec3 direction = surface.sample(toViewer, rng);
+		float pdf = surface.pdf(toViewer, direction);
+		float nDotL = glm::dot(normal, direction);
+		if (pdf <= 0 || nDotL <= 0 || glm::dot(geometricNormal, direction) <= 0) {
+			break;
+		}
+		glm::vec3 weight = surface.brdf(toViewer, direction) * nDotL / pdf;
+		if (!std::isfinite(weight.x + weight.y + weight.z)) {
+			break;
+		}
+		throughput *= weight;
+
+		ray = Ray{ origin, direction, std::numeric_limits<float>::max() };
+		bool hitSomething = m_bvh.intersect(ray, hit);
+		// Ambient light arrives along directions that stay open for a little while, like the
+		// baked occlusion the real-time lighting uses.
+		if (!hitSomething || hit.t > m_settings.occlusionDistance) {
+			result += throughput * ambientRadiance;
+		}
+		if (!hitSomething || bounce + 1 >= m_settings.maxBounces) {
+			break;
+		}
+		if (bounce + 1 >= ROULETTE_START) {
+			float survival = std::min(std::max(throughput.x, std::max(throughput.y, throughput.z)), 0.95f);
+			if (rng.next() >= survival) {
+				break;
+			}
+			throughput /= survival;
+		}
+	}
+	return result;
+}
+
+void PathTracer::render(const glm::vec3& cameraPosition, const glm::vec3& cameraDirection, ThreadPool& pool,
+	const std::function<void(uint32_t samples)>& onPass) {
+	uint32_t width = m_settings.width, height = m_settings.height;
+	m_accumulation.assign(static_cast<size_t>(width) * height, glm::vec3(0));
+	m_samples = 0;
+
+	// The same pinhole camera as the real-time view matrix and projection.
+	glm::vec3 forward = glm::normalize(cameraDirection);
+	glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0, 1, 0)));
+	glm::vec3 up = glm::cross(right, forward);
+	float tanHalfFov = std::tan(m_settings.verticalFov / 2);
+	float aspect = static_cast<float>(width) / height;
+
+	uint32_t tileSize = std::max(m_settings.tileSize, 1u);
+	uint32_t tilesX = (width + tileSize - 1) / tileSize;
+	uint32_t tilesY = (height + tileSize - 1) / tileSize;
+
+	uint32_t passSamples = 1;
+	while (m_samples < m_settings.samplesPerPixel) {
+		passSamples = std::min(passSamples, m_settings.samplesPerPixel - m_samples);
+		uint32_t firstSample = m_samples;
+		pool.parallelFor(tilesX * tilesY, 1, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t tile = begin; tile < end; tile++) {
+				uint32_t x0 = (tile % tilesX) * tileSize, y0 = (tile / tilesX) * tileSize;
+				for (uint32_t y = y0; y < std::min(y0 + tileSize, height); y++) {
+					for (uint32_t x = x0; x < std::min(x0 + tileSize, width); x++) {
+						uint32_t pixel = y * width + x;
+						glm::vec3 sum(0);
+						for (uint32_t s = 0; s < passSamples; s++) {
+							Rng rng(hashSeed(pixel, firstSample + s));
+							float px = (2 * (x + rng.next()) / width - 1) * aspect * tanHalfFov;
+							float py = (1 - 2 * (y + rng.next()) / height) * tanHalfFov;
+							Ray ray{ cameraPosition, forward + right * px + up * py, std::numeric_limits<float>::max() };
+							sum += radiance(ray, rng);
+						}
+						m_accumulation[pixel] += sum;
+					}
+				}
+			}
+		});
+		m_samples += passSamples;
+		onPass(m_samples);
+		passSamples = std::min(passSamples * 2, MAX_SAMPLES_PER_PASS);
+	}
+}
+
+std::vector<float> PathTracer::linearImage() const {
+	std::vector<float> rgb(m_accumulation.size() * 3);
+	float scale = m_samples > 0 ? 1.0f / m_samples : 0;
+	for (size_t i = 0; i < m_accumulation.size(); i++) {
+		rgb[i * 3] = m_accumulation[i].r * scale;
+		rgb[i * 3 + 1] = m_accumulation[i].g * scale;
+		rgb[i * 3 + 2] = m_accumulation[i].b * scale;
+	}
+	return rgb;
+}
+
+std::vector<uint8_t> PathTracer::displayImage() const {
+	std::vector<float> rgb = linearImage();
+	std::vector<uint8_t> rgba(m_accumulation.size() * 4, 255);
+	for (size_t i = 0; i < m_accumulation.size(); i++) {
+		for (int c = 0; c < 3; c++) {
+			// lighting.frag writes its colors without a transfer curve, so neither do we.
+			rgba[i * 4 + c] = static_cast<uint8_t>(std::clamp(rgb[i * 3 + c], 0.0f, 1.0f) * 255 + 0.5f);
+		}
+	}
+	return rgba;
+}
+
+void PathTracer::renderToFiles(const glm::vec3& cameraPosition, const glm::vec3& cameraDirection,
+	ThreadPool& pool, const std::filesystem::path& stem) {
+	std::filesystem::path png = stem, exr = stem;
+	png += ".png";
+	exr += ".exr";
+	render(cameraPosition, cameraDirection, pool, [&](uint32_t samples) {
+		writePng(png, displayImage().data(), m_settings.width, m_settings.height);
+		std::cout << "path tracer: " << samples << "/" << m_settings.samplesPerPixel << " samples per pixel"
+			<< std::endl;
+	});
+	writeExr(exr, linearImage().data(), m_settings.width, m_settings.height);
+	std::cout << "path tracer: wrote " << png.string() << " and " << exr.string() << std::endl;
+}
@@ -0,0 +1,124 @@
+#include "PhysicsBenchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "Broadphase.h"
+#include "Sampling.h"
+
+namespace {
+	const float HALF_SIZE = 0.05f;
+	// Floor area per box, which keeps the density the same at every body count.
+	const float AREA_PER_BODY = 0.1f;
+	const float STEP = 1.0f / 120.0f;
+
+	struct BenchmarkResult {
+		uint32_t bodies;
+		double sweepMilliseconds;
+		double bruteForceMilliseconds;
+		double averagePairs;
+		bool pairsMatch;
+	};
+
+	struct Drifter {
+		glm::vec3 position;
+		glm::vec3 velocity;
+	};
+
+	Aabb bounds(const Drifter& drifter) {
+		return Aabb{ drifter.position - HALF_SIZE, drifter.position + HALF_SIZE };
+	}
+
+	void move(std::vector<Drifter>& drifters, float side) {
+		for (auto& d : drifters) {
+			d.position += d.velocity * STEP;
+			// Bounce off the edges of the floor.
+			for (int axis : { 0, 2 }) {
+				if (d.position[axis] < 0 || d.position[axis] > side) {
+					d.velocity[axis] = -d.velocity[axis];
+				}
+			}
+		}
+	}
+
+	size_t bruteForcePairs(const std::vector<Aabb>& boxes) {
+		size_t pairs = 0;
+		for (size_t i = 0; i < boxes.size(); i++) {
+			for (size_t j = i + 1; j < boxes.size(); j++) {
+				pairs += boxes[i].overlaps(boxes[j]);
+			}
+		}
+		return pairs;
+	}
+
+	BenchmarkResult run(uint32_t bodyCount, uint32_t frames, uint32_t bruteForceFrames) {
+		using Clock = std::chrono::steady_clock;
+		float side = std::sqrt(bodyCount * AREA_PER_BODY);
+		Rng rng(bodyCount);
+		std::vector<Drifter> drifters(bodyCount);
+		SweepAndPrune broadphase;
+		for (auto& d : drifters) {
+			d.position = glm::vec3(rng.next() * side, rng.next() * 0.5f, rng.next() * side);
+			d.velocity = glm::vec3(rng.next() - 0.5f, 0, rng.next() - 0.5f);
+			broadphase.add(bounds(d));
+		}
+		// The first search sorts from scratch; time the steady state after it.
+		broadphase.findPairs();
+
+		BenchmarkResult result{ bodyCount, 0, 0, 0, true };
+		std::vector<Aabb> boxes(bodyCount);
+		double totalPairs = 0;
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			move(drifters, side);
+			auto start = Clock::now();
+			for (uint32_t i = 0; i < bodyCount; i++) {
+				broadphase.update(i, bounds(drifters[i]));
+			}
+			size_t pairs = broadphase.findPairs().size();
+			result.sweepMilliseconds += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			totalPairs += pairs;
+
+			if (frame < bruteForceFrames) {
+				start = Clock::now();
+				for (uint32_t i = 0; i < bodyCount; i++) {
+					boxes[i] = bounds(drifters[i]);
+				}
+				size_t expected = bruteForcePairs(boxes);
+				result.bruteForceMilliseconds += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+				result.pairsMatch = result.pairsMatch && expected == pairs;
+			}
+		}
+		result.sweepMilliseconds /= frames;
+		result.bruteForceMilliseconds /= std::max(bruteForceFrames, 1u);
+		result.averagePairs = totalPairs / frames;
+		return result;
+	}
+}
+
+void runBroadphaseBenchmark(const std::string& reportPath) {
+	std::vector<BenchmarkResult> results;
+	// Testing every pair of 10k boxes takes a while, so it only gets a few frames.
+	results.push_back(run(100, 1200, 1200));
+	results.push_back(run(1000, 1200, 120));
+	results.push_back(run(10000, 600, 5));
+
+	std::ofstream out(reportPath);
+	out << "[\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const auto& r = results[i];
+		std::cout << r.bodies << " bodies: sweep-and-prune " << r.sweepMilliseconds << " ms, all pairs "
+			<< r.bruteForceMilliseconds << " ms, " << r.averagePairs << " pairs"
+			<< (r.pairsMatch ? "" : " (MISMATCH)") << std::endl;
+		out << "  {\n";
+		out << "    \"bodies\": " << r.bodies << ",\n";
+		out << "    \"sweepAndPruneMs\": " << r.sweepMilliseconds << ",\n";
+		out << "    \"allPairsMs\": " << r.bruteForceMilliseconds << ",\n";
+		out << "    \"averagePairs\": " << r.averagePairs << ",\n";
+		out << "    \"pairsMatch\": " << (r.pairsMatch ? "true" : "false") << "\n";
+		out << "  }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "]\n";
+	std::cout << "broadphase report written to " << reportPath << std::endl;
+}
@@ -0,0 +1,444 @@
+#include "PhysicsWorld.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "ContactModel.h"
+#include "ContentHash.h"
+#include "Sampling.h"
+
+namespace {
+	const glm::vec3 CORNER_SIGNS[8] = {
+		{ -1, -1, -1 }, { 1, -1, -1 }, { -1, 1, -1 }, { 1, 1, -1 },
+		{ -1, -1, 1 }, { 1, -1, 1 }, { -1, 1, 1 }, { 1, 1, 1 },
+	};
+
+	/**
+	 * @brief The effective mass of a pair of bodies for an impulse along a direction.
+	 */
+	float effectiveMass(const RigidBody& a, const RigidBody* b, const glm::vec3& point, const glm::vec3& direction) {
+		glm::vec3 ra = point - a.position;
+		glm::vec3 raCross = glm::cross(ra, direction);
+		float k = a.inverseMass + glm::dot(raCross, a.inverseInertiaWorld() * raCross);
+		if (b) {
+			glm::vec3 rb = point - b->position;
+			glm::vec3 rbCross = glm::cross(rb, direction);
+			k += b->inverseMass + glm::dot(rbCross, b->inverseInertiaWorld() * rbCross);
+		}
+		return k > 0 ? 1.0f / k : 0.0f;
+	}
+
+	/**
+	 * @brief The world-space bounds of a body's box, grown by the contact margin.
+	 */
+	Aabb bodyBounds(const RigidBody& body) {
+		glm::mat3 rotation = glm::mat3_cast(body.orientation);
+		glm::vec3 extent(ContactModel::CONTACT_MARGIN);
+		for (int axis = 0; axis < 3; axis++) {
+			extent += glm::abs(rotation[axis]) * body.halfExtents[axis];
+		}
+		return Aabb{ body.position - extent, body.position + extent };
+	}
+
+	/**
+	 * @brief Whether a point on a triangle's plane lies inside the triangle.
+	 */
+	bool insideTriangle(const TriangleBvh::Triangle& tri, const glm::vec3& point) {
+		glm::vec3 p = point - tri.v0;
+		float d00 = glm::dot(tri.edge1, tri.edge1);
+		float d01 = glm::dot(tri.edge1, tri.edge2);
+		float d11 = glm::dot(tri.edge2, tri.edge2);
+		float d20 = glm::dot(p, tri.edge1);
+		float d21 = glm::dot(p, tri.edge2);
+		float denominator = d00 * d11 - d01 * d01;
+		if (denominator <= 0) {
+			return false;
+		}
+		float v = (d11 * d20 - d01 * d21) / denominator;
+		float w = (d00 * d21 - d01 * d20) / denominator;
+		return v >= 0 && w >= 0 && v + w <= 1;
+	}
+}
+
+PhysicsWorld::PhysicsWorld(const PhysicsSettings& settings, ThreadPool* pool)
+	: m_settings(settings), m_pool(pool), m_maxImpactSpeed(0), m_sweptHits(0) {
+}
+
+uint32_t PhysicsWorld::addBody(const RigidBody& body) {
+	m_bodies.push_back(body);
+	m_bodies.back().awake = body.inverseMass > 0;
+	m_broadphase.add(bodyBounds(body));
+	return static_cast<uint32_t>(m_bodies.size() - 1);
+}
+
+void PhysicsWorld::wake(uint32_t index) {
+	if (m_bodies[index].inverseMass == 0) {
+		m_broadphase.update(index, bodyBounds(m_bodies[index]));
+		return;
+	}
+	m_bodies[index].awake = true;
+	m_bodies[index].restingTime = 0;
+}
+
+size_t PhysicsWorld::awakeBodyCount() const {
+	return std::count_if(m_bodies.begin(), m_bodies.end(), [](const RigidBody& body) { return body.awake; });
+}
+
+uint64_t PhysicsWorld::stateChecksum() const {
+	ContentHash hash;
+	for (auto& body : m_bodies) {
+		hash.add(body.position);
+		hash.add(body.orientation);
+	}
+	return hash.value();
+}
+
+void PhysicsWorld::setStaticGeometry(const std::vector<glm::vec3>& triangleVertices) {
+	m_staticGeometry = TriangleBvh(triangleVertices);
+}
+
+void PhysicsWorld::addContact(const Contact& found, float dt) {
+	// The moving body goes first, and a static one is solved like the static geometry, so the
+	// solver never touches it and islands never share it.
+	Contact contact = found;
+	if (contact.bodyB != STATIC_BODY && m_bodies[contact.bodyA].inverseMass == 0) {
+		std::swap(contact.bodyA, contact.bodyB);
+		contact.normal = -contact.normal;
+	}
+	RigidBody& a = m_bodies[contact.bodyA];
+	RigidBody* b = contact.bodyB == STATIC_BODY ? nullptr : &m_bodies[contact.bodyB];
+	if (b && b->inverseMass == 0) {
+		contact.bodyB = STATIC_BODY;
+	}
+
+	SolverContact solver{ contact };
+	orthonormalBasis(contact.normal, solver.tangent1, solver.tangent2);
+	solver.normalMass = effectiveMass(a, b, contact.point, contact.normal);
+	solver.tangentMass1 = effectiveMass(a, b, contact.point, solver.tangent1);
+	solver.tangentMass2 = effectiveMass(a, b, contact.point, solver.tangent2);
+	solver.friction = b ? std::sqrt(a.friction * b->friction) : a.friction;
+	solver.normalImpulse = 0;
+	solver.tangentImpulse1 = 0;
+	solver.tangentImpulse2 = 0;
+
+	glm::vec3 relative = a.velocityAt(contact.point) - (b ? b->velocityAt(contact.point) : glm::vec3(0));
+	float approach = -glm::dot(relative, contact.normal);
+	float restitution = b ? std::max(a.restitution, b->restitution) : a.restitution;
+	solver.velocityBias = ContactModel::velocityBias(approach, restitution, contact.penetration, dt);
+	m_maxImpactSpeed = std::max(m_maxImpactSpeed, approach);
+
+	m_contacts.push_back(solver);
+}
+
+void PhysicsWorld::collideStatic(uint32_t bodyIndex, float dt) {
+	const RigidBody& body = m_bodies[bodyIndex];
+	glm::mat3 rotation = glm::mat3_cast(body.orientation);
+	glm::vec3 corners[8];
+	glm::vec3 lower(std::numeric_limits<float>::max());
+	glm::vec3 upper(-std::numeric_limits<float>::max());
+	for (int i = 0; i < 8; i++) {
+		corners[i] = body.position + rotation * (CORNER_SIGNS[i] * body.halfExtents);
+		lower = glm::min(lower, corners[i]);
+		upper = glm::max(upper, corners[i]);
+	}
+
+	m_candidates.clear();
+	m_staticGeometry.overlapping(lower - ContactModel::CONTACT_MARGIN, upper + ContactModel::CONTACT_MARGIN, m_candidates);
+	if (m_candidates.empty()) {
+		return;
+	}
+
+	const auto& triangles = m_staticGeometry.triangles();
+	for (int i = 0; i < 8; i++) {
+		// Keep only the deepest triangle per corner, so corners over a shared edge count once.
+		Contact deepest{ bodyIndex, STATIC_BODY, glm::vec3(0), glm::vec3(0), -1 };
+		for (uint32_t candidate : m_candidates) {
+			const TriangleBvh::Triangle& tri = triangles[candidate];
+			glm::vec3 normal = glm::cross(tri.edge1, tri.edge2);
+			float area = glm::length(normal);
+			if (area <= 0) {
+				continue;
+			}
+			normal /= area;
+			float distance = glm::dot(corners[i] - tri.v0, normal);
+			// Only touch surfaces from their front side: with the center behind the surface, the
+			// body has already passed through it.
+			if (distance > ContactModel::CONTACT_MARGIN || glm::dot(body.position - tri.v0, normal) <= 0) {
+				continue;
+			}
+			glm::vec3 onSurface = corners[i] - distance * normal;
+			if (-distance > deepest.penetration && insideTriangle(tri, onSurface)) {
+				deepest = Contact{ bodyIndex, STATIC_BODY, onSurface, normal, -distance };
+			}
+		}
+		if (deepest.penetration >= -ContactModel::CONTACT_MARGIN) {
+			addContact(deepest, dt);
+		}
+	}
+}
+
+void PhysicsWorld::collideBodies(uint32_t a, uint32_t b, float dt) {
+	// Corners of each box inside the other, pushed out through the nearest face.
+	for (int pass = 0; pass < 2; pass++) {
+		const RigidBody& inner = m_bodies[pass == 0 ? a : b];
+		const RigidBody& outer = m_bodies[pass == 0 ? b : a];
+		glm::mat3 innerRotation = glm::mat3_cast(inner.orientation);
+		glm::mat3 outerRotation = glm::mat3_cast(outer.orientation);
+		glm::mat3 toOuter = glm::transpose(outerRotation);
+		for (int i = 0; i < 8; i++) {
+			glm::vec3 corner = inner.position + innerRotation * (CORNER_SIGNS[i] * inner.halfExtents);
+			glm::vec3 local = toOuter * (corner - outer.position);
+			glm::vec3 depth = outer.halfExtents + ContactModel::CONTACT_MARGIN - glm::abs(local);
+			if (depth.x <= 0 || depth.y <= 0 || depth.z <= 0) {
+				continue;
+			}
+			int axis = depth.x < depth.y ? (depth.x < depth.z ? 0 : 2) : (depth.y < depth.z ? 1 : 2);
+			glm::vec3 normal = outerRotation[axis] * (local[axis] < 0 ? -1.0f : 1.0f);
+			float penetration = depth[axis] - ContactModel::CONTACT_MARGIN;
+			// The normal points out of the outer box, i.e. towards the inner one.
+			if (pass == 0) {
+				addContact(Contact{ a, b, corner, normal, penetration }, dt);
+			}
+			else {
+				addContact(Contact{ a, b, corner, -normal, penetration }, dt);
+			}
+		}
+	}
+}
+
+void PhysicsWorld::solveContact(SolverContact& solver) {
+	const Contact& contact = solver.contact;
+	RigidBody& a = m_bodies[contact.bodyA];
+	RigidBody* b = contact.bodyB == STATIC_BODY ? nullptr : &m_bodies[contact.bodyB];
+	auto relativeVelocity = [&]() {
+		return a.velocityAt(contact.point) - (b ? b->velocityAt(contact.point) : glm::vec3(0));
+	};
+	auto apply = [&](const glm::vec3& impulse) {
+		a.applyImpulse(impulse, contact.point);
+		if (b) {
+			b->applyImpulse(-impulse, contact.point);
+		}
+	};
+
+	// Friction first, bounded by the normal impulse of the previous iteration.
+	float limit = solver.friction * solver.normalImpulse;
+	glm::vec3 tangents[2] = { solver.tangent1, solver.tangent2 };
+	float masses[2] = { solver.tangentMass1, solver.tangentMass2 };
+	float* accumulated[2] = { &solver.tangentImpulse1, &solver.tangentImpulse2 };
+	for (int i = 0; i < 2; i++) {
+		float velocity = glm::dot(relativeVelocity(), tangents[i]);
+		apply(tangents[i] * ContactModel::frictionImpulse(*accumulated[i], velocity, masses[i], limit));
+	}
+
+	// Then non-penetration.
+	float velocity = glm::dot(relativeVelocity(), contact.normal);
+	float impulse = ContactModel::normalImpulse(solver.normalImpulse, velocity, solver.velocityBias, solver.normalMass);
+	apply(contact.normal * impulse);
+}
+
+uint32_t PhysicsWorld::findIsland(uint32_t body) {
+	while (m_islandParent[body] != body) {
+		// Path halving keeps the trees flat.
+		m_islandParent[body] = m_islandParent[m_islandParent[body]];
+		body = m_islandParent[body];
+	}
+	return body;
+}
+
+void PhysicsWorld::buildIslands() {
+	uint32_t bodyCount = static_cast<uint32_t>(m_bodies.size());
+	m_islandParent.resize(bodyCount);
+	for (uint32_t i = 0; i < bodyCount; i++) {
+		m_islandParent[i] = i;
+	}
+	for (auto& solver : m_contacts) {
+		if (solver.contact.bodyB != STATIC_BODY) {
+			m_islandParent[findIsland(solver.contact.bodyA)] = findIsland(solver.contact.bodyB);
+		}
+	}
+
+	// Number the islands, then bucket bodies and contacts by island with a counting sort.
+	std::vector<uint32_t> islandOf(bodyCount, UINT32_MAX);
+	m_islands.clear();
+	for (uint32_t i = 0; i < bodyCount; i++) {
+		if (!m_bodies[i].awake || m_bodies[i].inverseMass == 0) {
+			continue;
+		}
+		uint32_t root = findIsland(i);
+		if (islandOf[root] == UINT32_MAX) {
+			islandOf[root] = static_cast<uint32_t>(m_islands.size());
+			m_islands.push_back(Island{ 0, 0, 0, 0 });
+		}
+		islandOf[i] = islandOf[root];
+		m_islands[islandOf[i]].bodyCount++;
+	}
+	for (auto& solver : m_contacts) {
+		m_islands[islandOf[solver.contact.bodyA]].contactCount++;
+	}
+	uint32_t bodyOffset = 0;
+	uint32_t contactOffset = 0;
+	for (auto& island : m_islands) {
+		island.firstBody = bodyOffset;
+		island.firstContact = contactOffset;
+		bodyOffset += island.bodyCount;
+		contactOffset += island.contactCount;
+		// Counted up again as the buckets fill.
+		island.bodyCount = 0;
+		island.contactCount = 0;
+	}
+	m_islandBodies.resize(bodyOffset);
+	m_islandContacts.resize(contactOffset);
+	for (uint32_t i = 0; i < bodyCount; i++) {
+		if (islandOf[i] != UINT32_MAX) {
+			Island& island = m_islands[islandOf[i]];
+			m_islandBodies[island.firstBody + island.bodyCount++] = i;
+		}
+	}
+	for (uint32_t i = 0; i < m_contacts.size(); i++) {
+		Island& island = m_islands[islandOf[m_contacts[i].contact.bodyA]];
+		m_islandContacts[island.firstContact + island.contactCount++] = i;
+	}
+}
+
+float PhysicsWorld::timeOfImpact(const RigidBody& body, const glm::vec3& motion) const {
+	// Sweep the box's inscribed sphere: it can only touch a surface after the box does, so the
+	// body is never stopped early, and the regular contacts deal with the corners from there.
+	float radius = std::min(body.halfExtents.x, std::min(body.halfExtents.y, body.halfExtents.z));
+	glm::vec3 start = body.position;
+	glm::vec3 end = body.position + motion;
+	std::vector<uint32_t> candidates;
+	m_staticGeometry.overlapping(glm::min(start, end) - radius, glm::max(start, end) + radius, candidates);
+
+	float earliest = 1;
+	const auto& triangles = m_staticGeometry.triangles();
+	for (uint32_t candidate : candidates) {
+		const TriangleBvh::Triangle& tri = triangles[candidate];
+		glm::vec3 normal = glm::cross(tri.edge1, tri.edge2);
+		float area = glm::length(normal);
+		if (area <= 0) {
+			continue;
+		}
+		normal /= area;
+		float approach = -glm::dot(motion, normal);
+		float distance = glm::dot(start - tri.v0, normal);
+		// Surfaces the sphere already touches, or has been stopped against, are left to the
+		// regular contacts; sweeping against them again would hold the body still for good.
+		if (approach <= 0 || distance < radius + ContactModel::CONTACT_MARGIN) {
+			continue;
+		}
+		float t = (distance - radius) / approach;
+		if (t < earliest && insideTriangle(tri, start + motion * t - normal * radius)) {
+			earliest = t;
+		}
+	}
+
+	// The sphere can also meet a triangle's edge before any face; catch those through the center.
+	float length = glm::length(motion);
+	RayHit hit;
+	if (m_staticGeometry.intersect(Ray{ start, motion, 1 }, hit) && hit.t * length >= radius + ContactModel::CONTACT_MARGIN) {
+		earliest = std::min(earliest, hit.t - radius / length);
+	}
+	return earliest;
+}
+
+void PhysicsWorld::solveIsland(const Island& island, float dt) {
+	for (uint32_t iteration = 0; iteration < m_settings.solverIterations; iteration++) {
+		for (uint32_t i = 0; i < island.contactCount; i++) {
+			solveContact(m_contacts[m_islandContacts[island.firstContact + i]]);
+		}
+	}
+
+	// The island sleeps as a whole, once its restless body has been still for long enough.
+	float restingTime = std::numeric_limits<float>::max();
+	float sleepSpeedSquared = m_settings.sleepSpeed * m_settings.sleepSpeed;
+	for (uint32_t i = 0; i < island.bodyCount; i++) {
+		RigidBody& body = m_bodies[m_islandBodies[island.firstBody + i]];
+		float reach = glm::length(body.halfExtents);
+		float speedSquared = glm::dot(body.linearVelocity, body.linearVelocity)
+			+ glm::dot(body.angularVelocity, body.angularVelocity) * reach * reach;
+		body.restingTime = speedSquared < sleepSpeedSquared ? body.restingTime + dt : 0;
+		restingTime = std::min(restingTime, body.restingTime);
+	}
+	bool sleep = restingTime >= m_settings.timeToSleep;
+	for (uint32_t i = 0; i < island.bodyCount; i++) {
+		RigidBody& body = m_bodies[m_islandBodies[island.firstBody + i]];
+		if (sleep) {
+			body.awake = false;
+			body.linearVelocity = glm::vec3(0);
+			body.angularVelocity = glm::vec3(0);
+		}
+		else if (body.continuous && glm::length(body.linearVelocity) * dt > std::min(body.halfExtents.x,
+			std::min(body.halfExtents.y, body.halfExtents.z))) {
+			// Stop at the surface; next step's contacts bounce the body off it.
+			float t = timeOfImpact(body, body.linearVelocity * dt);
+			if (t < 1) {
+				m_sweptHits++;
+			}
+			body.integrate(dt * t);
+		}
+		else {
+			body.integrate(dt);
+		}
+	}
+}
+
+void PhysicsWorld::step(float dt) {
+	// Anything awake that comes near a sleeping body wakes it. Its resting time carries on, so
+	// neighbours that settle at different times don't keep waking each other.
+	for (uint32_t i = 0; i < m_bodies.size(); i++) {
+		if (m_bodies[i].awake) {
+			m_broadphase.update(i, bodyBounds(m_bodies[i]));
+		}
+	}
+	for (auto& pair : m_broadphase.findPairs()) {
+		RigidBody& first = m_bodies[pair.first];
+		RigidBody& second = m_bodies[pair.second];
+		if (first.awake != second.awake && first.inverseMass > 0 && second.inverseMass > 0) {
+			first.awake = true;
+			second.awake = true;
+		}
+	}
+
+	float linearKeep = std::max(0.0f, 1 - m_settings.linearDamping * dt);
+	float angularKeep = std::max(0.0f, 1 - m_settings.angularDamping * dt);
+	for (auto& body : m_bodies) {
+		if (body.awake && body.inverseMass > 0) {
+			body.linearVelocity = (body.linearVelocity + m_settings.gravity * dt) * linearKeep;
+			body.angularVelocity *= angularKeep;
+		}
+	}
+
+	m_contacts.clear();
+	m_maxImpactSpeed = 0;
+	m_sweptHits = 0;
+	for (uint32_t i = 0; i < m_bodies.size(); i++) {
+		if (m_bodies[i].awake) {
+			collideStatic(i, dt);
+		}
+	}
+	for (auto& pair : m_broadphase.pairs()) {
+		// Static bodies are never awake, but awake bodies still collide with them.
+		const RigidBody& first = m_bodies[pair.first];
+		const RigidBody& second = m_bodies[pair.second];
+		if ((first.awake && (second.awake || second.inverseMass == 0))
+			|| (second.awake && first.inverseMass == 0)) {
+			collideBodies(pair.first, pair.second, dt);
+		}
+	}
+
+	// Islands share no bodies, so they can be solved at the same time.
+	buildIslands();
+	uint32_t islandCount = static_cast<uint32_t>(m_islands.size());
+	if (m_pool && islandCount > 1) {
+		uint32_t grainSize = std::max(1u, islandCount / (4 * std::max(m_pool->threadCount(), 1u)));
+		m_pool->parallelFor(islandCount, grainSize, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				solveIsland(m_islands[i], dt);
+			}
+		});
+	}
+	else {
+		for (auto& island : m_islands) {
+			solveIsland(island, dt);
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#include "RigidBody.h"
+
+RigidBody RigidBody::box(const glm::vec3& halfExtents, float mass, const glm::vec3& position,
+	const glm::quat& orientation) {
+	// I = m/12 * (b^2 + c^2) for a box with full extents a, b, c.
+	glm::vec3 size = halfExtents * 2.0f;
+	glm::vec3 squared = size * size;
+	glm::vec3 inertia = mass / 12.0f * glm::vec3(squared.y + squared.z, squared.x + squared.z, squared.x + squared.y);
+	// Without mass the box is static: no impulse can move or turn it.
+	float inverseMass = mass > 0 ? 1.0f / mass : 0.0f;
+	glm::vec3 inverseInertia = mass > 0 ? 1.0f / inertia : glm::vec3(0);
+	return RigidBody{ position, orientation, glm::vec3(0), glm::vec3(0), halfExtents, inverseMass,
+		inverseInertia, 0.5f, 0.4f };
+}
+
+glm::mat3 RigidBody::inverseInertiaWorld() const {
+	glm::mat3 rotation = glm::mat3_cast(orientation);
+	glm::mat3 scaled = rotation;
+	for (int axis = 0; axis < 3; axis++) {
+		scaled[axis] *= inverseInertia[axis];
+	}
+	return scaled * glm::transpose(rotation);
+}
+
+glm::vec3 RigidBody::velocityAt(const glm::vec3& point) const {
+	return linearVelocity + glm::cross(angularVelocity, point - position);
+}
+
+void RigidBody::applyImpulse(const glm::vec3& impulse, const glm::vec3& point) {
+	linearVelocity += impulse * inverseMass;
+	angularVelocity += inverseInertiaWorld() * glm::cross(point - position, impulse);
+}
+
+void RigidBody::integrate(float dt) {
+	position += linearVelocity * dt;
+	// dq/dt = 1/2 w q, renormalized so rounding never shears the body.
+	glm::quat spin(0, angularVelocity.x, angularVelocity.y, angularVelocity.z);
+	orientation = glm::normalize(orientation + (spin * orientation) * (0.5f * dt));
+}
@@ -95,6 +95,15 @@ void ShaderProgram::activate()
     glUseProgram(m_programId);
 }
 
+void ShaderProgram::bindUniformBlock(const std::string& blockName, uint32_t binding)
+{
+    uint32_t index = glGetUniformBlockIndex(m_programId, blockName.c_str());
+    if (index != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(m_programId, index, binding);
+    }
+}
+
 void ShaderProgram::setUniform(const std::string& uniformName, bool value)
 {
     glUniform1i(glGetUniformLocation(m_programId, uniformName.c_str()), (int32_t)value);
@@ -107,7 +116,7 @@ void ShaderProgram::setUniform(const std::string& uniformName, int32_t value)
 
 void ShaderProgram::setUniform(const std::string& uniformName, float value)
 {
-    glUniform1f(glGetUniformLocation(m_programId, uniformName.c_str()), (int)value);
+    glUniform1f(glGetUniformLocation(m_programId, uniformName.c_str()), value);
 }
 
 void ShaderProgram::setUniform(const std::string& uniformName, const glm::vec2& value)
@@ -0,0 +1,154 @@
+#include "ShadowAtlas.h"
+#include <glad/glad.h>
+#include <stdexcept>
+
+/**
+ * @brief Creates a depth texture suitable for hardware shadow comparisons, attached to a new
+ * depth-only framebuffer.
+ */
+static void createDepthTarget(uint32_t size, uint32_t& texture, uint32_t& framebuffer) {
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT,
+		GL_UNSIGNED_INT, nullptr);
+	// Linear filtering on a comparison sampler gives a free 2x2 PCF per tap.
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		throw std::runtime_error("Shadow atlas framebuffer is incomplete");
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+ShadowAtlas::ShadowAtlas(uint32_t size, uint32_t tilesPerSide)
+	: m_size(size), m_tilesPerSide(tilesPerSide), m_staticDirty(true) {
+	createDepthTarget(size, m_staticTexture, m_staticFramebuffer);
+	createDepthTarget(size, m_texture, m_framebuffer);
+}
+
+ShadowAtlas::~ShadowAtlas() {
+	glDeleteFramebuffers(1, &m_staticFramebuffer);
+	glDeleteFramebuffers(1, &m_framebuffer);
+	glDeleteTextures(1, &m_staticTexture);
+	glDeleteTextures(1, &m_texture);
+}
+
+void ShadowAtlas::setLight(uint32_t index, const Light& light) {
+	if (index >= m_tilesPerSide * m_tilesPerSide) {
+		throw std::out_of_range("Shadow atlas has no tile for light " + std::to_string(index));
+	}
+	if (index >= m_lights.size()) {
+		m_lights.resize(index + 1, Light{ glm::mat4(1), glm::mat4(1) });
+		m_staticDirty = true;
+	}
+	if (m_lights[index].view != light.view || m_lights[index].projection != light.projection) {
+		m_lights[index] = light;
+		m_staticDirty = true;
+	}
+}
+
+void ShadowAtlas::setDirectionalLight(uint32_t index, const glm::vec3& direction,
+	const glm::vec3& sceneCenter, float sceneRadius) {
+	glm::vec3 dir = glm::normalize(direction);
+	// lookAt degenerates when the light points straight along the up vector.
+	glm::vec3 up = std::abs(dir.y) > 0.99f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+	glm::vec3 eye = sceneCenter - dir * (2 * sceneRadius);
+	setLight(index, Light{
+		glm::lookAt(eye, sceneCenter, up),
+		glm::ortho(-sceneRadius, sceneRadius, -sceneRadius, sceneRadius, sceneRadius, 3 * sceneRadius)
+	});
+}
+
+void ShadowAtlas::setSpotLight(uint32_t index, const glm::vec3& position, const glm::vec3& direction,
+	float outerAngle, float range) {
+	glm::vec3 dir = glm::normalize(direction);
+	glm::vec3 up = std::abs(dir.y) > 0.99f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+	setLight(index, Light{
+		glm::lookAt(position, position + dir, up),
+		glm::perspective(2 * outerAngle, 1.0f, 0.05f, range)
+	});
+}
+
+void ShadowAtlas::invalidateStatic() {
+	m_staticDirty = true;
+}
+
+void ShadowAtlas::setTileViewport(uint32_t index) const {
+	uint32_t tileSize = m_size / m_tilesPerSide;
+	glViewport((index % m_tilesPerSide) * tileSize, (index / m_tilesPerSide) * tileSize, tileSize, tileSize);
+}
+
+void ShadowAtlas::renderCasters(ShaderProgram& depthShader, const std::vector<Object3D>& objects,
+	bool staticObjects) const {
+	for (uint32_t i = 0; i < m_lights.size(); i++) {
+		setTileViewport(i);
+		depthShader.setUniform("view", m_lights[i].view);
+		depthShader.setUniform("projection", m_lights[i].projection);
+		for (auto& o : objects) {
+			if (o.isStatic() == staticObjects) {
+				o.renderDepth(depthShader);
+			}
+		}
+	}
+}
+
+void ShadowAtlas::render(ShaderProgram& depthShader, const std::vector<Object3D>& objects) {
+	int32_t previousFramebuffer;
+	int32_t previousViewport[4];
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+	depthShader.activate();
+	// Slope-scaled bias keeps lit surfaces from shadowing themselves.
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.0f, 4.0f);
+
+	// Static casters: only when something they depend on has changed.
+	if (m_staticDirty) {
+		glBindFramebuffer(GL_FRAMEBUFFER, m_staticFramebuffer);
+		glViewport(0, 0, m_size, m_size);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		renderCasters(depthShader, objects, true);
+		m_staticDirty = false;
+	}
+
+	// Start this frame's atlas from the cached static depth, then add what moves.
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_staticFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+	glBlitFramebuffer(0, 0, m_size, m_size, 0, 0, m_size, m_size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	renderCasters(depthShader, objects, false);
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+}
+
+glm::mat4 ShadowAtlas::lightSpaceMatrix(uint32_t index) const {
+	glm::vec4 bounds = tileBounds(index);
+	float tileScale = bounds.z - bounds.x;
+	// Clip space [-1, 1] -> [0, 1], then into the light's tile of the atlas.
+	glm::mat4 toTile = glm::translate(glm::mat4(1), glm::vec3(bounds.x, bounds.y, 0));
+	toTile = glm::scale(toTile, glm::vec3(tileScale, tileScale, 1));
+	toTile = glm::translate(toTile, glm::vec3(0.5f));
+	toTile = glm::scale(toTile, glm::vec3(0.5f));
+	return toTile * m_lights[index].projection * m_lights[index].view;
+}
+
+glm::vec4 ShadowAtlas::tileBounds(uint32_t index) const {
+	float tileScale = 1.0f / m_tilesPerSide;
+	float u = (index % m_tilesPerSide) * tileScale;
+	float v = (index / m_tilesPerSide) * tileScale;
+	return glm::vec4(u, v, u + tileScale, v + tileScale);
+}
@@ -0,0 +1,107 @@
+#include "Skeleton.h"
+#include <algorithm>
+
+Skeleton::Skeleton(const Object3D& root) {
+	addJoints(root, -1);
+	m_world = m_local;
+	evaluate();
+}
+
+void Skeleton::addJoints(const Object3D& object, int32_t parent) {
+	int32_t joint = static_cast<int32_t>(m_names.size());
+	m_names.push_back(object.getName());
+	m_parents.push_back(parent);
+	m_local.push_back(parent < 0 ? glm::mat4(1) : object.getModelMatrix());
+	for (size_t i = 0; i < object.numberOfChildren(); i++) {
+		addJoints(object.getChild(i), joint);
+	}
+}
+
+int32_t Skeleton::find(const std::string& name) const {
+	auto found = std::find(m_names.begin(), m_names.end(), name);
+	return found == m_names.end() ? -1 : static_cast<int32_t>(found - m_names.begin());
+}
+
+uint32_t Skeleton::animate(uint32_t joint) {
+	auto existing = std::find(m_animatedJoints.begin(), m_animatedJoints.end(), joint);
+	if (existing != m_animatedJoints.end()) {
+		return static_cast<uint32_t>(existing - m_animatedJoints.begin());
+	}
+	m_animatedJoints.push_back(joint);
+	m_translationX.push_back(0);
+	m_translationY.push_back(0);
+	m_translationZ.push_back(0);
+	m_rotationW.push_back(1);
+	m_rotationX.push_back(0);
+	m_rotationY.push_back(0);
+	m_rotationZ.push_back(0);
+	m_scaleX.push_back(1);
+	m_scaleY.push_back(1);
+	m_scaleZ.push_back(1);
+	for (auto& element : m_matrices) {
+		element.push_back(0);
+	}
+	return static_cast<uint32_t>(m_animatedJoints.size() - 1);
+}
+
+void Skeleton::setPose(uint32_t animatedJoint, const glm::vec3& translation, const glm::quat& rotation,
+	const glm::vec3& scale) {
+	m_translationX[animatedJoint] = translation.x;
+	m_translationY[animatedJoint] = translation.y;
+	m_translationZ[animatedJoint] = translation.z;
+	m_rotationW[animatedJoint] = rotation.w;
+	m_rotationX[animatedJoint] = rotation.x;
+	m_rotationY[animatedJoint] = rotation.y;
+	m_rotationZ[animatedJoint] = rotation.z;
+	m_scaleX[animatedJoint] = scale.x;
+	m_scaleY[animatedJoint] = scale.y;
+	m_scaleZ[animatedJoint] = scale.z;
+}
+
+void Skeleton::evaluate() {
+	// Translation * rotation * scale, for every animated joint at once.
+	size_t count = m_animatedJoints.size();
+	const float* tx = m_translationX.data();
+	const float* ty = m_translationY.data();
+	const float* tz = m_translationZ.data();
+	const float* qw = m_rotationW.data();
+	const float* qx = m_rotationX.data();
+	const float* qy = m_rotationY.data();
+	const float* qz = m_rotationZ.data();
+	const float* sx = m_scaleX.data();
+	const float* sy = m_scaleY.data();
+	const float* sz = m_scaleZ.data();
+	float* m[12];
+	for (int e = 0; e < 12; e++) {
+		m[e] = m_matrices[e].data();
+	}
+	for (size_t i = 0; i < count; i++) {
+		float xx = qx[i] * qx[i], yy = qy[i] * qy[i], zz = qz[i] * qz[i];
+		float xy = qx[i] * qy[i], xz = qx[i] * qz[i], yz = qy[i] * qz[i];
+		float wx = qw[i] * qx[i], wy = qw[i] * qy[i], wz = qw[i] * qz[i];
+		m[0][i] = (1 - 2 * (yy + zz)) * sx[i];
+		m[1][i] = 2 * (xy + wz) * sx[i];
+		m[2][i] = 2 * (xz - wy) * sx[i];
+		m[3][i] = 2 * (xy - wz) * sy[i];
+		m[4][i] = (1 - 2 * (xx + zz)) * sy[i];
+		m[5][i] = 2 * (yz + wx) * sy[i];
+		m[6][i] = 2 * (xz + wy) * sz[i];
+		m[7][i] = 2 * (yz - wx) * sz[i];
+		m[8][i] = (1 - 2 * (xx + yy)) * sz[i];
+		m[9][i] = tx[i];
+		m[10][i] = ty[i];
+		m[11][i] = tz[i];
+	}
+	for (size_t i = 0; i < count; i++) {
+		glm::mat4& local = m_local[m_animatedJoints[i]];
+		for (int column = 0; column < 4; column++) {
+			local[column] = glm::vec4(m[column * 3][i], m[column * 3 + 1][i], m[column * 3 + 2][i], column == 3 ? 1.0f : 0.0f);
+		}
+	}
+
+	// Parents come first, so one pass in order sees each parent's transform before its children.
+	for (size_t joint = 0; joint < m_local.size(); joint++) {
+		int32_t parent = m_parents[joint];
+		m_world[joint] = parent < 0 ? m_local[joint] : m_world[parent] * m_local[joint];
+	}
+}
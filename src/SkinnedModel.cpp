@@ -0,0 +1,164 @@
+#include "SkinnedModel.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+
+SkinPaletteBuffer::SkinPaletteBuffer(uint32_t binding)
+	: m_binding(binding) {
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, MAX_SKIN_JOINTS * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+SkinPaletteBuffer::~SkinPaletteBuffer() {
+	glDeleteBuffers(1, &m_buffer);
+}
+
+void SkinPaletteBuffer::upload(const std::vector<glm::mat4>& palette) {
+	size_t count = std::min<size_t>(palette.size(), MAX_SKIN_JOINTS);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, count * sizeof(glm::mat4), palette.data());
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+std::vector<Vertex3D> skinVertices(const MeshGeometry& geometry, const std::vector<glm::mat4>& palette) {
+	std::vector<Vertex3D> skinned = geometry.vertices;
+	for (size_t i = 0; i < skinned.size(); i++) {
+		const VertexSkin& skin = geometry.skin[i];
+		glm::mat4 transform(0);
+		for (int k = 0; k < 4; k++) {
+			transform = transform + palette[skin.joints[k]] * (skin.weights[k] / 255.0f);
+		}
+		Vertex3D& vertex = skinned[i];
+		glm::vec3 position = glm::vec3(transform * glm::vec4(vertex.x, vertex.y, vertex.z, 1));
+		glm::vec3 normal = glm::mat3(transform) * glm::vec3(vertex.nx, vertex.ny, vertex.nz);
+		float length = glm::length(normal);
+		normal = length > 0 ? normal / length : normal;
+		vertex.x = position.x;
+		vertex.y = position.y;
+		vertex.z = position.z;
+		vertex.nx = normal.x;
+		vertex.ny = normal.y;
+		vertex.nz = normal.z;
+	}
+	return skinned;
+}
+
+SkeletonPoseCache::SkeletonPoseCache(const Skeleton& rest, float resolution)
+	: m_rest(rest), m_resolution(resolution), m_frame(0) {
+}
+
+void SkeletonPoseCache::beginFrame() {
+	m_frame++;
+	m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(),
+		[&](const std::unique_ptr<Entry>& entry) { return entry->frame + 1 < m_frame; }), m_entries.end());
+}
+
+const std::vector<glm::mat4>& SkeletonPoseCache::pose(const KeyframeClip& clip, float time) {
+	int64_t tick = std::llround(time / m_resolution);
+	Entry* reusable = nullptr;
+	for (auto& entry : m_entries) {
+		if (entry->clip != &clip) {
+			continue;
+		}
+		if (entry->tick == tick) {
+			entry->frame = m_frame;
+			return entry->skeleton.world();
+		}
+		if (entry->frame != m_frame && reusable == nullptr) {
+			reusable = entry.get();
+		}
+	}
+
+	if (reusable == nullptr) {
+		m_entries.push_back(std::make_unique<Entry>(Entry{ &clip, tick, m_frame, m_rest, nullptr }));
+		reusable = m_entries.back().get();
+		reusable->sampler = std::make_unique<KeyframeSampler>(clip, reusable->skeleton);
+	}
+	float sampleTime = tick * m_resolution;
+	KeyframeSampler& sampler = *reusable->sampler;
+	if (sampleTime >= sampler.time()) {
+		sampler.advance(sampleTime - sampler.time());
+	}
+	else {
+		sampler.seek(sampleTime);
+	}
+	reusable->skeleton.evaluate();
+	reusable->tick = tick;
+	reusable->frame = m_frame;
+	return reusable->skeleton.world();
+}
+
+SkinnedModel::SkinnedModel(Object3D& model)
+	: m_model(&model), m_skeleton(model) {
+	int32_t joint = 0;
+	findMeshes(model, joint);
+	pose(m_skeleton.world());
+}
+
+void SkinnedModel::findMeshes(Object3D& object, int32_t& joint) {
+	// The same depth-first order the skeleton numbers its joints in.
+	int32_t node = joint++;
+	for (size_t i = 0; i < object.numberOfMeshes(); i++) {
+		Mesh3D& mesh = object.getMesh(i);
+		if (!mesh.isSkinned()) {
+			continue;
+		}
+		SkinnedMesh skinned{ &mesh, node, {}, {} };
+		for (auto& name : mesh.geometry().jointNames) {
+			skinned.joints.push_back(m_skeleton.find(name));
+		}
+		skinned.palette.resize(skinned.joints.size(), glm::mat4(1));
+		m_meshes.push_back(std::move(skinned));
+	}
+	for (size_t i = 0; i < object.numberOfChildren(); i++) {
+		findMeshes(object.getChild(i), joint);
+	}
+}
+
+void SkinnedModel::pose(const std::vector<glm::mat4>& jointTransforms) {
+	for (auto& skinned : m_meshes) {
+		glm::mat4 toMesh = glm::inverse(jointTransforms[skinned.node]);
+		const auto& inverseBindMatrices = skinned.mesh->geometry().inverseBindMatrices;
+		for (size_t j = 0; j < skinned.joints.size(); j++) {
+			// Joints missing from the model leave their vertices in the bind pose.
+			skinned.palette[j] = skinned.joints[j] < 0 ? glm::mat4(1)
+				: toMesh * jointTransforms[skinned.joints[j]] * inverseBindMatrices[j];
+		}
+	}
+}
+
+void SkinnedModel::skinOnCpu() {
+	for (auto& skinned : m_meshes) {
+		skinned.mesh->setPosedVertices(skinVertices(skinned.mesh->geometry(), skinned.palette));
+	}
+}
+
+void SkinnedModel::renderMeshes(ShaderProgram& program, SkinPaletteBuffer& palettes, bool depthOnly) const {
+	program.bindUniformBlock("Skin", palettes.binding());
+	m_model->visitMeshes([&](Mesh3D& mesh, const glm::mat4& model) {
+		auto skinned = std::find_if(m_meshes.begin(), m_meshes.end(),
+			[&](const SkinnedMesh& candidate) { return candidate.mesh == &mesh; });
+		if (skinned == m_meshes.end()) {
+			return;
+		}
+		program.setUniform("model", model);
+		palettes.upload(skinned->palette);
+		if (depthOnly) {
+			mesh.renderDepth();
+		}
+		else {
+			mesh.render(program);
+		}
+	});
+}
+
+void SkinnedModel::render(ShaderProgram& program, SkinPaletteBuffer& palettes) const {
+	renderMeshes(program, palettes, false);
+}
+
+void SkinnedModel::renderDepth(ShaderProgram& program, SkinPaletteBuffer& palettes) const {
+	renderMeshes(program, palettes, true);
+}
@@ -0,0 +1,165 @@
+#include "SplinePath.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+	// Handle length, as a fraction of the radius, for a quarter circle as one cubic Bezier.
+	const float CIRCLE_HANDLE = 0.5522847f;
+
+	glm::vec3 bezierPoint(const glm::vec3* p, float t) {
+		float s = 1 - t;
+		return s * s * s * p[0] + 3 * s * s * t * p[1] + 3 * s * t * t * p[2] + t * t * t * p[3];
+	}
+
+	glm::vec3 bezierDerivative(const glm::vec3* p, float t) {
+		float s = 1 - t;
+		return 3 * s * s * (p[1] - p[0]) + 6 * s * t * (p[2] - p[1]) + 3 * t * t * (p[3] - p[2]);
+	}
+}
+
+SplinePath::SplinePath(std::vector<glm::vec3> controlPoints)
+	: m_points(std::move(controlPoints)) {
+	if (m_points.size() < 4 || (m_points.size() - 1) % 3 != 0) {
+		throw std::runtime_error("A spline path needs a start point and three more points per segment, not "
+			+ std::to_string(m_points.size()) + " points");
+	}
+	m_distances.push_back(0);
+	for (uint32_t segment = 0; segment < segmentCount(); segment++) {
+		glm::vec3 previous = m_points[segment * 3];
+		for (uint32_t i = 1; i <= SAMPLES_PER_SEGMENT; i++) {
+			glm::vec3 point = bezierPoint(segmentPoints(segment), static_cast<float>(i) / SAMPLES_PER_SEGMENT);
+			m_distances.push_back(m_distances.back() + glm::length(point - previous));
+			previous = point;
+		}
+	}
+}
+
+SplinePath SplinePath::circle(const glm::vec3& center, float radius) {
+	float handle = CIRCLE_HANDLE * radius;
+	auto at = [&](float x, float z) { return center + glm::vec3(x, 0, z); };
+	return SplinePath({
+		at(0, radius),
+		at(handle, radius), at(radius, handle), at(radius, 0),
+		at(radius, -handle), at(handle, -radius), at(0, -radius),
+		at(-handle, -radius), at(-radius, -handle), at(-radius, 0),
+		at(-radius, handle), at(-handle, radius), at(0, radius),
+	});
+}
+
+void SplinePath::locate(float distance, uint32_t& segment, float& parameter) const {
+	distance = std::clamp(distance, 0.0f, length());
+	// The sample interval the distance falls in, then how far through it.
+	auto after = std::upper_bound(m_distances.begin() + 1, m_distances.end() - 1, distance);
+	size_t sample = after - m_distances.begin() - 1;
+	float span = m_distances[sample + 1] - m_distances[sample];
+	float fraction = span > 0 ? (distance - m_distances[sample]) / span : 0.0f;
+	segment = static_cast<uint32_t>(sample / SAMPLES_PER_SEGMENT);
+	parameter = (sample % SAMPLES_PER_SEGMENT + fraction) / SAMPLES_PER_SEGMENT;
+}
+
+glm::vec3 SplinePath::pointAt(float distance) const {
+	uint32_t segment;
+	float parameter;
+	locate(distance, segment, parameter);
+	return bezierPoint(segmentPoints(segment), parameter);
+}
+
+glm::vec3 SplinePath::directionAt(float distance) const {
+	uint32_t segment;
+	float parameter;
+	locate(distance, segment, parameter);
+	glm::vec3 derivative = bezierDerivative(segmentPoints(segment), parameter);
+	float speed = glm::length(derivative);
+	return speed > 0 ? derivative / speed : glm::vec3(0, 0, 1);
+}
+
+uint32_t PathFollowers::addPath(SplinePath path) {
+	m_paths.push_back(std::move(path));
+	return static_cast<uint32_t>(m_paths.size() - 1);
+}
+
+uint32_t PathFollowers::add(uint32_t path, float duration, Easing easing) {
+	m_path.push_back(path);
+	m_inverseDuration.push_back(duration > 0 ? 1 / duration : 0.0f);
+	// Easings as cubics: t, 3t^2 - 2t^3 and so on.
+	switch (easing) {
+	case Easing::Linear:
+		m_ease1.push_back(1); m_ease2.push_back(0); m_ease3.push_back(0);
+		break;
+	case Easing::EaseIn:
+		m_ease1.push_back(0); m_ease2.push_back(1); m_ease3.push_back(0);
+		break;
+	case Easing::EaseOut:
+		m_ease1.push_back(2); m_ease2.push_back(-1); m_ease3.push_back(0);
+		break;
+	case Easing::EaseInOut:
+		m_ease1.push_back(0); m_ease2.push_back(3); m_ease3.push_back(-2);
+		break;
+	}
+	m_time.push_back(0);
+	m_distance.push_back(0);
+	for (auto* column : { &m_p0X, &m_p0Y, &m_p0Z, &m_p1X, &m_p1Y, &m_p1Z, &m_p2X, &m_p2Y, &m_p2Z,
+		&m_p3X, &m_p3Y, &m_p3Z, &m_parameter, &m_pointX, &m_pointY, &m_pointZ }) {
+		column->push_back(0);
+	}
+	return static_cast<uint32_t>(m_path.size() - 1);
+}
+
+void PathFollowers::advance(float dt) {
+	for (auto& time : m_time) {
+		time += dt;
+	}
+	evaluate();
+}
+
+void PathFollowers::evaluate() {
+	size_t count = m_path.size();
+	// How far along its path each follower is, eased.
+	for (size_t i = 0; i < count; i++) {
+		float t = std::clamp(m_time[i] * m_inverseDuration[i], 0.0f, 1.0f);
+		m_distance[i] = t * (m_ease1[i] + t * (m_ease2[i] + t * m_ease3[i]));
+	}
+
+	// Which segment that is on, looked up in each path's distance table.
+	for (size_t i = 0; i < count; i++) {
+		const SplinePath& path = m_paths[m_path[i]];
+		uint32_t segment;
+		path.locate(m_distance[i] * path.length(), segment, m_parameter[i]);
+		const glm::vec3* p = path.segmentPoints(segment);
+		m_p0X[i] = p[0].x; m_p0Y[i] = p[0].y; m_p0Z[i] = p[0].z;
+		m_p1X[i] = p[1].x; m_p1Y[i] = p[1].y; m_p1Z[i] = p[1].z;
+		m_p2X[i] = p[2].x; m_p2Y[i] = p[2].y; m_p2Z[i] = p[2].z;
+		m_p3X[i] = p[3].x; m_p3Y[i] = p[3].y; m_p3Z[i] = p[3].z;
+	}
+
+	// And where on the segment, for every follower at once.
+	for (size_t i = 0; i < count; i++) {
+		float t = m_parameter[i];
+		float s = 1 - t;
+		// Bernstein weights of the four control points.
+		float w0 = s * s * s;
+		float w1 = 3 * s * s * t;
+		float w2 = 3 * s * t * t;
+		float w3 = t * t * t;
+		m_pointX[i] = w0 * m_p0X[i] + w1 * m_p1X[i] + w2 * m_p2X[i] + w3 * m_p3X[i];
+		m_pointY[i] = w0 * m_p0Y[i] + w1 * m_p1Y[i] + w2 * m_p2Y[i] + w3 * m_p3Y[i];
+		m_pointZ[i] = w0 * m_p0Z[i] + w1 * m_p1Z[i] + w2 * m_p2Z[i] + w3 * m_p3Z[i];
+	}
+}
+
+void PathFollowers::evaluate(const std::vector<uint32_t>& followers) {
+	for (uint32_t i : followers) {
+		float t = std::clamp(m_time[i] * m_inverseDuration[i], 0.0f, 1.0f);
+		m_distance[i] = t * (m_ease1[i] + t * (m_ease2[i] + t * m_ease3[i]));
+		const SplinePath& path = m_paths[m_path[i]];
+		uint32_t segment;
+		path.locate(m_distance[i] * path.length(), segment, m_parameter[i]);
+		const glm::vec3* p = path.segmentPoints(segment);
+		float u = m_parameter[i];
+		float s = 1 - u;
+		glm::vec3 point = s * s * s * p[0] + 3 * s * s * u * p[1] + 3 * s * u * u * p[2] + u * u * u * p[3];
+		m_pointX[i] = point.x;
+		m_pointY[i] = point.y;
+		m_pointZ[i] = point.z;
+	}
+}
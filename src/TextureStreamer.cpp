@@ -0,0 +1,322 @@
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+	const uint32_t MIP_CACHE_MAGIC = 0x5350494d; // "MIPS"
+	// Levels this size and smaller stay resident, so every texture can always be sampled.
+	const uint32_t TAIL_SIZE = 64;
+	// Caps the texture data uploaded per frame, so streaming never causes a hitch.
+	const uint64_t MAX_UPLOAD_BYTES_PER_FRAME = 8 * 1024 * 1024;
+
+	struct MipCacheHeader {
+		uint32_t magic;
+		uint32_t width;
+		uint32_t height;
+		uint32_t levelCount;
+	};
+
+	/**
+	 * @brief Halves an RGBA8 image with a box filter, matching OpenGL's level sizes.
+	 */
+	std::vector<uint8_t> downsample(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height) {
+		uint32_t halfWidth = std::max(width / 2, 1u), halfHeight = std::max(height / 2, 1u);
+		std::vector<uint8_t> result(static_cast<size_t>(halfWidth) * halfHeight * 4);
+		for (uint32_t y = 0; y < halfHeight; y++) {
+			uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+			for (uint32_t x = 0; x < halfWidth; x++) {
+				uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+				for (uint32_t c = 0; c < 4; c++) {
+					uint32_t sum = pixels[(static_cast<size_t>(y0) * width + x0) * 4 + c]
+						+ pixels[(static_cast<size_t>(y0) * width + x1) * 4 + c]
+						+ pixels[(static_cast<size_t>(y1) * width + x0) * 4 + c]
+						+ pixels[(static_cast<size_t>(y1) * width + x1) * 4 + c];
+					result[(static_cast<size_t>(y) * halfWidth + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+				}
+			}
+		}
+		return result;
+	}
+
+	/**
+	 * @brief Decodes an image and writes its full mip chain: a header, then every level's pixels,
+	 * finest first.
+	 */
+	void buildMipCache(const std::filesystem::path& imagePath, const std::filesystem::path& cachePath) {
+		std::cout << "building mip cache for " << imagePath << std::endl;
+		StbImage image;
+		image.loadFromFile(imagePath.string());
+		uint32_t width = image.getWidth(), height = image.getHeight();
+		std::vector<uint8_t> level(image.getData(), image.getData() + static_cast<size_t>(width) * height * 4);
+
+		uint32_t levelCount = 1 + static_cast<uint32_t>(std::floor(std::log2(std::max(width, height))));
+		std::ofstream out(cachePath, std::ios::binary);
+		MipCacheHeader header{ MIP_CACHE_MAGIC, width, height, levelCount };
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		for (uint32_t i = 0; i < levelCount; i++) {
+			out.write(reinterpret_cast<const char*>(level.data()), level.size());
+			if (i + 1 < levelCount) {
+				level = downsample(level, width, height);
+				width = std::max(width / 2, 1u);
+				height = std::max(height / 2, 1u);
+			}
+		}
+		if (!out) {
+			throw std::runtime_error("Could not write mip cache " + cachePath.string());
+		}
+	}
+
+	std::vector<uint8_t> readLevel(const std::filesystem::path& cachePath, uint64_t offset, uint64_t bytes) {
+		std::ifstream in(cachePath, std::ios::binary);
+		std::vector<uint8_t> pixels(bytes);
+		in.seekg(offset);
+		if (!in.read(reinterpret_cast<char*>(pixels.data()), bytes)) {
+			throw std::runtime_error("Could not read mip cache " + cachePath.string());
+		}
+		return pixels;
+	}
+}
+
+TextureStreamer::TextureStreamer(ThreadPool& pool, const std::filesystem::path& cacheDirectory, uint64_t budgetBytes)
+	: m_pool(pool), m_cacheDirectory(cacheDirectory), m_budgetBytes(budgetBytes), m_residentBytes(0),
+	m_streamedBytes(0), m_frame(0) {
+	std::filesystem::create_directories(cacheDirectory);
+}
+
+TextureStreamer::~TextureStreamer() {
+	for (auto& texture : m_textures) {
+		if (texture.pendingRead.valid()) {
+			texture.pendingRead.wait();
+		}
+	}
+}
+
+uint64_t TextureStreamer::levelBytes(const MipLevel& level) {
+	return static_cast<uint64_t>(level.width) * level.height * 4;
+}
+
+Texture TextureStreamer::load(const std::filesystem::path& imagePath, const std::string& samplerName) {
+	// The cache is keyed by the image's path, size and modification time, so edits rebuild it.
+	auto modified = std::filesystem::last_write_time(imagePath).time_since_epoch().count();
+	size_t key = std::hash<std::string>{}(std::filesystem::absolute(imagePath).string() + "|"
+		+ std::to_string(std::filesystem::file_size(imagePath)) + "|" + std::to_string(modified));
+	std::filesystem::path cachePath = m_cacheDirectory / (std::to_string(key) + ".mips");
+	if (!std::filesystem::exists(cachePath)) {
+		buildMipCache(imagePath, cachePath);
+	}
+
+	MipCacheHeader header;
+	std::ifstream in(cachePath, std::ios::binary);
+	if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != MIP_CACHE_MAGIC) {
+		throw std::runtime_error("Invalid mip cache " + cachePath.string());
+	}
+	in.close();
+
+	StreamedTexture texture;
+	texture.cachePath = cachePath;
+	uint64_t offset = sizeof(MipCacheHeader);
+	uint32_t width = header.width, height = header.height;
+	for (uint32_t i = 0; i < header.levelCount; i++) {
+		texture.levels.push_back(MipLevel{ width, height, offset });
+		offset += levelBytes(texture.levels.back());
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
+	texture.tailBase = 0;
+	while (texture.tailBase + 1 < texture.levels.size()
+		&& std::max(texture.levels[texture.tailBase].width, texture.levels[texture.tailBase].height) > TAIL_SIZE) {
+		texture.tailBase++;
+	}
+	texture.residentBase = static_cast<uint32_t>(texture.levels.size());
+	texture.wantedLevel = static_cast<uint32_t>(texture.levels.size());
+	texture.lastUsedFrame = 0;
+
+	glGenTextures(1, &texture.textureId);
+	glBindTexture(GL_TEXTURE_2D, texture.textureId);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<int32_t>(texture.levels.size() - 1));
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// Upload the tail, coarsest first, so the base level only ever moves towards finer levels.
+	const MipLevel& tailLevel = texture.levels[texture.tailBase];
+	std::vector<uint8_t> tail = readLevel(cachePath, tailLevel.offset, offset - tailLevel.offset);
+	for (uint32_t level = static_cast<uint32_t>(texture.levels.size()); level-- > texture.tailBase;) {
+		uploadLevel(texture, level, tail.data() + (texture.levels[level].offset - tailLevel.offset));
+	}
+	Texture result{ texture.textureId, samplerName };
+	m_byTextureId[texture.textureId] = static_cast<uint32_t>(m_textures.size());
+	m_textures.push_back(std::move(texture));
+	return result;
+}
+
+void TextureStreamer::uploadLevel(StreamedTexture& texture, uint32_t level, const uint8_t* pixels) {
+	const MipLevel& mip = texture.levels[level];
+	glBindTexture(GL_TEXTURE_2D, texture.textureId);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	texture.residentBase = level;
+	m_residentBytes += levelBytes(mip);
+	if (level < texture.tailBase) {
+		m_streamedBytes += levelBytes(mip);
+	}
+}
+
+void TextureStreamer::evictLevel(StreamedTexture& texture) {
+	uint32_t level = texture.residentBase;
+	glBindTexture(GL_TEXTURE_2D, texture.textureId);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+	// Redefining the level as empty releases its storage.
+	glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	texture.residentBase = level + 1;
+	m_residentBytes -= levelBytes(texture.levels[level]);
+	m_streamedBytes -= levelBytes(texture.levels[level]);
+}
+
+bool TextureStreamer::makeRoom(uint64_t bytes) {
+	while (m_streamedBytes + bytes > m_budgetBytes) {
+		// The least recently used texture holding finer levels than it currently wants.
+		StreamedTexture* victim = nullptr;
+		for (auto& texture : m_textures) {
+			bool neededNow = texture.lastUsedFrame == m_frame && texture.residentBase >= texture.wantedLevel;
+			// Textures with a read in flight are left alone, so the read still lands on the next level.
+			if (texture.residentBase >= texture.tailBase || neededNow || texture.pendingRead.valid()) {
+				continue;
+			}
+			if (!victim || texture.lastUsedFrame < victim->lastUsedFrame) {
+				victim = &texture;
+			}
+		}
+		if (!victim) {
+			return false;
+		}
+		evictLevel(*victim);
+	}
+	return true;
+}
+
+void TextureStreamer::request(uint32_t textureId, float texelsPerPixelAtLevel0) {
+	auto found = m_byTextureId.find(textureId);
+	if (found == m_byTextureId.end()) {
+		return;
+	}
+	StreamedTexture& texture = m_textures[found->second];
+	// Each level halves the texel density, so this is the finest level at ~1 texel per pixel.
+	uint32_t level = texelsPerPixelAtLevel0 > 1 ? static_cast<uint32_t>(std::log2(texelsPerPixelAtLevel0)) : 0;
+	level = std::min(level, texture.tailBase);
+	if (texture.lastUsedFrame != m_frame) {
+		texture.lastUsedFrame = m_frame;
+		texture.wantedLevel = level;
+	}
+	else {
+		texture.wantedLevel = std::min(texture.wantedLevel, level);
+	}
+}
+
+void TextureStreamer::requestVisible(std::vector<Object3D>& objects, const glm::mat4& view,
+	const glm::mat4& projection, uint32_t viewportHeight) {
+	m_frame++;
+	glm::mat4 viewProjection = projection * view;
+	// Frustum planes from the rows of the view-projection matrix (Gribb and Hartmann).
+	glm::vec4 rows[4];
+	for (int r = 0; r < 4; r++) {
+		rows[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+	}
+	glm::vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1],
+		rows[3] + rows[2], rows[3] - rows[2] };
+	// Pixels covered by one world unit at unit distance.
+	float pixelsPerUnit = projection[1][1] * viewportHeight / 2;
+
+	for (auto& object : objects) {
+		object.visitMeshes([&](Mesh3D& mesh, const glm::mat4& model) {
+			const MeshGeometry& geometry = mesh.geometry();
+			auto found = m_footprints.find(&geometry);
+			if (found == m_footprints.end()) {
+				MeshFootprint footprint{ glm::vec3(0), 0, 0 };
+				glm::vec3 low(std::numeric_limits<float>::max()), high(-std::numeric_limits<float>::max());
+				for (auto& v : geometry.vertices) {
+					low = glm::min(low, glm::vec3(v.x, v.y, v.z));
+					high = glm::max(high, glm::vec3(v.x, v.y, v.z));
+				}
+				footprint.center = (low + high) * 0.5f;
+				footprint.radius = glm::length(high - low) * 0.5f;
+				double area = 0, uvArea = 0;
+				for (size_t f = 0; f + 2 < geometry.faces.size(); f += 3) {
+					const Vertex3D& a = geometry.vertices[geometry.faces[f]];
+					const Vertex3D& b = geometry.vertices[geometry.faces[f + 1]];
+					const Vertex3D& c = geometry.vertices[geometry.faces[f + 2]];
+					area += 0.5 * glm::length(glm::cross(glm::vec3(b.x - a.x, b.y - a.y, b.z - a.z),
+						glm::vec3(c.x - a.x, c.y - a.y, c.z - a.z)));
+					uvArea += 0.5 * std::abs((b.u - a.u) * (c.v - a.v) - (c.u - a.u) * (b.v - a.v));
+				}
+				footprint.uvDensity = area > 0 ? static_cast<float>(std::sqrt(uvArea / area)) : 0;
+				found = m_footprints.emplace(&geometry, footprint).first;
+			}
+			const MeshFootprint& footprint = found->second;
+
+			float scale = std::max(glm::length(glm::vec3(model[0])),
+				std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+			glm::vec4 center = model * glm::vec4(footprint.center, 1);
+			float radius = footprint.radius * scale;
+			for (auto& plane : planes) {
+				if (glm::dot(plane, center) < -radius * glm::length(glm::vec3(plane))) {
+					return;
+				}
+			}
+
+			// The nearest point of the bounding sphere sets the finest detail needed.
+			float distance = std::max(glm::length(glm::vec3(view * center)) - radius, 0.05f);
+			float pixelsPerUv = pixelsPerUnit / distance * scale / std::max(footprint.uvDensity, 1e-6f);
+			for (auto& texture : mesh.textures()) {
+				auto streamed = m_byTextureId.find(texture.textureId);
+				if (streamed != m_byTextureId.end()) {
+					const MipLevel& finest = m_textures[streamed->second].levels[0];
+					request(texture.textureId, std::max(finest.width, finest.height) / pixelsPerUv);
+				}
+			}
+		});
+	}
+}
+
+void TextureStreamer::update() {
+	uint64_t uploaded = 0;
+	for (auto& texture : m_textures) {
+		// Upload finished reads, unless this frame's upload allowance is spent.
+		if (texture.pendingRead.valid() && uploaded < MAX_UPLOAD_BYTES_PER_FRAME
+			&& texture.pendingRead.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			texture.pendingRead.get();
+			uint32_t level = texture.residentBase - 1;
+			// Making room may evict this texture's own finest level, leaving the read stale.
+			if (makeRoom(levelBytes(texture.levels[level])) && texture.residentBase == level + 1) {
+				uploadLevel(texture, level, texture.pendingPixels->data());
+				uploaded += levelBytes(texture.levels[level]);
+			}
+			texture.pendingPixels.reset();
+		}
+
+		// Start reading the next finer level of textures that want more detail than they have.
+		bool wanted = texture.lastUsedFrame == m_frame && texture.wantedLevel < texture.residentBase;
+		if (wanted && !texture.pendingRead.valid()) {
+			const MipLevel& next = texture.levels[texture.residentBase - 1];
+			if (m_streamedBytes + levelBytes(next) <= m_budgetBytes || makeRoom(levelBytes(next))) {
+				auto pixels = std::make_shared<std::vector<uint8_t>>();
+				std::filesystem::path path = texture.cachePath;
+				uint64_t offset = next.offset, bytes = levelBytes(next);
+				texture.pendingPixels = pixels;
+				texture.pendingRead = m_pool.submit([pixels, path, offset, bytes]() {
+					*pixels = readLevel(path, offset, bytes);
+				});
+			}
+		}
+	}
+}
@@ -0,0 +1,100 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(uint32_t threadCount) : m_stopping(false) {
+	threadCount = std::max(threadCount, 1u);
+	for (uint32_t i = 0; i < threadCount; i++) {
+		m_workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_jobAvailable.notify_all();
+	for (auto& worker : m_workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::workerLoop() {
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobAvailable.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+			// Drain the queue before stopping, so no submitted future is left hanging.
+			if (m_jobs.empty()) {
+				return;
+			}
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+		job();
+	}
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> job) {
+	auto task = std::make_shared<std::packaged_task<void()>>(std::move(job));
+	std::future<void> result = task->get_future();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.emplace_back([task] { (*task)(); });
+	}
+	m_jobAvailable.notify_one();
+	return result;
+}
+
+void ThreadPool::parallelFor(uint32_t count, uint32_t grainSize,
+	const std::function<void(uint32_t begin, uint32_t end)>& body) {
+	if (count == 0) {
+		return;
+	}
+	grainSize = std::max(grainSize, 1u);
+	uint32_t chunkCount = (count + grainSize - 1) / grainSize;
+
+	// Shared so that helper jobs which only get picked up after we return still see valid state.
+	struct State {
+		std::atomic<uint32_t> nextChunk{ 0 };
+		std::atomic<uint32_t> finishedChunks{ 0 };
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+	auto state = std::make_shared<State>();
+	const auto* bodyPtr = &body;
+
+	auto runChunks = [state, bodyPtr, count, grainSize, chunkCount] {
+		while (true) {
+			uint32_t chunk = state->nextChunk.fetch_add(1);
+			if (chunk >= chunkCount) {
+				return;
+			}
+			uint32_t begin = chunk * grainSize;
+			(*bodyPtr)(begin, std::min(begin + grainSize, count));
+			if (state->finishedChunks.fetch_add(1) + 1 == chunkCount) {
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->done.notify_all();
+			}
+		}
+	};
+
+	uint32_t helpers = std::min(threadCount(), chunkCount - 1);
+	if (helpers > 0) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (uint32_t i = 0; i < helpers; i++) {
+				m_jobs.emplace_back(runChunks);
+			}
+		}
+		m_jobAvailable.notify_all();
+	}
+
+	// The calling thread works too, then waits for chunks other threads are still finishing.
+	runChunks();
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->done.wait(lock, [&state, chunkCount] { return state->finishedChunks.load() == chunkCount; });
+}
@@ -0,0 +1,339 @@
+#include "Timeline.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+namespace {
+	// Turns by half-angles up to this take sin and cos from their Taylor series, which is accurate
+	// to float precision there and much cheaper. A tick's turn is far smaller unless the playhead
+	// jumps.
+	const float MAX_SERIES_ANGLE = 0.5f;
+}
+
+uint32_t Timeline::RotationPool::add(uint32_t channelTarget, const glm::vec3& perSecond) {
+	float length = glm::length(perSecond);
+	glm::vec3 axis = length > 0 ? perSecond / length : glm::vec3(0);
+	target.push_back(channelTarget);
+	axisX.push_back(axis.x);
+	axisY.push_back(axis.y);
+	axisZ.push_back(axis.z);
+	rate.push_back(length);
+	return static_cast<uint32_t>(target.size() - 1);
+}
+
+uint32_t Timeline::TranslationPool::add(uint32_t channelTarget, const glm::vec3& perSecond) {
+	target.push_back(channelTarget);
+	perSecondX.push_back(perSecond.x);
+	perSecondY.push_back(perSecond.y);
+	perSecondZ.push_back(perSecond.z);
+	return static_cast<uint32_t>(target.size() - 1);
+}
+
+uint32_t Timeline::PathPool::add(uint32_t channelTarget, SplinePath path, float duration, Easing easing) {
+	target.push_back(channelTarget);
+	return followers.add(followers.addPath(std::move(path)), duration, easing);
+}
+
+uint32_t Timeline::ClipPool::add(Object3D& root, const ClipChannel& channel) {
+	sampler.emplace_back(channel.clip, root);
+	time.push_back(0);
+	return static_cast<uint32_t>(sampler.size() - 1);
+}
+
+uint32_t Timeline::targetOf(Object3D& object) {
+	auto existing = std::find(m_objects.begin(), m_objects.end(), &object);
+	if (existing != m_objects.end()) {
+		return static_cast<uint32_t>(existing - m_objects.begin());
+	}
+	m_objects.push_back(&object);
+	m_positions.emplace_back(0);
+	m_orientations.emplace_back(1, 0, 0, 0);
+	m_loaded.push_back(0);
+	return static_cast<uint32_t>(m_objects.size() - 1);
+}
+
+void Timeline::load(uint32_t target) {
+	if (!m_loaded[target]) {
+		m_loaded[target] = 1;
+		m_positions[target] = m_objects[target]->getPosition();
+		m_orientations[target] = m_objects[target]->getOrientation();
+		m_moved.push_back(target);
+	}
+}
+
+Timeline::Timeline()
+	: m_nextScheduled(0), m_time(0), m_duration(0), m_nextEvent(0) {
+}
+
+uint32_t Timeline::addTrack(float start) {
+	m_tracks.push_back(Track{ start, 0, 0, 0, 0 });
+	return static_cast<uint32_t>(m_tracks.size() - 1);
+}
+
+void Timeline::add(uint32_t track, Object3D& object, float duration, const AnimationChannel& channel) {
+	uint32_t target = targetOf(object);
+	float perSecond = duration > 0 ? 1 / duration : 0.0f;
+	float start = m_tracks[track].duration;
+	Segment segment = std::visit([&](const auto& c) {
+		using Channel = std::decay_t<decltype(c)>;
+		if constexpr (std::is_same_v<Channel, RotationChannel>) {
+			return Segment{ track, Kind::Rotation, m_rotations.add(target, c.totalRotation * perSecond), start, duration };
+		}
+		else if constexpr (std::is_same_v<Channel, TranslationChannel>) {
+			return Segment{ track, Kind::Translation, m_translations.add(target, c.totalOffset * perSecond), start, duration };
+		}
+		else if constexpr (std::is_same_v<Channel, BezierChannel>) {
+			SplinePath curve({ c.p0, c.p1, c.p2, c.p3 });
+			return Segment{ track, Kind::Path, m_paths.add(target, std::move(curve), duration, c.easing), start, duration };
+		}
+		else if constexpr (std::is_same_v<Channel, PathChannel>) {
+			return Segment{ track, Kind::Path, m_paths.add(target, c.path, duration, c.easing), start, duration };
+		}
+		else if constexpr (std::is_same_v<Channel, ClipChannel>) {
+			return Segment{ track, Kind::Clip, m_clips.add(object, c), start, duration };
+		}
+		else {
+			return Segment{ track, Kind::Pause, 0, start, duration };
+		}
+	}, channel);
+	m_segments.push_back(segment);
+	m_tracks[track].segmentCount++;
+	m_tracks[track].duration += duration;
+}
+
+void Timeline::addEvent(float time, std::function<void()> callback) {
+	m_events.push_back(Event{ time, std::move(callback) });
+}
+
+void Timeline::start() {
+	// Lay each track's segments out next to each other, in the order they were added.
+	std::stable_sort(m_segments.begin(), m_segments.end(),
+		[](const Segment& a, const Segment& b) { return a.track < b.track; });
+	std::stable_sort(m_events.begin(), m_events.end(),
+		[](const Event& a, const Event& b) { return a.time < b.time; });
+	uint32_t first = 0;
+	m_duration = m_events.empty() ? 0 : m_events.back().time;
+	for (auto& track : m_tracks) {
+		track.firstSegment = first;
+		first += track.segmentCount;
+		track.current = 0;
+		m_duration = std::max(m_duration, track.start + track.duration);
+	}
+
+	// Pauses never need visiting.
+	m_schedule.clear();
+	for (uint32_t i = 0; i < m_segments.size(); i++) {
+		m_segments[i].time = m_tracks[m_segments[i].track].start + m_segments[i].start;
+		if (m_segments[i].kind != Kind::Pause) {
+			m_schedule.push_back(i);
+		}
+	}
+	std::stable_sort(m_schedule.begin(), m_schedule.end(),
+		[&](uint32_t a, uint32_t b) { return m_segments[a].time < m_segments[b].time; });
+	m_running.clear();
+	m_nextScheduled = 0;
+	m_time = 0;
+	m_nextEvent = 0;
+}
+
+uint32_t Timeline::segmentAt(Track& track, float time) {
+	const Segment* segments = &m_segments[track.firstSegment];
+	const Segment& current = segments[track.current];
+	if (time >= current.start && time < current.start + current.duration) {
+		return track.current;
+	}
+	// The last segment starting at or before the time.
+	const Segment* after = std::upper_bound(segments, segments + track.segmentCount, time,
+		[](float t, const Segment& segment) { return t < segment.start; });
+	track.current = after == segments ? 0 : static_cast<uint32_t>(after - segments - 1);
+	return track.current;
+}
+
+void Timeline::moveSegment(const Segment& segment, float before, float after) {
+	switch (segment.kind) {
+	case Kind::Rotation:
+		m_rotations.runs.push_back(Run{ segment.channel, after - before });
+		break;
+	case Kind::Translation:
+		m_translations.runs.push_back(Run{ segment.channel, after - before });
+		break;
+	case Kind::Path:
+		m_paths.followers.setTime(segment.channel, after);
+		m_paths.moved.push_back(segment.channel);
+		break;
+	case Kind::Clip:
+		m_clips.time[segment.channel] = after;
+		m_clips.moved.push_back(segment.channel);
+		break;
+	case Kind::Pause:
+		break;
+	}
+}
+
+void Timeline::moveTrack(Track& track, float from, float to) {
+	// Only the part of the move within the track matters.
+	float start = std::clamp(from - track.start, 0.0f, track.duration);
+	float end = std::clamp(to - track.start, 0.0f, track.duration);
+	if (start == end) {
+		return;
+	}
+	uint32_t first = segmentAt(track, start);
+	uint32_t last = segmentAt(track, end);
+	int32_t step = end > start ? 1 : -1;
+	for (uint32_t s = first; ; s += step) {
+		const Segment& segment = m_segments[track.firstSegment + s];
+		float before = std::clamp(start - segment.start, 0.0f, segment.duration);
+		float after = std::clamp(end - segment.start, 0.0f, segment.duration);
+		if (before != after) {
+			m_crossed.push_back(Crossing{ track.firstSegment + s, before, after });
+		}
+		if (s == last) {
+			break;
+		}
+	}
+}
+
+void Timeline::playTo(float time) {
+	// Whatever starts before the new time is running for part of the move, at least.
+	while (m_nextScheduled < m_schedule.size() && m_segments[m_schedule[m_nextScheduled]].time < time) {
+		m_running.push_back(m_schedule[m_nextScheduled++]);
+	}
+	size_t kept = 0;
+	for (uint32_t index : m_running) {
+		const Segment& segment = m_segments[index];
+		float before = std::clamp(m_time - segment.time, 0.0f, segment.duration);
+		float after = std::clamp(time - segment.time, 0.0f, segment.duration);
+		if (before != after) {
+			moveSegment(segment, before, after);
+		}
+		if (time < segment.time + segment.duration) {
+			m_running[kept++] = index;
+		}
+	}
+	m_running.resize(kept);
+	m_time = time;
+}
+
+void Timeline::moveTo(float time) {
+	m_crossed.clear();
+	for (auto& track : m_tracks) {
+		moveTrack(track, m_time, time);
+	}
+	// The segments crossed move in the order they play, or the reverse going backwards, so the
+	// turns compose as they did when played.
+	auto playsBefore = [&](const Crossing& a, const Crossing& b) {
+		const Segment& first = m_segments[a.segment];
+		const Segment& second = m_segments[b.segment];
+		return first.time < second.time || (first.time == second.time && a.segment < b.segment);
+	};
+	if (time > m_time) {
+		std::sort(m_crossed.begin(), m_crossed.end(), playsBefore);
+	}
+	else {
+		std::sort(m_crossed.begin(), m_crossed.end(),
+			[&](const Crossing& a, const Crossing& b) { return playsBefore(b, a); });
+	}
+	for (auto& crossing : m_crossed) {
+		moveSegment(m_segments[crossing.segment], crossing.before, crossing.after);
+	}
+	m_time = time;
+
+	// Find where playing on from here picks up: each track's own segment, if it's running, and
+	// the schedule from the first segment that hasn't started.
+	m_nextScheduled = std::lower_bound(m_schedule.begin(), m_schedule.end(), time,
+		[&](uint32_t index, float t) { return m_segments[index].time < t; }) - m_schedule.begin();
+	m_running.clear();
+	for (auto& track : m_tracks) {
+		if (track.segmentCount == 0) {
+			continue;
+		}
+		uint32_t index = track.firstSegment + segmentAt(track, std::clamp(time - track.start, 0.0f, track.duration));
+		const Segment& segment = m_segments[index];
+		if (segment.kind != Kind::Pause && segment.time < time && time < segment.time + segment.duration) {
+			m_running.push_back(index);
+		}
+	}
+	std::sort(m_running.begin(), m_running.end(), [&](uint32_t a, uint32_t b) {
+		return m_segments[a].time < m_segments[b].time || (m_segments[a].time == m_segments[b].time && a < b);
+	});
+}
+
+void Timeline::apply() {
+	// Turns compose in the order their channels moved, which is the order they play in.
+	RotationPool& rotations = m_rotations;
+	for (const Run& run : rotations.runs) {
+		uint32_t i = run.channel;
+		float half = 0.5f * rotations.rate[i] * run.elapsed;
+		float sine, cosine;
+		if (std::abs(half) <= MAX_SERIES_ANGLE) {
+			float squared = half * half;
+			sine = half * (1 - squared * (1.0f / 6) * (1 - squared * (1.0f / 20) * (1 - squared * (1.0f / 42))));
+			cosine = 1 - squared * 0.5f * (1 - squared * (1.0f / 12) * (1 - squared * (1.0f / 30) * (1 - squared * (1.0f / 56))));
+		}
+		else {
+			sine = std::sin(half);
+			cosine = std::cos(half);
+		}
+		uint32_t target = rotations.target[i];
+		load(target);
+		m_orientations[target] = m_orientations[target]
+			* glm::quat(cosine, rotations.axisX[i] * sine, rotations.axisY[i] * sine, rotations.axisZ[i] * sine);
+	}
+	rotations.runs.clear();
+	TranslationPool& translations = m_translations;
+	for (const Run& run : translations.runs) {
+		uint32_t i = run.channel;
+		uint32_t target = translations.target[i];
+		load(target);
+		m_positions[target] += glm::vec3(translations.perSecondX[i], translations.perSecondY[i],
+			translations.perSecondZ[i]) * run.elapsed;
+	}
+	translations.runs.clear();
+	m_paths.followers.evaluate(m_paths.moved);
+	for (uint32_t i : m_paths.moved) {
+		uint32_t target = m_paths.target[i];
+		load(target);
+		m_positions[target] = m_paths.followers.position(i);
+	}
+	m_paths.moved.clear();
+
+	// Each object moved is written once, however many channels moved it.
+	for (uint32_t target : m_moved) {
+		m_objects[target]->setPosition(m_positions[target]);
+		m_objects[target]->setOrientation(glm::normalize(m_orientations[target]));
+		m_loaded[target] = 0;
+	}
+	m_moved.clear();
+
+	for (uint32_t i : m_clips.moved) {
+		KeyframeSampler& sampler = m_clips.sampler[i];
+		float clipTime = m_clips.time[i];
+		if (clipTime >= sampler.time()) {
+			sampler.advance(clipTime - sampler.time());
+		}
+		else {
+			sampler.seek(clipTime);
+		}
+	}
+	m_clips.moved.clear();
+}
+
+void Timeline::tick(float dt) {
+	if (dt >= 0) {
+		playTo(m_time + dt);
+	}
+	else {
+		moveTo(m_time + dt);
+	}
+	apply();
+	while (m_nextEvent < m_events.size() && m_events[m_nextEvent].time <= m_time) {
+		m_events[m_nextEvent++].callback();
+	}
+}
+
+void Timeline::seek(float time) {
+	moveTo(time);
+	apply();
+	m_nextEvent = std::lower_bound(m_events.begin(), m_events.end(), time,
+		[](const Event& event, float t) { return event.time < t; }) - m_events.begin();
+}
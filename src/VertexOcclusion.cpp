@@ -0,0 +1,174 @@
+#include "VertexOcclusion.h"
+#include <fstream>
+#include <iostream>
+#include "Bvh.h"
+#include "ContentHash.h"
+#include "Sampling.h"
+
+namespace {
+	const uint32_t OCCLUSION_MAGIC = 0x32415856; // "VXA2"
+	// Pushes ray origins off their surface to avoid self-intersection.
+	const float SURFACE_OFFSET = 2e-3f;
+
+	struct OcclusionHeader {
+		uint32_t magic;
+		// Used to reject a cache entry made for a different mesh or different settings.
+		uint32_t vertexCount;
+		uint32_t faceCount;
+		uint32_t samplesPerVertex;
+		float occlusionDistance;
+		// Used to reject a cache entry made with the mesh or any of its occluders somewhere else.
+		uint64_t placementHash;
+	};
+
+	/**
+	 * @brief Collects the world-space triangles of an object hierarchy.
+	 */
+	void appendTriangles(Object3D& object, std::vector<glm::vec3>& triangles) {
+		object.visitMeshes([&](Mesh3D& mesh, const glm::mat4& model) {
+			const MeshGeometry& geometry = mesh.geometry();
+			for (uint32_t index : geometry.faces) {
+				const Vertex3D& v = geometry.vertices[index];
+				triangles.push_back(glm::vec3(model * glm::vec4(v.x, v.y, v.z, 1)));
+			}
+		});
+	}
+
+	/**
+	 * @brief Adds where each mesh of an object hierarchy is and how many faces it has, which is
+	 * enough to notice an occluder that was moved, added or swapped for another model.
+	 */
+	void hashPlacement(Object3D& object, ContentHash& hash) {
+		object.visitMeshes([&](Mesh3D& mesh, const glm::mat4& model) {
+			hash.add(model);
+			hash.add(static_cast<uint32_t>(mesh.geometry().faces.size()));
+		});
+	}
+
+	/**
+	 * @brief Casts hemisphere rays from each vertex of a mesh, returning the unoccluded fraction
+	 * quantized to a byte.
+	 */
+	std::vector<uint8_t> computeOcclusion(const Mesh3D& mesh, const glm::mat4& model, const WideBvh& occluders,
+		const VertexOcclusionSettings& settings, ThreadPool& pool) {
+		const MeshGeometry& geometry = mesh.geometry();
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+		uint32_t samples = std::max(settings.samplesPerVertex, 1u);
+		std::vector<uint8_t> occlusion(geometry.vertices.size());
+
+		pool.parallelFor(static_cast<uint32_t>(geometry.vertices.size()), 256, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				const Vertex3D& v = geometry.vertices[i];
+				glm::vec3 normal = normalMatrix * glm::vec3(v.nx, v.ny, v.nz);
+				if (glm::dot(normal, normal) <= 0) {
+					occlusion[i] = 255;
+					continue;
+				}
+				normal = glm::normalize(normal);
+				glm::vec3 origin = glm::vec3(model * glm::vec4(v.x, v.y, v.z, 1)) + normal * SURFACE_OFFSET;
+
+				Rng rng(i * 9781u + 1);
+				uint32_t unoccluded = 0;
+				for (uint32_t s = 0; s < samples; s++) {
+					if (!occluders.occluded(Ray{ origin, cosineSample(normal, rng), settings.occlusionDistance })) {
+						unoccluded++;
+					}
+				}
+				occlusion[i] = static_cast<uint8_t>((255 * unoccluded + samples / 2) / samples);
+			}
+		});
+		return occlusion;
+	}
+
+	bool loadCached(const std::filesystem::path& path, const OcclusionHeader& expected, std::vector<uint8_t>& occlusion) {
+		std::ifstream in(path, std::ios::binary);
+		OcclusionHeader header;
+		if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+			|| header.magic != expected.magic || header.vertexCount != expected.vertexCount
+			|| header.faceCount != expected.faceCount || header.samplesPerVertex != expected.samplesPerVertex
+			|| header.occlusionDistance != expected.occlusionDistance || header.placementHash != expected.placementHash) {
+			return false;
+		}
+		occlusion.resize(header.vertexCount);
+		return static_cast<bool>(in.read(reinterpret_cast<char*>(occlusion.data()), occlusion.size()));
+	}
+}
+
+void bakeVertexOcclusion(std::vector<Object3D>& objects, const VertexOcclusionSettings& settings,
+	ThreadPool& pool, const std::filesystem::path& cacheDirectory) {
+	std::filesystem::create_directories(cacheDirectory);
+
+	// Built lazily, so a fully cached scene never builds a BVH.
+	std::unique_ptr<WideBvh> staticOccluders;
+	uint32_t baked = 0, cached = 0;
+
+	// Static meshes are occluded by every static object, dynamic ones only by their own object.
+	ContentHash staticPlacement;
+	for (auto& object : objects) {
+		if (object.isStatic()) {
+			hashPlacement(object, staticPlacement);
+		}
+	}
+
+	for (size_t i = 0; i < objects.size(); i++) {
+		std::unique_ptr<WideBvh> selfOccluders;
+		ContentHash occluderPlacement = staticPlacement;
+		if (!objects[i].isStatic()) {
+			occluderPlacement = ContentHash();
+			hashPlacement(objects[i], occluderPlacement);
+		}
+		uint32_t meshIndex = 0;
+		objects[i].visitMeshes([&](Mesh3D& mesh, const glm::mat4& model) {
+			const MeshGeometry& geometry = mesh.geometry();
+			std::filesystem::path path = cacheDirectory
+				/ ("object" + std::to_string(i) + "_mesh" + std::to_string(meshIndex++) + ".ao");
+			ContentHash placement = occluderPlacement;
+			placement.add(model);
+			// Value-initialized first so the padding before the hash is written as zeroes.
+			OcclusionHeader header{};
+			header.magic = OCCLUSION_MAGIC;
+			header.vertexCount = static_cast<uint32_t>(geometry.vertices.size());
+			header.faceCount = static_cast<uint32_t>(geometry.faces.size());
+			header.samplesPerVertex = settings.samplesPerVertex;
+			header.occlusionDistance = settings.occlusionDistance;
+			header.placementHash = placement.value();
+
+			std::vector<uint8_t> occlusion;
+			if (loadCached(path, header, occlusion)) {
+				mesh.setVertexOcclusion(occlusion);
+				cached++;
+				return;
+			}
+
+			const WideBvh* occluders;
+			if (objects[i].isStatic()) {
+				if (!staticOccluders) {
+					std::vector<glm::vec3> triangles;
+					for (auto& object : objects) {
+						if (object.isStatic()) {
+							appendTriangles(object, triangles);
+						}
+					}
+					staticOccluders = std::make_unique<WideBvh>(TriangleBvh(triangles));
+				}
+				occluders = staticOccluders.get();
+			}
+			else {
+				if (!selfOccluders) {
+					std::vector<glm::vec3> triangles;
+					appendTriangles(objects[i], triangles);
+					selfOccluders = std::make_unique<WideBvh>(TriangleBvh(triangles));
+				}
+				occluders = selfOccluders.get();
+			}
+
+			occlusion = computeOcclusion(mesh, model, *occluders, settings, pool);
+			std::ofstream out(path, std::ios::binary);
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			out.write(reinterpret_cast<const char*>(occlusion.data()), occlusion.size());
+			mesh.setVertexOcclusion(occlusion);
+			baked++;
+		});
+	}
+	std::cout << "vertex occlusion: " << baked << " meshes baked, " << cached << " loaded from cache" << std::endl;
+}
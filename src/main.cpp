@@ -15,25 +15,54 @@ We now transform local space vertices to clip space using uniform matrices in th
 #include <memory>
 #include <filesystem>
 #include <math.h>
+#include <algorithm>
 
 #include "AssimpImport.h"
 #include "Mesh3D.h"
 #include "Object3D.h"
-#include "Animator.h"
+#include "Timeline.h"
+#include "KeyframeAnimation.h"
 #include "ShaderProgram.h"
 #include <SFML/Window/Event.hpp>
 #include <SFML/Window/Window.hpp>
 #include <glm/gtx/rotate_vector.hpp>
 
-#include "PauseAnimation.h"
-#include "BezierAnimation.h"
+#include "Benchmark.h"
+#include "ShadowAtlas.h"
+#include "LightmapBaker.h"
+#include "VertexOcclusion.h"
+#include "PathTracer.h"
+#include "FrameRecorder.h"
+#include "CameraPath.h"
+#include "GpuProfiler.h"
+#include "DynamicResolution.h"
+#include "TextureStreamer.h"
+#include "Impostors.h"
+#include "InputRecording.h"
+#include "AudioManager.h"
+#include "DiceThrow.h"
+#include "ObjectPhysics.h"
+#include "PhysicsBenchmark.h"
 #include <SFML/Audio.hpp>
 #include <SFML/System.hpp>
 
+// The texture unit the shadow atlas is bound to, clear of the units meshes bind their textures to.
+const int32_t SHADOW_TEXTURE_UNIT = 8;
+
+// The dice are simulated at a fixed rate, independent of the frame rate. They're swept against the
+// tables each step, so this can be coarser than their fall speed would otherwise allow.
+const float PHYSICS_STEP = 1.0f / 60.0f;
+// After a long stall, the simulation drops time rather than taking many steps to catch up.
+const float MAX_PHYSICS_CATCHUP = 0.1f;
+const float DIE_MASS = 0.005f;
+const float DIE_FRICTION = 0.4f;
+// When the win sound plays on the animation timeline, in seconds.
+const float WIN_SOUND_TIME = 7;
+
 struct Scene {
 	ShaderProgram program;
 	std::vector<Object3D> objects;
-	std::vector<Animator> animators;
+	Timeline animations;
 };
 
 /**
@@ -52,6 +81,81 @@ ShaderProgram phongLightingShader() {
 	return shader;
 }
 
+/**
+ * @brief Constructs a shader program that only writes depth, for the depth pre-pass.
+ */
+ShaderProgram depthOnlyShader() {
+	ShaderProgram shader;
+	try {
+		shader.load("shaders/depth_only.vert", "shaders/depth_only.frag");
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "ERROR: " << e.what() << std::endl;
+		exit(1);
+	}
+	return shader;
+}
+
+/**
+ * @brief Constructs a shader program that upscales and sharpens a lower-resolution frame.
+ */
+ShaderProgram upscaleShader() {
+	ShaderProgram shader;
+	try {
+		shader.load("shaders/upscale.vert", "shaders/upscale.frag");
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "ERROR: " << e.what() << std::endl;
+		exit(1);
+	}
+	return shader;
+}
+
+/**
+ * @brief Constructs a shader program that renders a prop's views into its impostor atlases.
+ */
+ShaderProgram impostorBakeShader() {
+	ShaderProgram shader;
+	try {
+		shader.load("shaders/light_perspective.vert", "shaders/impostor_bake.frag");
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "ERROR: " << e.what() << std::endl;
+		exit(1);
+	}
+	return shader;
+}
+
+/**
+ * @brief Constructs a shader program that draws distant props as instanced impostor quads.
+ */
+ShaderProgram impostorShader() {
+	ShaderProgram shader;
+	try {
+		shader.load("shaders/impostor.vert", "shaders/impostor.frag");
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "ERROR: " << e.what() << std::endl;
+		exit(1);
+	}
+	return shader;
+}
+
+/**
+ * @brief Constructs a shader program that draws geometry in a single flat color, for debug views.
+ */
+ShaderProgram flatColorShader() {
+	ShaderProgram shader;
+	try {
+		shader.load("shaders/simple_perspective.vert", "shaders/uniform_color.frag");
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "ERROR: " << e.what() << std::endl;
+		exit(1);
+	}
+	return shader;
+}
+
 /**
  * @brief Constructs a shader program that performs texture mapping with no lighting.
  */
@@ -68,193 +172,212 @@ ShaderProgram texturingShader() {
 }
 
 /**
- * @brief Loads an image from the given path into an OpenGL texture.
+ * @brief Loads an image from the given path into an OpenGL texture, streamed if a streamer is given.
  */
-Texture loadTexture(const std::filesystem::path& path, const std::string& samplerName = "baseTexture") {
+Texture loadTexture(const std::filesystem::path& path, const std::string& samplerName = "baseTexture",
+	TextureStreamer* streamer = nullptr) {
+	if (streamer) {
+		return streamer->load(path, samplerName);
+	}
 	StbImage i;
 	i.loadFromFile(path.string());
 	return Texture::loadImage(i, samplerName);
 }
 
-Scene Casino() {
+/**
+ * @brief Assembles the casino.
+ * @param streamer if given, model textures are streamed by mip level instead of loaded in full.
+ */
+Scene Casino(TextureStreamer* streamer) {
 	Scene scene{ phongLightingShader()
 	};
 	std::vector<Texture> floorTextures = {
-		loadTexture("models/carpet.jpeg", "baseTexture"),
+		loadTexture("models/carpet.jpeg", "baseTexture", streamer),
 	};
 	// the floor of my scene
-	auto floorMesh = Mesh3D::square(floorTextures);
-	auto floor = Object3D(std::vector<Mesh3D>{floorMesh});
+	auto floor = Object3D(Mesh3D::square(floorTextures));
+	floor.setName("floor");
 	floor.grow(glm::vec3(10, 10, 10));
 	floor.move(glm::vec3(0, 0, 0));
 	floor.rotate(glm::vec3(-M_PI / 2, 0, 0));
+	floor.setStatic(true);
 	scene.objects.push_back(std::move(floor));
 
 	// pool table
-	auto poolTable = assimpLoad("models/pool_table/scene.gltf", true);
+	auto poolTable = assimpLoad("models/pool_table/scene.gltf", true, true, streamer);
+	poolTable.setName("poolTable");
 	poolTable.grow(glm::vec3(0.002));
 	poolTable.rotate(glm::vec3(0, -M_PI/2, 0));
 	poolTable.move(glm::vec3(-2, .3, -3));
+	poolTable.setStatic(true);
 	scene.objects.push_back(std::move(poolTable));
 
 	// the table where the dice fall onto
-	auto table = assimpLoad("models/poker_table/scene.gltf", true);
+	auto table = assimpLoad("models/poker_table/scene.gltf", true, true, streamer);
+	table.setName("table");
 	table.setScale(glm::vec3(.001));
 	table.setPosition(glm::vec3(0, 0, 0));
+	table.setStatic(true);
 	scene.objects.push_back(std::move(table));
 
 	// casino chips
-	auto casinoChips = assimpLoad("models/casino_chips/scene.gltf", true);
+	auto casinoChips = assimpLoad("models/casino_chips/scene.gltf", true, true, streamer);
+	casinoChips.setName("casinoChips");
 	casinoChips.setScale(glm::vec3(1));
 	casinoChips.setPosition(glm::vec3(.4, .6, 0));
+	casinoChips.setStatic(true);
 	scene.objects.push_back(std::move(casinoChips));
 
 	// slot machine (i wish i found a better looking one :c)
-	auto slots2 = assimpLoad("models/slotmachine3/scene.gltf", true);
+	// its lever pull and reel spins are animated in the model
+	std::vector<KeyframeClip> slotClips;
+	auto slots2 = assimpLoad("models/slotmachine3/scene.gltf", true, false, streamer, &slotClips);
+	slots2.setName("slots2");
 	slots2.setScale(glm::vec3(2));
 	slots2.setPosition(glm::vec3(0, 0.8, -4));
 	slots2.rotate(glm::vec3(0, -M_PI/2, 0));
 	scene.objects.push_back(std::move(slots2));
 
-	// animation for my hierarchical slot machine
-	Animator animLever;
-	Animator animLeverUp;
-	Animator animWheel1;
-	Animator animWheel2;
-	Animator animWheel3;
-	animLever.addAnimation(std::make_unique<PauseAnimation>(scene.objects[4], 1.5));
-	animLever.addAnimation(std::make_unique<RotationAnimation>(scene.objects[4].getChild(0).getChild(0).getChild(1).getChild(0), 1, glm::vec3(0, 0, .5*(-2*M_PI))));
-	animLever.addAnimation(std::make_unique<PauseAnimation>(scene.objects[4].getChild(0).getChild(0).getChild(1).getChild(0), .5));
-	animLever.addAnimation(std::make_unique<RotationAnimation>(scene.objects[4].getChild(0).getChild(0).getChild(1).getChild(0), 1, glm::vec3(0, 0, .5*(2*M_PI))));
-
-	animWheel1.addAnimation(std::make_unique<PauseAnimation>(scene.objects[4], 1.5));
-	animWheel1.addAnimation(std::make_unique<RotationAnimation>(scene.objects[4].getChild(0).getChild(0).getChild(2).getChild(0), 3, glm::vec3(0, 10*(-2*M_PI), 0)));
-	animWheel2.addAnimation(std::make_unique<PauseAnimation>(scene.objects[4], 1.5));
-	animWheel2.addAnimation(std::make_unique<RotationAnimation>(scene.objects[4].getChild(0).getChild(0).getChild(3).getChild(0),5 , glm::vec3(0, 2*(-2*M_PI), 0)));
-	animWheel3.addAnimation(std::make_unique<PauseAnimation>(scene.objects[4], 1.5));
-	animWheel3.addAnimation(std::make_unique<RotationAnimation>(scene.objects[4].getChild(0).getChild(0).getChild(4).getChild(0), 7, glm::vec3(0, -2*M_PI, 0)));
-
 	// die #1
-	auto cube = assimpLoad("models/dice/scene.gltf", true);
+	auto cube = assimpLoad("models/dice/scene.gltf", true, false, streamer);
+	cube.setName("cube");
 	cube.setScale(glm::vec3(.05));
-	cube.move(glm::vec3(0, 2, 0));
+	cube.move(GAME_DICE_THROWS[0].position);
 	cube.setAcceleration(glm::vec3(0, -9.8, 0));
-	cube.setVelocity(glm::vec3(-.5, .5, 0));
-	cube.setAngularVelocity(glm::vec3(8, 5, 2));
+	cube.setVelocity(GAME_DICE_THROWS[0].velocity);
+	cube.setAngularVelocity(GAME_DICE_THROWS[0].angularVelocity);
 	cube.setBounceCoeff(0.5);
 	cube.isMoving = true;
 	scene.objects.push_back(std::move(cube));
 
 	// die #2
-	auto cube2 = assimpLoad("models/dice/scene.gltf", true);
+	auto cube2 = assimpLoad("models/dice/scene.gltf", true, false, streamer);
+	cube2.setName("cube2");
 	cube2.setScale(glm::vec3(.05));
-	cube2.move(glm::vec3(-.5, 2, 0));
+	cube2.move(GAME_DICE_THROWS[1].position);
 	cube2.setAcceleration(glm::vec3(0, -9.8, 0));
-	cube2.setVelocity(glm::vec3(.5, .5, -.5));
-	cube2.setAngularVelocity(glm::vec3(12, 1, 5));
+	cube2.setVelocity(GAME_DICE_THROWS[1].velocity);
+	cube2.setAngularVelocity(GAME_DICE_THROWS[1].angularVelocity);
 	cube2.setBounceCoeff(0.5);
 	cube2.isMoving = true;
 	scene.objects.push_back(std::move(cube2));
 
 	// letter g
-	auto letterG = assimpLoad("models/g_letter/scene.gltf", true);
+	auto letterG = assimpLoad("models/g_letter/scene.gltf", true, false, streamer);
+	letterG.setName("letterG");
 	letterG.setScale(glm::vec3(.5));
 	letterG.move(glm::vec3(-.5, 2, 3));
 	scene.objects.push_back(std::move(letterG));
 
 	//letter a
-	auto letterA = assimpLoad("models/a_letter/scene.gltf", true);
+	auto letterA = assimpLoad("models/a_letter/scene.gltf", true, false, streamer);
+	letterA.setName("letterA");
 	letterA.setScale(glm::vec3(.5));
 	letterA.move(glm::vec3(-.2, 2, 3));
 	scene.objects.push_back(std::move(letterA));
 
 	// letter t
-	auto letterT = assimpLoad("models/t_letter/scene.gltf", true);
+	auto letterT = assimpLoad("models/t_letter/scene.gltf", true, false, streamer);
+	letterT.setName("letterT");
 	letterT.setScale(glm::vec3(.5));
 	letterT.move(glm::vec3(0.1, 2, 3));
 	scene.objects.push_back(std::move(letterT));
 	// letter o
-	auto letterO = assimpLoad("models/o_letter/scene.gltf", true);
+	auto letterO = assimpLoad("models/o_letter/scene.gltf", true, false, streamer);
+	letterO.setName("letterO");
 	letterO.setScale(glm::vec3(.5));
 	letterO.move(glm::vec3(.4, 2, 3));
 	scene.objects.push_back(std::move(letterO));
 
 	// deck of cards
-	auto cardDeck = assimpLoad("models/deck_of_cards/scene.gltf", true);
+	auto cardDeck = assimpLoad("models/deck_of_cards/scene.gltf", true, true, streamer);
+	cardDeck.setName("cardDeck");
 	cardDeck.grow(glm::vec3(0.001));
 	cardDeck.move(glm::vec3(.4, .6, 0));
+	cardDeck.setStatic(true);
 	scene.objects.push_back(std::move(cardDeck));
 
 	// roulette table
-	auto rouletteTable = assimpLoad("models/roulette_table/scene.gltf", true);
+	auto rouletteTable = assimpLoad("models/roulette_table/scene.gltf", true, true, streamer);
+	rouletteTable.setName("rouletteTable");
 	rouletteTable.grow(glm::vec3(.3));
 	rouletteTable.move(glm::vec3(3, .8, -2.5));
 	rouletteTable.rotate(glm::vec3(0, -M_PI/2, 0));
+	rouletteTable.setStatic(true);
 	scene.objects.push_back(std::move(rouletteTable));
 
 	// different poker table
-	auto pokerTable2 = assimpLoad("models/poker_table2/scene.gltf", true);
+	auto pokerTable2 = assimpLoad("models/poker_table2/scene.gltf", true, true, streamer);
+	pokerTable2.setName("pokerTable2");
 	pokerTable2.grow(glm::vec3(1));
 	pokerTable2.move(glm::vec3(3, -1.5, 0));
 	pokerTable2.isMoving = false;
+	pokerTable2.setStatic(true);
 	scene.objects.push_back(std::move(pokerTable2));
 
 	// bar
-	auto bar = assimpLoad("models/art_deco_bar/scene.gltf", true);
+	auto bar = assimpLoad("models/art_deco_bar/scene.gltf", true, true, streamer);
+	bar.setName("bar");
 	bar.grow(glm::vec3(.8));
 	bar.move(glm::vec3(3, 0, -4.6));
 	bar.isMoving = false;
+	bar.setStatic(true);
 	scene.objects.push_back(std::move(bar));
 
 	// textures for my walls and ceiling
 	std::vector<Texture> WallTextures = {
-		loadTexture("models/casino_left.jpg", "baseTexture"),
+		loadTexture("models/casino_left.jpg", "baseTexture", streamer),
 	};
 	std::vector<Texture> WallTextures2 = {
-		loadTexture("models/whitewall.jpg", "baseTexture"),
+		loadTexture("models/whitewall.jpg", "baseTexture", streamer),
 	};
 	std::vector<Texture> ceilingTextures = {
-		loadTexture("models/popcorn_ceiling.jpg", "baseTexture"),
+		loadTexture("models/popcorn_ceiling.jpg", "baseTexture", streamer),
 	};
 
 	// left wall
-	auto leftWallMesh = Mesh3D::square(WallTextures);
-	auto leftWall = Object3D(std::vector<Mesh3D>{leftWallMesh});
+	auto leftWall = Object3D(Mesh3D::square(WallTextures));
+	leftWall.setName("leftWall");
 	leftWall.grow(glm::vec3(10, 10, 10));
 	leftWall.move(glm::vec3(-5, 4.5, 0));
 	leftWall.rotate(glm::vec3(0, M_PI/2, 0));
+	leftWall.setStatic(true);
 	scene.objects.push_back(std::move(leftWall));
 
 	// right wall
-	auto rightWallMesh = Mesh3D::square(WallTextures);
-	auto rightWall = Object3D(std::vector<Mesh3D>{rightWallMesh});
+	auto rightWall = Object3D(Mesh3D::square(WallTextures));
+	rightWall.setName("rightWall");
 	rightWall.grow(glm::vec3(10, 10, 10));
 	rightWall.move(glm::vec3(5, 4.5, 0));
 	rightWall.rotate(glm::vec3(0, -M_PI/2, 0));
+	rightWall.setStatic(true);
 	scene.objects.push_back(std::move(rightWall));
 
 	// front wall
-	auto frontWallMesh = Mesh3D::square(WallTextures2);
-	auto frontWall = Object3D(std::vector<Mesh3D>{frontWallMesh});
+	auto frontWall = Object3D(Mesh3D::square(WallTextures2));
+	frontWall.setName("frontWall");
 	frontWall.grow(glm::vec3(10, 10.8, 10));
 	frontWall.move(glm::vec3(0, 4.4, -5));
 	frontWall.rotate(glm::vec3(0, 0, 0));
+	frontWall.setStatic(true);
 	scene.objects.push_back(std::move(frontWall));
 
 	// back wall
-	auto backWallMesh = Mesh3D::square(WallTextures2);
-	auto backWall = Object3D(std::vector<Mesh3D>{backWallMesh});
+	auto backWall = Object3D(Mesh3D::square(WallTextures2));
+	backWall.setName("backWall");
 	backWall.grow(glm::vec3(10, 10.8, 10));
 	backWall.move(glm::vec3(0, 4.4, 5));
 	backWall.rotate(glm::vec3(0, M_PI, 0));
+	backWall.setStatic(true);
 	scene.objects.push_back(std::move(backWall));
 
 	// ceiling
-	auto ceilingMesh = Mesh3D::square(ceilingTextures);
-	auto ceiling = Object3D(std::vector<Mesh3D>{ceilingMesh});
+	auto ceiling = Object3D(Mesh3D::square(ceilingTextures));
+	ceiling.setName("ceiling");
 	ceiling.grow(glm::vec3(10, 10, 10));
 	ceiling.move(glm::vec3(0, 5, 0));
 	ceiling.rotate(glm::vec3(-M_PI / 2, 0, M_PI));
+	ceiling.setStatic(true);
 	scene.objects.push_back(std::move(ceiling));
 
 	// animation for my letters
@@ -266,39 +389,130 @@ Scene Casino() {
 	glm::vec3 p3_t = glm::vec3(0.1, 2, 0);
 	glm::vec3 p3_o = glm::vec3(.4, 2, 0);
 
-	Animator animName;
-	animName.addAnimation(std::make_unique<PauseAnimation>(scene.objects[7], 7));
-	animName.addAnimation(std::make_unique<BezierAnimation>(scene.objects[7], 3, p0, p1, p2, p3_g));
-	animName.addAnimation(std::make_unique<BezierAnimation>(scene.objects[8], 3, p0, p1, p2, p3_a));
-	animName.addAnimation(std::make_unique<BezierAnimation>(scene.objects[9], 3, p0, p1, p2, p3_t));
-	animName.addAnimation(std::make_unique<BezierAnimation>(scene.objects[10], 3, p0, p1, p2, p3_o));
-
-	scene.animators.push_back(std::move(animName));
-	scene.animators.push_back(std::move(animLever));
-	scene.animators.push_back(std::move(animWheel1));
-	scene.animators.push_back(std::move(animWheel2));
-	scene.animators.push_back(std::move(animWheel3));
+	Timeline& animations = scene.animations;
+	uint32_t animName = animations.addTrack(7);
+	animations.add(animName, scene.objects[7], 3, BezierChannel{ p0, p1, p2, p3_g });
+	animations.add(animName, scene.objects[8], 3, BezierChannel{ p0, p1, p2, p3_a });
+	animations.add(animName, scene.objects[9], 3, BezierChannel{ p0, p1, p2, p3_t });
+	animations.add(animName, scene.objects[10], 3, BezierChannel{ p0, p1, p2, p3_o });
+
+	// animation for my hierarchical slot machine, once the coin has dropped
+	for (const auto& clip : slotClips) {
+		uint32_t animSlots = animations.addTrack(1.5);
+		animations.add(animSlots, scene.objects[4], clip.duration, ClipChannel{ clip });
+	}
 	return scene;
 
 }
-void snapToNearestRotation(Object3D& dice) {
-	glm::vec3 rot = dice.getOrientation();
-
-	// Convert to degrees and snap to nearest 90 degrees
-	rot = glm::degrees(rot);
+int main(int argc, char* argv[]) {
+	std::cout << std::filesystem::current_path() << std::endl;
 
-	// basically makes it so its increments of 90 degrees
-	// ex: if our dice is at 45 degrees then 45/90=0.5
-	// round(0.5) = 1 -> 1 * 90 = 90 degrees
-	rot.x = round(rot.x / 90) * 90;
-	rot.y = round(rot.y / 90) * 90;
-	rot.z = round(rot.z / 90) * 90;
+	// Command line options:
+	//   --depth-prepass       lay down depth with a position-only pass before shading.
+	//   --benchmark [frames]  run a scripted, fixed-step flythrough and write benchmark.json.
+	//   --no-shadows          start with shadow mapping disabled.
+	//   --bake-lightmaps      bake lighting for static objects into lightmaps/ before starting.
+	//   --vertex-ao           bake (or load cached) per-vertex ambient occlusion into vertexao/.
+	//   --path-trace [spp]    path trace the starting view into render.png/render.exr, then exit.
+	//   --record [frames]     render a fixed-step orbit of the room into frames/, then exit.
+	//   --record-format fmt   png (default) or y4m, which writes a single frames.y4m stream.
+	//   --headless            hide the window while recording.
+	//   --dynamic-resolution [fps]  scale the render resolution to hold a frame rate (default 60).
+	//   --texture-streaming [MB]    stream texture mip levels on demand within a VRAM budget (default 256).
+	//   --impostors [distance]      draw props farther than this as baked impostors (default 8).
+	//   --broadphase-benchmark      time the physics broadphase at 100, 1k and 10k bodies, then exit.
+	//   --record-input file   write every frame's input and time step to a file, for --replay-input.
+	//   --replay-input file   play a recorded session back frame for frame, then exit.
+	bool depthPrepass = false;
+	bool shadowsEnabled = true;
+	bool bakeLightmapsOnStart = false;
+	bool lightMapsEnabled = true;
+	bool vertexOcclusion = false;
+	bool pathTraceOnStart = false;
+	uint32_t pathTraceSamples = 256;
+	bool recordMode = false;
+	uint32_t recordFrames = 600;
+	FrameRecorder::Format recordFormat = FrameRecorder::Format::Png;
+	bool headless = false;
+	bool dynamicResolutionEnabled = false;
+	float targetFps = 60;
+	bool textureStreaming = false;
+	uint64_t textureBudgetMegabytes = 256;
+	bool impostorsEnabled = false;
+	float impostorDistance = 8;
+	bool benchmarkMode = false;
+	uint32_t benchmarkFrames = 600;
+	std::filesystem::path recordInputPath;
+	std::filesystem::path replayInputPath;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--depth-prepass") {
+			depthPrepass = true;
+		}
+		else if (arg == "--bake-lightmaps") {
+			bakeLightmapsOnStart = true;
+		}
+		else if (arg == "--vertex-ao") {
+			vertexOcclusion = true;
+		}
+		else if (arg == "--path-trace") {
+			pathTraceOnStart = true;
+			if (i + 1 < argc && std::isdigit(argv[i + 1][0])) {
+				pathTraceSamples = std::stoi(argv[++i]);
+			}
+		}
+		else if (arg == "--record") {
+			recordMode = true;
+			if (i + 1 < argc && std::isdigit(argv[i + 1][0])) {
+				recordFrames = std::stoi(argv[++i]);
+			}
+		}
+		else if (arg == "--record-format" && i + 1 < argc) {
+			recordFormat = std::string(argv[++i]) == "y4m" ? FrameRecorder::Format::Y4m : FrameRecorder::Format::Png;
+		}
+		else if (arg == "--dynamic-resolution") {
+			dynamicResolutionEnabled = true;
+			if (i + 1 < argc && std::isdigit(argv[i + 1][0])) {
+				targetFps = std::stof(argv[++i]);
+			}
+		}
+		else if (arg == "--texture-streaming") {
+			textureStreaming = true;
+			if (i + 1 < argc && std::isdigit(argv[i + 1][0])) {
+				textureBudgetMegabytes = std::stoull(argv[++i]);
+			}
+		}
+		else if (arg == "--impostors") {
+			impostorsEnabled = true;
+			if (i + 1 < argc && std::isdigit(argv[i + 1][0])) {
+				impostorDistance = std::stof(argv[++i]);
+			}
+		}
+		else if (arg == "--broadphase-benchmark") {
+			// Needs no window or scene.
+			runBroadphaseBenchmark("broadphase.json");
+			return 0;
+		}
+		else if (arg == "--headless") {
+			headless = true;
+		}
+		else if (arg == "--no-shadows") {
+			shadowsEnabled = false;
+		}
+		else if (arg == "--record-input" && i + 1 < argc) {
+			recordInputPath = argv[++i];
+		}
+		else if (arg == "--replay-input" && i + 1 < argc) {
+			replayInputPath = argv[++i];
+		}
+		else if (arg == "--benchmark") {
+			benchmarkMode = true;
+			if (i + 1 < argc && std::isdigit(argv[i + 1][0])) {
+				benchmarkFrames = std::stoi(argv[++i]);
+			}
+		}
+	}
 
-	// Convert back to radians
-	dice.setOrientation(glm::radians(rot));
-}
-int main() {
-	std::cout << std::filesystem::current_path() << std::endl;
 	// Initialize the window and OpenGL.
 	sf::ContextSettings settings;
 	settings.depthBits = 24; // Request a 24 bits depth buffer
@@ -316,59 +530,230 @@ int main() {
 	glFrontFace(GL_CW);
 	glEnable(GL_DEPTH_TEST);
 
+	// Worker threads for streaming and the offline cook steps.
+	ThreadPool pool;
+	std::unique_ptr<TextureStreamer> streamer;
+	if (textureStreaming) {
+		streamer = std::make_unique<TextureStreamer>(pool, "texturecache", textureBudgetMegabytes * 1024 * 1024);
+	}
+
 	// Inintialize scene objects.
-	auto myScene = Casino();
+	auto myScene = Casino(streamer.get());
+	auto depthShader = depthOnlyShader();
+	// The scene's lighting, shared by the lighting shader and the lightmap baker.
+	//  ambient, diffuse, specular, shininess
+	glm::vec4 material = glm::vec4(.6, .5, .5, 0);
+	// ambient color (going for like a yellowish color)
+	glm::vec3 ambientColor = glm::vec3(.8, .8, .5);
+	// light direction that points downward
+	glm::vec3 lightDirection = glm::vec3(0, -1, 0);
+	// color of directional light softer yellow
+	glm::vec3 directionalColor = glm::vec3(.4, .4, .2);
+
+	// Offline cook steps run after scene assembly because occlusion depends on where neighbouring
+	// objects were placed.
+	if (vertexOcclusion) {
+		bakeVertexOcclusion(myScene.objects, VertexOcclusionSettings{}, pool, "vertexao");
+	}
+	// Static objects use baked lighting when it's available.
+	LightmapBakeSettings bakeSettings{ lightDirection, directionalColor, ambientColor, material };
+	if (bakeLightmapsOnStart) {
+		bakeLightmaps(myScene.objects, bakeSettings, pool, "lightmaps");
+	}
+	else if (std::filesystem::exists("lightmaps")) {
+		std::cout << "loaded " << loadLightmaps(myScene.objects, bakeSettings, "lightmaps") << " lightmaps" << std::endl;
+	}
 
-	// Activate the shader program.
-	myScene.program.activate();
+	// Path traces the scene as it stands, from a camera, at the window's resolution.
+	PathTraceSettings pathTraceSettings{ lightDirection, directionalColor, ambientColor, material };
+	pathTraceSettings.width = window.getSize().x;
+	pathTraceSettings.height = window.getSize().y;
+	pathTraceSettings.samplesPerPixel = pathTraceSamples;
+	auto pathTrace = [&](const glm::vec3& position, const glm::vec3& direction) {
+		PathTracer tracer(myScene.objects, pathTraceSettings);
+		tracer.renderToFiles(position, direction, pool, "render");
+	};
+	if (pathTraceOnStart) {
+		pathTrace(glm::vec3(0, 1.3, 2), glm::vec3(0, 0, -1));
+		return 0;
+	}
 
-	// load sound files into bufffer using SFML audio library (googled documentation)
-	sf::SoundBuffer diceBuffer, soundBuffer, winBuffer;
-	if (!diceBuffer.loadFromFile("sounds/dice.flac") || !soundBuffer.loadFromFile("sounds/coin-inserting.wav")
-		|| !winBuffer.loadFromFile("sounds/win.wav")) {
-		std::cerr << "Failed to load audio :c" << std::endl;
+	// Props that stand around the floor in numbers get an impostor for when they're far away.
+	std::unique_ptr<ImpostorRenderer> impostors;
+	if (impostorsEnabled) {
+		impostors = std::make_unique<ImpostorRenderer>(impostorBakeShader(), impostorShader(), impostorDistance);
+		for (auto& o : myScene.objects) {
+			if (o.getName() == "slots2" || o.getName() == "casinoChips" || o.getName() == "cardDeck") {
+				impostors->addProp(o);
+			}
+		}
+		// Both dice are the same model, so the second shares the first's atlases.
+		auto die = std::find_if(myScene.objects.begin(), myScene.objects.end(),
+			[](const Object3D& o) { return o.getName() == "cube"; });
+		auto die2 = std::find_if(myScene.objects.begin(), myScene.objects.end(),
+			[](const Object3D& o) { return o.getName() == "cube2"; });
+		if (die != myScene.objects.end() && die2 != myScene.objects.end()) {
+			impostors->addInstance(impostors->addProp(*die), *die2);
+		}
 	}
-	sf::Sound diceSound, coinSound, winSound;
-	diceSound.setBuffer(diceBuffer);
-	coinSound.setBuffer(soundBuffer);
-	winSound.setBuffer(winBuffer);
+
+	// The dice are rigid bodies, and every static object is something for them to land on, through
+	// its baked convex hulls.
+	PhysicsWorld physics(PhysicsSettings{}, &pool);
+	std::vector<PhysicsBinding> dice;
+	std::vector<glm::vec3> collisionTriangles;
+	for (auto& shape : cookCollisionShapes(myScene.objects, CollisionShapeSettings{}, pool, "collisionshapes")) {
+		shape.appendTriangles(collisionTriangles);
+	}
+	for (auto& o : myScene.objects) {
+		if (!o.isStatic() && o.isMoving) {
+			dice.push_back(addBoxBody(physics, o, DIE_MASS, DIE_FRICTION));
+			physics.body(dice.back().body).continuous = true;
+		}
+	}
+	physics.setStaticGeometry(collisionTriangles);
+	float physicsTime = 0;
+
+	// The hulls as one world-space mesh, drawn as wireframe over the scene when toggled on.
+	auto collisionShader = flatColorShader();
+	bool showCollision = false;
+	std::vector<Vertex3D> collisionVertices;
+	std::vector<uint32_t> collisionFaces;
+	for (auto& v : collisionTriangles) {
+		collisionFaces.push_back(static_cast<uint32_t>(collisionVertices.size()));
+		collisionVertices.push_back(Vertex3D(v.x, v.y, v.z, 0, 0, 0, 0, 0));
+	}
+	Mesh3D collisionMesh(collisionVertices, collisionFaces);
+
+	// One 1024x1024 tile per shadowed light; only the directional light casts shadows for now.
+	ShadowAtlas shadowAtlas(2048, 2);
+
+
+	// Sounds decode in the background and play on a fixed pool of voices. Dice clatter on every
+	// hard bounce, so they're rate limited and the first to give up their voices.
+	AudioManager audio(pool);
+	uint32_t diceSound = audio.load("sounds/dice.flac", SoundSettings{ 0, 2, 0.08f });
+	uint32_t coinSound = audio.load("sounds/coin-inserting.wav", SoundSettings{ 1, 2 });
+	uint32_t winSound = audio.load("sounds/win.wav", SoundSettings{ 2, 1 });
 
 	// Ready, set, go!
 	bool running = true;
 	sf::Clock c;
 	auto last = c.getElapsedTime();
 
-	// Start the animators.
-	for (auto& anim : myScene.animators) {
-		anim.start();
-	}
+	// Start the animations.
+	myScene.animations.addEvent(WIN_SOUND_TIME, [&]() { audio.play(winSound); });
+	myScene.animations.start();
 
 	// booleans for keyboard input
 	bool throwDice = false;
 	bool startAnimation = false;
 
+	// GPU time per pass and per object, shown in the window title twice a second.
+	GpuProfiler profiler;
+	float titleTimer = 0;
+
+	// A recording renders into an offscreen target, so the window may stay hidden.
+	std::unique_ptr<FrameRecorder> recorder;
+	if (recordMode) {
+		std::filesystem::path output = recordFormat == FrameRecorder::Format::Y4m ? "frames.y4m" : "frames";
+		recorder = std::make_unique<FrameRecorder>(window.getSize().x, window.getSize().y, recordFormat,
+			output, 60, pool);
+		window.setVisible(!headless);
+		throwDice = true;
+		startAnimation = true;
+	}
+
+	// Recordings keep a fixed resolution, so dynamic resolution only applies to interactive runs.
+	std::unique_ptr<DynamicResolution> dynamicResolution;
+	int64_t lastControlledFrame = -1;
+	if (dynamicResolutionEnabled && !recorder) {
+		dynamicResolution = std::make_unique<DynamicResolution>(upscaleShader(), window.getSize().x,
+			window.getSize().y, 1000.0f / targetFps);
+	}
+
+	// A benchmark run starts everything moving immediately and flies a scripted camera.
+	std::unique_ptr<Benchmark> benchmark;
+	if (benchmarkMode) {
+		uint64_t samplesPerFrame = static_cast<uint64_t>(window.getSize().x) * window.getSize().y
+			* std::max(1u, window.getSettings().antialiasingLevel);
+		benchmark = std::make_unique<Benchmark>(benchmarkFrames, samplesPerFrame, depthPrepass);
+		throwDice = true;
+		startAnimation = true;
+	}
+
+	// A replay takes its input and time steps from a recorded session instead of the window and
+	// the clock, so it goes through the same frames; a recording writes them out for one.
+	std::unique_ptr<InputReplay> inputReplay;
+	std::unique_ptr<InputRecorder> inputRecorder;
+	if (!replayInputPath.empty()) {
+		inputReplay = std::make_unique<InputReplay>(replayInputPath);
+		std::cout << "replaying " << inputReplay->frameCount() << " frames from " << replayInputPath << std::endl;
+	}
+	if (!recordInputPath.empty()) {
+		inputRecorder = std::make_unique<InputRecorder>(recordInputPath);
+	}
+
 	// camera view (from lecture) we can create the camera outside the while loop so we dont have to compute everytime unless we move around
 	glm::vec3 cameraPos = glm::vec3(0, 1.3, 2);
 	glm::vec3 cameraDir = glm::vec3(0, 0, -1);
 	glm::mat4 camera = glm::lookAt(cameraPos, cameraPos + cameraDir, glm::vec3(0, 1, 0));
 	glm::mat4 perspective = glm::perspective(glm::radians(45.0), static_cast<double>(window.getSize().x) / window.getSize().y, 0.1, 100.0);
 	float cameraSpeed = 0;
-	auto animationTimeElapsed = 0.0;
-	bool winSoundActive = true;
 	while (running) {
 		sf::Event ev;
-		while (window.pollEvent(ev)) {
+		if (inputReplay) {
+			// The window still needs its events handled; only closing it is acted on.
+			while (window.pollEvent(ev)) {
+				if (ev.type == sf::Event::Closed) {
+					running = false;
+				}
+			}
+		}
+		while (inputReplay ? inputReplay->pollEvent(ev) : window.pollEvent(ev)) {
+			if (inputRecorder) {
+				inputRecorder->recordEvent(ev);
+			}
 			if (ev.type == sf::Event::Closed) {
 				running = false;
 			}
+			if (ev.type == sf::Event::Resized && ev.size.width > 0 && ev.size.height > 0) {
+				glViewport(0, 0, ev.size.width, ev.size.height);
+				perspective = glm::perspective(glm::radians(45.0), static_cast<double>(ev.size.width) / ev.size.height, 0.1, 100.0);
+				if (dynamicResolution) {
+					dynamicResolution->resize(ev.size.width, ev.size.height);
+				}
+			}
 			if (ev.type == sf::Event::KeyPressed) {
 				if (ev.key.code == sf::Keyboard::Space) {
 					throwDice = true;
 				}
 				if (ev.key.code == sf::Keyboard::Return) {
-					coinSound.play();
+					audio.play(coinSound);
 					startAnimation = true;
 				}
+				if (ev.key.code == sf::Keyboard::L) {
+					lightMapsEnabled = !lightMapsEnabled;
+				}
+				if (ev.key.code == sf::Keyboard::O) {
+					shadowsEnabled = !shadowsEnabled;
+				}
+				if (ev.key.code == sf::Keyboard::T) {
+					// Blocks until the render is done; progress is written to render.png as it goes.
+					pathTrace(cameraPos, cameraDir);
+					last = c.getElapsedTime();
+				}
+				if (ev.key.code == sf::Keyboard::I && impostors) {
+					// A huge distance puts every prop back on its full meshes.
+					impostors->setDistance(impostors->distance() == impostorDistance ? 1e9f : impostorDistance);
+				}
+				if (ev.key.code == sf::Keyboard::C) {
+					showCollision = !showCollision;
+				}
+				if (ev.key.code == sf::Keyboard::P) {
+					depthPrepass = !depthPrepass;
+					std::cout << "depth pre-pass " << (depthPrepass ? "on" : "off") << std::endl;
+				}
 				// camera movement used the approach from lecture! :D
 				if (ev.key.code == sf::Keyboard::A) {
 					cameraDir = glm::rotate(cameraDir, cameraSpeed, glm::vec3(0,1,0));
@@ -401,86 +786,228 @@ int main() {
 		std::cout << 1 / diff.asSeconds() << " FPS " << std::endl;
 		last = now;
 
+		titleTimer += diff.asSeconds();
+		if (titleTimer > 0.5f) {
+			titleTimer = 0;
+			std::string resolution = dynamicResolution
+				? " | " + std::to_string(static_cast<int>(dynamicResolution->scale() * 100)) + "% resolution" : "";
+			if (streamer) {
+				resolution += " | " + std::to_string(streamer->residentBytes() / (1024 * 1024)) + " MB textures";
+			}
+			if (impostors) {
+				resolution += " | " + std::to_string(impostors->impostorCount()) + " impostors";
+			}
+			window.setTitle("Modern OpenGL | " + std::to_string(static_cast<int>(1 / diff.asSeconds())) + " FPS | "
+				+ profiler.summary() + resolution);
+		}
+
+		// Benchmarks step the simulation by a fixed amount so every run sees the same frames.
+		float dt = diff.asSeconds();
+		if (inputReplay) {
+			dt = inputReplay->timeStep();
+		}
+
 		// using our fps we can set a smoother camera speed
-		cameraSpeed = 100.0f * diff.asSeconds();
+		cameraSpeed = 100.0f * dt;
+
+		if (benchmark) {
+			dt = benchmark->timeStep();
+			cameraPos = benchmark->cameraPosition();
+			cameraDir = benchmark->cameraDirection();
+			camera = glm::lookAt(cameraPos, cameraPos + cameraDir, glm::vec3(0, 1, 0));
+		}
+		// Recordings do the same, flying the orbit once over the whole recording.
+		if (recorder) {
+			dt = 1.0f / 60.0f;
+			CameraPose pose = orbitCameraPose(static_cast<float>(recorder->framesRendered()) / recordFrames);
+			cameraPos = pose.position;
+			cameraDir = pose.direction;
+			camera = glm::lookAt(cameraPos, cameraPos + cameraDir, glm::vec3(0, 1, 0));
+		}
 
+		// Stream in the texture detail this view needs, and let go of what it doesn't. Texels are
+		// only as fine as the pixels actually rendered, which dynamic resolution may have reduced.
+		if (streamer) {
+			uint32_t renderHeight = dynamicResolution ? dynamicResolution->renderHeight() : window.getSize().y;
+			streamer->requestVisible(myScene.objects, camera, perspective, renderHeight);
+			streamer->update();
+		}
+		if (impostors) {
+			impostors->update(cameraPos);
+		}
+
+		myScene.program.activate();
 		myScene.program.setUniform("view", camera);
 		myScene.program.setUniform("projection", perspective);
 		myScene.program.setUniform("cameraPos", cameraPos);
 
-		//  ambient, diffuse, specular, shininess
-		myScene.program.setUniform("material", glm::vec4(.6,.5,.5,0));
-		// ambient color (going for like a yellowish color)
-		myScene.program.setUniform("ambientColor", glm::vec3(.8,.8,.5));
-		// light direction that points downward
-		myScene.program.setUniform("directionalLight", glm::vec3(0,-1,0));
-		// color of directional light softer yellow
-		myScene.program.setUniform("directionalColor", glm::vec3(.4,.4,.2));
+		myScene.program.setUniform("material", material);
+		myScene.program.setUniform("ambientColor", ambientColor);
+		myScene.program.setUniform("directionalLight", lightDirection);
+		myScene.program.setUniform("directionalColor", directionalColor);
+		myScene.program.setUniform("lightMapsEnabled", lightMapsEnabled);
+
+		// Take in sounds that finished decoding, and move the audio clock on for rate limits.
+		audio.update(dt);
 
 		// when the user click return start the animations
 		if (startAnimation) {
-			for (auto& anim : myScene.animators) {
-				anim.tick(diff.asSeconds());
-				// wasn't sure how to access currentTime() so i just used a counter
-				animationTimeElapsed += .1;
-				// after 7s of when the animation started play the win sound
-				if (animationTimeElapsed > 2800 && winSoundActive) {
-					winSound.play();
-					winSoundActive = false;
-				}
-			}
+			myScene.animations.tick(dt);
 		}
 
-		// Update the scene.
-		float dt = diff.asSeconds();
-		for (auto& dice : myScene.objects) {
-			// only drop the dice if the object isMoving and if user pressed space
-			if (dice.isMoving && throwDice) {
-				dice.tick(dt);
-
-				// Check if the dice has hit the table (I need to figure out collisions, hard coded for now)
-				if (dice.getPosition().y <= .55f) {
-					diceSound.play();
-					glm::vec3 pos = dice.getPosition();
-					glm::vec3 vel = dice.getVelocity();
-					pos.y = 0.55f;
-					// make the velocity lose "energy" guess and check values (found 0.5 for y and 0.7 for z and x simulate dice rolling well enough)
-					vel.y *= -dice.getBounceCoeff();
-					vel.x *= 0.7f;
-					vel.z *= 0.7f;
-
-					// lose rotational speed
-					dice.setAngularVelocity(dice.getAngularVelocity() * 0.9f);
-
-					dice.setPosition(pos);
-					dice.setVelocity(vel);
-					// square root x,y,x components in velocity to get magnitude
-					if (glm::length(vel) < 0.1f) {
-						dice.setVelocity(glm::vec3(0.0f));
-						auto rotVel = dice.getAngularVelocity();
-						dice.setAngularVelocity(rotVel * 0.9f);
-						// square root x,y,z in angular velocity to get magnitude
-						if (glm::length(rotVel) < 0.1f) {
-
-							// snap the dice to the nearest 90 degrees
-							snapToNearestRotation(dice);
-							dice.isMoving = false; // set to false so my program runs faster i think?
-						}
-					}
+		// Update the scene: step the dice in fixed increments to cover this frame.
+		uint32_t physicsSteps = 0;
+		if (throwDice) {
+			physicsTime += std::min(dt, MAX_PHYSICS_CATCHUP);
+			while (physicsTime >= PHYSICS_STEP) {
+				physics.step(PHYSICS_STEP);
+				physicsTime -= PHYSICS_STEP;
+				physicsSteps++;
+				if (physics.maxImpactSpeed() > 0.5f) {
+					audio.play(diceSound);
+				}
+			}
+			// Sleeping dice haven't moved since they fell asleep.
+			for (auto& binding : dice) {
+				binding.object->isMoving = physics.body(binding.body).awake;
+				if (binding.object->isMoving) {
+					syncObject(physics, binding);
 				}
 			}
 		}
+		if (inputRecorder) {
+			inputRecorder->endFrame(dt, physicsSteps, physics.stateChecksum());
+		}
+		if (inputReplay) {
+			inputReplay->endFrame(physicsSteps, physics.stateChecksum());
+			if (inputReplay->finished()) {
+				running = false;
+			}
+		}
+
+		profiler.beginFrame();
 
+		// Update the shadow atlas. The static casters are only re-rendered if the light moved.
+		if (shadowsEnabled) {
+			GpuScope shadowScope(&profiler, "shadows");
+			shadowAtlas.setDirectionalLight(0, lightDirection, glm::vec3(0, 2.5, 0), 7.5f);
+			shadowAtlas.render(depthShader, myScene.objects);
+			myScene.program.activate();
+			myScene.program.setUniform("lightSpace", shadowAtlas.lightSpaceMatrix(0));
+			myScene.program.setUniform("shadowTileBounds", shadowAtlas.tileBounds(0));
+		}
+		myScene.program.setUniform("shadowsEnabled", shadowsEnabled);
+		// The shadow sampler must never share a unit with a sampler2D, even when unused.
+		myScene.program.setUniform("shadowMap", SHADOW_TEXTURE_UNIT);
+		glActiveTexture(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D, shadowAtlas.textureId());
+		// Later binds that don't pick a unit, like texture uploads, must not replace the atlas.
+		glActiveTexture(GL_TEXTURE0);
+
+		if (recorder) {
+			recorder->beginFrame();
+		}
+		if (dynamicResolution) {
+			// The controller sees each frame's GPU time once, a few frames after it ran.
+			if (profiler.latestFrame() != lastControlledFrame && !profiler.latestTimings().empty()) {
+				lastControlledFrame = profiler.latestFrame();
+				dynamicResolution->update(profiler.latestTimings().front().milliseconds);
+			}
+			dynamicResolution->beginFrame();
+		}
 		// Clear the OpenGL "context".
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		// Depth pre-pass: write only depth, so that the shaded pass below runs lighting.frag
+		// once per visible pixel instead of once per overlapping fragment.
+		if (depthPrepass) {
+			GpuScope prepassScope(&profiler, "depthPrepass");
+			depthShader.activate();
+			depthShader.setUniform("view", camera);
+			depthShader.setUniform("projection", perspective);
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			for (auto& o : myScene.objects) {
+				if (!impostors || !impostors->isImpostor(o)) {
+					o.renderDepth(depthShader);
+				}
+			}
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			glDepthFunc(GL_EQUAL);
+			glDepthMask(GL_FALSE);
+			myScene.program.activate();
+		}
+
 		// Render the scene objects.
+		if (benchmark) {
+			benchmark->beginShadedPass();
+		}
+		profiler.beginScope("shaded");
 		for (auto& o : myScene.objects) {
+			if (impostors && impostors->isImpostor(o)) {
+				continue;
+			}
+			GpuScope objectScope(&profiler, o.getName().empty() ? "object" : o.getName());
 			o.render(myScene.program);
 
 		}
+		profiler.endScope();
+		if (benchmark) {
+			benchmark->endShadedPass();
+		}
+
+		if (depthPrepass) {
+			glDepthFunc(GL_LESS);
+			glDepthMask(GL_TRUE);
+		}
+		// Impostors write their own depth, so they draw after the pre-pass depth state is undone.
+		if (impostors) {
+			GpuScope impostorScope(&profiler, "impostors");
+			impostors->render(camera, perspective, cameraPos, material, ambientColor, lightDirection,
+				directionalColor);
+		}
+		if (showCollision) {
+			GpuScope collisionScope(&profiler, "collision");
+			collisionShader.activate();
+			collisionShader.setUniform("view", camera);
+			collisionShader.setUniform("projection", perspective);
+			collisionShader.setUniform("model", glm::mat4(1));
+			collisionShader.setUniform("color", glm::vec3(0, 1, 0));
+			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+			glDisable(GL_CULL_FACE);
+			collisionMesh.renderDepth();
+			glEnable(GL_CULL_FACE);
+			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		}
+		if (dynamicResolution) {
+			GpuScope upscaleScope(&profiler, "upscale");
+			dynamicResolution->endFrame(0);
+		}
+		profiler.endFrame();
+
+		if (recorder) {
+			recorder->endFrame(!headless);
+			if (recorder->framesRendered() >= recordFrames) {
+				recorder->finish();
+				running = false;
+			}
+		}
 		window.display();
+
+		if (benchmark) {
+			benchmark->endFrame(diff.asSeconds());
+			benchmark->recordGpuTimings(profiler);
+			if (benchmark->finished()) {
+				benchmark->writeReport("benchmark.json");
+				running = false;
+			}
+		}
 	}
 
+	if (inputReplay && inputReplay->divergedAt() >= 0) {
+		std::cerr << "replay diverged from the recording at frame " << inputReplay->divergedAt() << std::endl;
+		// Fail the run, so scripts replaying recordings as regression checks catch it.
+		return 1;
+	}
 	return 0;
 }
 